@@ -6,17 +6,37 @@ namespace liftrr {
 namespace app {
 
 DisplayManager::DisplayManager(Adafruit_SSD1306 &display,
+                               liftrr::ui::OledFlusher &flusher,
                                liftrr::ui::UiRenderer &ui,
                                liftrr::storage::StorageManager &storage,
                                liftrr::ble::BleManager &ble,
+                               liftrr::comm::BtClassicManager &btClassic,
                                liftrr::sensors::SensorManager &sensors,
                                liftrr::core::RuntimeState &runtime)
     : display_(display),
+      flusher_(flusher),
       ui_(ui),
       storage_(storage),
       ble_(ble),
+      bt_classic_(btClassic),
       sensors_(sensors),
-      runtime_(runtime) {}
+      runtime_(runtime),
+      last_frame_ms_(0),
+      last_motion_ms_(0),
+      motion_ref_mm_(0),
+      last_mode_(0xFF),
+      budget_skips_(0),
+      governor_stats_(),
+      static_layer_(display),
+      status_label_{2, 1, 30, 8, 0, false},
+      status_blink_{119, 1, 7, 7, 0, false},
+      info_line_{0, 12, 114, 8, 0, false},
+      distance_{0, 22, 116, 24, 0, false},
+      bar_fill_{liftrr::ui::UiRenderer::VBAR_X + 1, liftrr::ui::UiRenderer::VBAR_Y + 1,
+                liftrr::ui::UiRenderer::VBAR_W - 2, liftrr::ui::UiRenderer::VBAR_H - 2, 0, false},
+      attitude_{0, 50, 116, 14, 0, false},
+      widgets_redrawn_(0),
+      render_stats_() {}
 
 const char *DisplayManager::modeLabel(liftrr::core::DeviceMode mode) const {
     switch (mode) {
@@ -53,7 +73,60 @@ void DisplayManager::drawInfoLine(int y) {
     display_.print((sensors_.isCalibrated() && sensors_.laserValid()) ? "C:OK" : "C:--");
 }
 
+uint32_t DisplayManager::chooseIntervalMs(uint32_t nowMs) const {
+    liftrr::core::DeviceMode mode = runtime_.deviceMode();
+    if (mode == liftrr::core::MODE_IDLE || mode == liftrr::core::MODE_DUMP) {
+        return DISPLAY_IDLE_INTERVAL_MS;
+    }
+    // A file transfer owns the radio and the SD; the screen can wait.
+    if (bt_classic_.isStreaming()) return DISPLAY_IDLE_INTERVAL_MS;
+    if (nowMs - last_motion_ms_ < DISPLAY_ACTIVE_HOLD_MS) return DISPLAY_ACTIVE_INTERVAL_MS;
+    return DISPLAY_STATIC_INTERVAL_MS;
+}
+
+void DisplayManager::noteDistance(int16_t relDist, uint32_t nowMs) {
+    if (abs(relDist - motion_ref_mm_) >= DISPLAY_MOTION_MM) {
+        motion_ref_mm_ = relDist;
+        last_motion_ms_ = nowMs;
+    }
+}
+
+bool DisplayManager::frameDue(uint32_t nowMs, uint32_t loopStartUs) {
+    uint8_t mode = (uint8_t)runtime_.deviceMode();
+    bool modeChanged = (mode != last_mode_);
+    governor_stats_.intervalMs = chooseIntervalMs(nowMs);
+
+    if (!modeChanged) {
+        if (nowMs - last_frame_ms_ < governor_stats_.intervalMs) return false;
+        if (micros() - loopStartUs > DISPLAY_LOOP_BUDGET_US &&
+            budget_skips_ < DISPLAY_MAX_BUDGET_SKIPS) {
+            budget_skips_++;
+            governor_stats_.budgetSkips++;
+            return false;
+        }
+    }
+
+    budget_skips_ = 0;
+    last_frame_ms_ = nowMs;
+    last_mode_ = mode;
+    governor_stats_.framesDue++;
+    return true;
+}
+
+uint8_t DisplayManager::infoFlags() const {
+    return (uint8_t)((uint8_t)runtime_.deviceMode() |
+                     (storage_.isSessionActive() ? 0x10 : 0) |
+                     (ble_.isConnected() ? 0x20 : 0) |
+                     ((sensors_.isCalibrated() && sensors_.laserValid()) ? 0x40 : 0));
+}
+
+void DisplayManager::redrawWidget(liftrr::ui::Widget &widget) {
+    static_layer_.restoreRect(widget.x, widget.y, widget.w, widget.h);
+    widgets_redrawn_++;
+}
+
 void DisplayManager::renderDumpScreen() {
+    static_layer_.invalidate();
     display_.clearDisplay();
     drawHeader("DUMP");
     drawInfoLine(12);
@@ -64,10 +137,11 @@ void DisplayManager::renderDumpScreen() {
     display_.setTextSize(1);
     display_.setCursor(8, 48);
     display_.println("Send 'p' over serial");
-    display_.display();
+    flusher_.flush();
 }
 
 void DisplayManager::renderIdleScreen() {
+    static_layer_.invalidate();
     display_.clearDisplay();
     drawHeader("IDLE");
     drawInfoLine(12);
@@ -75,10 +149,12 @@ void DisplayManager::renderIdleScreen() {
     display_.setTextSize(2);
     display_.setCursor(15, 26);
     display_.println("IDLE MODE");
-    display_.display();
+    flusher_.flush();
 }
 
 void DisplayManager::renderCalibrationOrWarmupScreen(const liftrr::sensors::SensorSample &sample) {
+    static_layer_.invalidate();
+    display_.clearDisplay();
     drawHeader("SETUP");
 
     display_.setTextSize(1);
@@ -106,36 +182,101 @@ void DisplayManager::renderCalibrationOrWarmupScreen(const liftrr::sensors::Sens
     }
 }
 
+void DisplayManager::buildTrackingTemplate() {
+    display_.clearDisplay();
+    ui_.drawStatusBarFrame();
+    ui_.drawVerticalBarFrame();
+    ui_.drawHorizonAxis();
+
+    display_.setTextSize(1);
+    display_.setTextColor(SSD1306_WHITE);
+    display_.setCursor(0, 50);
+    display_.print("P:");
+    display_.setCursor(60, 50);
+    display_.print("Y:");
+
+    static_layer_.capture(SCREEN_TRACKING);
+    status_label_.invalidate();
+    status_blink_.invalidate();
+    info_line_.invalidate();
+    distance_.invalidate();
+    bar_fill_.invalidate();
+    attitude_.invalidate();
+    render_stats_.templateBuilds++;
+}
+
+// Retained: the buffer keeps the previous frame, so only widgets whose
+// bound value changed are restored from the template and redrawn.
 void DisplayManager::renderTrackingScreen(const liftrr::sensors::RelativePose &pose) {
+    uint32_t startUs = micros();
+    widgets_redrawn_ = 0;
+    if (!static_layer_.holds(SCREEN_TRACKING)) buildTrackingTemplate();
+
     bool tracking = (sensors_.laserOffset() != 0);
-    ui_.drawStatusBar(tracking);
-    drawInfoLine(12);
+    if (status_label_.update(tracking ? 1 : 0)) {
+        redrawWidget(status_label_);
+        ui_.drawStatusLabel(tracking);
+    }
+    bool blinkOn = (millis() / 500) % 2 == 0;
+    if (status_blink_.update(blinkOn ? 1 : 0)) {
+        redrawWidget(status_blink_);
+        ui_.drawStatusBlink(blinkOn);
+    }
+    if (info_line_.update(infoFlags())) {
+        redrawWidget(info_line_);
+        drawInfoLine(info_line_.y);
+    }
+    if (bar_fill_.update(liftrr::ui::UiRenderer::verticalBarFillPx(pose.relDist))) {
+        redrawWidget(bar_fill_);
+        ui_.drawVerticalBarFill(pose.relDist);
+    }
 
-    ui_.drawVerticalBar(pose.relDist);
-    ui_.drawHorizon(pose.relRoll);
+    if (distance_.update(pose.relDist)) {
+        redrawWidget(distance_);
 
-    int xPos = 10;
-    int absDist = abs(pose.relDist);
-    if (absDist < 10)       xPos = 45;
-    else if (absDist < 100) xPos = 35;
-    else if (absDist < 1000) xPos = 15;
+        int xPos = 10;
+        int absDist = abs(pose.relDist);
+        if (absDist < 10)       xPos = 45;
+        else if (absDist < 100) xPos = 35;
+        else if (absDist < 1000) xPos = 15;
 
-    display_.setTextSize(3);
-    display_.setCursor(xPos, 22);
-    display_.print(pose.relDist);
+        display_.setTextSize(3);
+        display_.setCursor(xPos, 22);
+        display_.print(pose.relDist);
 
-    display_.setTextSize(1);
-    int unitX = xPos + (absDist >= 1000 ? 75 : (absDist >= 100 ? 55 : 38));
-    display_.setCursor(unitX, 34);
-    display_.print("mm");
+        display_.setTextSize(1);
+        int unitX = xPos + (absDist >= 1000 ? 75 : (absDist >= 100 ? 55 : 38));
+        display_.setCursor(unitX, 34);
+        display_.print("mm");
+    }
 
-    display_.setCursor(0, 50);
-    display_.print("P:"); display_.print((int)pose.relPitch);
-    display_.setCursor(60, 50);
-    display_.print("Y:"); display_.print((int)pose.relYaw);
+    int pitch = (int)pose.relPitch;
+    int yaw = (int)pose.relYaw;
+    int markerX = liftrr::ui::UiRenderer::horizonMarkerX(pose.relRoll);
+    bool level = abs(pose.relRoll) < 2;
+    int32_t attitude = (int32_t)((pitch + 256) & 0x1FF) |
+                       ((int32_t)((yaw + 256) & 0x1FF) << 9) |
+                       ((int32_t)(markerX & 0x7F) << 18) |
+                       ((int32_t)(level ? 1 : 0) << 25);
+    if (attitude_.update(attitude)) {
+        redrawWidget(attitude_);
+        ui_.drawHorizonMarker(pose.relRoll);
+        display_.setTextSize(1);
+        display_.setCursor(12, 50);
+        display_.print(pitch);
+        display_.setCursor(72, 50);
+        display_.print(yaw);
+    }
+
+    uint32_t elapsedUs = micros() - startUs;
+    render_stats_.frames++;
+    render_stats_.lastRenderUs = elapsedUs;
+    if (elapsedUs > render_stats_.maxRenderUs) render_stats_.maxRenderUs = elapsedUs;
+    render_stats_.lastWidgets = widgets_redrawn_;
 }
 
 void DisplayManager::renderOrientationWarningScreen(liftrr::sensors::DeviceFacing facing) {
+    static_layer_.invalidate();
     display_.clearDisplay();
     drawHeader("ORIENTATION");
     drawInfoLine(12);
@@ -3,40 +3,101 @@
 #include <Adafruit_SSD1306.h>
 
 #include "ble/ble.h"
+#include "comm/bt_classic.h"
 #include "core/globals.h"
 #include "sensors/sensors.h"
 #include "storage/storage.h"
+#include "ui/oled_flusher.h"
+#include "ui/retained.h"
 #include "ui/ui.h"
 
 namespace liftrr {
 namespace app {
 
+// Tracking-screen render cost (buffer work only; the flush is separate).
+struct DisplayRenderStats {
+    uint32_t frames;
+    uint32_t templateBuilds;  // static layer (re)rendered on screen entry
+    uint32_t lastRenderUs;
+    uint32_t maxRenderUs;
+    uint8_t lastWidgets;      // widgets redrawn by the last frame
+};
+
+struct DisplayGovernorStats {
+    uint32_t intervalMs;      // refresh interval chosen for the last decision
+    uint32_t framesDue;
+    uint32_t budgetSkips;     // frames skipped because the loop pass was late
+};
+
 class DisplayManager {
 public:
     DisplayManager(Adafruit_SSD1306 &display,
+                   liftrr::ui::OledFlusher &flusher,
                    liftrr::ui::UiRenderer &ui,
                    liftrr::storage::StorageManager &storage,
                    liftrr::ble::BleManager &ble,
+                   liftrr::comm::BtClassicManager &btClassic,
                    liftrr::sensors::SensorManager &sensors,
                    liftrr::core::RuntimeState &runtime);
 
+    // Frame-rate governor: true when a frame should be rendered now. The
+    // interval follows content and mode (fast while the distance moves,
+    // slow when static, near zero in IDLE/DUMP or during a Classic
+    // transfer); a mode change is due at once. A loop pass already past
+    // DISPLAY_LOOP_BUDGET_US (measured from loopStartUs) skips the frame.
+    bool frameDue(uint32_t nowMs, uint32_t loopStartUs);
+    void noteDistance(int16_t relDist, uint32_t nowMs);
+    const DisplayGovernorStats &governorStats() const { return governor_stats_; }
+
     void renderDumpScreen();
     void renderIdleScreen();
     void renderCalibrationOrWarmupScreen(const liftrr::sensors::SensorSample &sample);
     void renderTrackingScreen(const liftrr::sensors::RelativePose &pose);
     void renderOrientationWarningScreen(liftrr::sensors::DeviceFacing facing);
 
+    const DisplayRenderStats &renderStats() const { return render_stats_; }
+    const liftrr::ui::OledFlushStats &flushStats() const { return flusher_.stats(); }
+
 private:
+    enum ScreenId : uint8_t {
+        SCREEN_TRACKING = 1,
+    };
+
+    uint32_t chooseIntervalMs(uint32_t nowMs) const;
+    void buildTrackingTemplate();
+    void redrawWidget(liftrr::ui::Widget &widget);
+    uint8_t infoFlags() const;
     const char *modeLabel(liftrr::core::DeviceMode mode) const;
     void drawHeader(const char *title);
     void drawInfoLine(int y);
 
     Adafruit_SSD1306 &display_;
+    liftrr::ui::OledFlusher &flusher_;
     liftrr::ui::UiRenderer &ui_;
     liftrr::storage::StorageManager &storage_;
     liftrr::ble::BleManager &ble_;
+    liftrr::comm::BtClassicManager &bt_classic_;
     liftrr::sensors::SensorManager &sensors_;
     liftrr::core::RuntimeState &runtime_;
+
+    uint32_t last_frame_ms_;
+    uint32_t last_motion_ms_;
+    int16_t motion_ref_mm_;
+    uint8_t last_mode_;
+    uint8_t budget_skips_;  // consecutive
+    DisplayGovernorStats governor_stats_;
+
+    // Retained tracking screen: the template lives in static_layer_, the
+    // widgets below are redrawn in place only when their value changes.
+    liftrr::ui::StaticLayer static_layer_;
+    liftrr::ui::Widget status_label_;
+    liftrr::ui::Widget status_blink_;
+    liftrr::ui::Widget info_line_;
+    liftrr::ui::Widget distance_;
+    liftrr::ui::Widget bar_fill_;
+    liftrr::ui::Widget attitude_;  // P/Y values and horizon marker overlap
+    uint8_t widgets_redrawn_;
+    DisplayRenderStats render_stats_;
 };
 
 } // namespace app
@@ -11,20 +11,16 @@ void MotionController::initMotionState(MotionState &state, unsigned long nowMs)
     state.lastYaw = 0.0f;
 }
 
-void MotionController::updateCalibrationStatus(const liftrr::sensors::SensorSample &sample,
-                                               liftrr::sensors::SensorManager &sensors) {
-    sensors.updateCalibrationStatus(sample);
-}
-
-void MotionController::enforceCalibrationModeGuard(const liftrr::sensors::SensorManager &sensors,
+void MotionController::enforceCalibrationModeGuard(bool calibrated,
+                                                   bool laserValid,
                                                    liftrr::core::RuntimeState &runtime) {
     liftrr::core::DeviceMode mode = runtime.deviceMode();
     if (mode == liftrr::core::MODE_RUN) {
-        if (!sensors.isCalibrated()) {
+        if (!calibrated) {
             runtime.setDeviceMode(liftrr::core::MODE_CALIBRATE);
         }
     } else if (mode == liftrr::core::MODE_CALIBRATE) {
-        if (sensors.isCalibrated() && sensors.laserValid()) {
+        if (calibrated && laserValid) {
             runtime.setDeviceMode(liftrr::core::MODE_RUN);
         }
     }
@@ -19,9 +19,10 @@ struct MotionState {
 class MotionController {
 public:
     void initMotionState(MotionState &state, unsigned long nowMs);
-    void updateCalibrationStatus(const liftrr::sensors::SensorSample &sample,
-                                 liftrr::sensors::SensorManager &sensors);
-    void enforceCalibrationModeGuard(const liftrr::sensors::SensorManager &sensors,
+    // Takes the flags from a SensorRecord so the mode follows the same
+    // cycle the loop is acting on.
+    void enforceCalibrationModeGuard(bool calibrated,
+                                     bool laserValid,
                                      liftrr::core::RuntimeState &runtime);
     void updateMotionAndMode(const liftrr::sensors::RelativePose &pose,
                              unsigned long nowMs,
@@ -0,0 +1,199 @@
+#include "app/rep_detector.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <string.h>
+
+#include "core/rtc.h"
+
+namespace liftrr {
+namespace app {
+
+namespace {
+
+// millis() stamp to the session row time base (epoch when synced).
+int64_t sessionTimeMs(uint32_t sampleMs) {
+    int64_t epoch = liftrr::core::currentEpochMs();
+    return (epoch > 0) ? epoch - (int64_t)(uint32_t)(millis() - sampleMs) : (int64_t)sampleMs;
+}
+
+bool containsNoCase(const char *text, const char *word) {
+    size_t len = strlen(word);
+    for (; *text; text++) {
+        size_t i = 0;
+        while (i < len && text[i] && tolower((unsigned char)text[i]) == word[i]) i++;
+        if (i == len) return true;
+    }
+    return false;
+}
+
+uint16_t clampU16(float v) {
+    if (v <= 0.0f) return 0;
+    if (v >= 65535.0f) return 65535;
+    return (uint16_t)(v + 0.5f);
+}
+
+} // namespace
+
+RepOrder repOrderForExercise(const char *exercise) {
+    if (!exercise) return REP_DOWN_UP;
+    // Romanian / stiff-leg deadlifts start from the top.
+    if (containsNoCase(exercise, "romanian") || containsNoCase(exercise, "stiff")) {
+        return REP_DOWN_UP;
+    }
+    static const char *const kFloorLifts[] = {"deadlift", "clean", "snatch"};
+    for (const char *lift : kFloorLifts) {
+        if (containsNoCase(exercise, lift)) return REP_UP_DOWN;
+    }
+    return REP_DOWN_UP;
+}
+
+RepDetector::RepDetector()
+    : order_(REP_DOWN_UP),
+      dir_(0),
+      cur_(),
+      anchor_mm_(0.0f),
+      anchor_us_(0),
+      anchor_ms_(0),
+      has_anchor_(false),
+      still_(false),
+      still_since_us_(0),
+      has_first_(false),
+      first_(),
+      rep_count_(0) {}
+
+void RepDetector::gap() {
+    dir_ = 0;
+    has_first_ = false;
+    still_ = false;
+    has_anchor_ = false;
+}
+
+void RepDetector::restart(RepOrder order) {
+    gap();
+    order_ = order;
+    rep_count_ = 0;
+}
+
+uint16_t RepDetector::repCount() const {
+    return rep_count_;
+}
+
+void RepDetector::push(const liftrr::sensors::SensorRecord &rec, RepSink sink) {
+    const liftrr::sensors::RelativePose &pose = rec.pose;
+    float mm = pose.dispMm;
+    uint32_t us = rec.sampleUs;
+
+    if (fabsf(pose.velMmS) < REP_REST_VEL_MMS) {
+        if (!still_) {
+            still_ = true;
+            still_since_us_ = us;
+        }
+    } else {
+        still_ = false;
+    }
+
+    bool settled = still_ && (us - still_since_us_) >= REP_REST_MS * 1000UL;
+
+    if (dir_ == 0) {
+        if (!has_anchor_ || (settled && fabsf(mm - anchor_mm_) <= REP_HYSTERESIS_MM)) {
+            anchor_mm_ = mm;
+            anchor_us_ = us;
+            anchor_ms_ = rec.sampleMs;
+            has_anchor_ = true;
+            return;
+        }
+        if (fabsf(mm - anchor_mm_) <= REP_HYSTERESIS_MM) return;
+        beginPhase(mm > anchor_mm_ ? 1 : -1, anchor_mm_, anchor_us_, anchor_ms_);
+        // A slow start must not count as the rest that ends the phase.
+        still_since_us_ = us;
+        settled = false;
+    }
+
+    // Extremes and tilt over the open phase.
+    if (pose.velMmS * dir_ > cur_.peakVelMmS) cur_.peakVelMmS = pose.velMmS * dir_;
+    if (pose.relRoll < cur_.rollMin) cur_.rollMin = pose.relRoll;
+    if (pose.relRoll > cur_.rollMax) cur_.rollMax = pose.relRoll;
+    if (pose.relPitch < cur_.pitchMin) cur_.pitchMin = pose.relPitch;
+    if (pose.relPitch > cur_.pitchMax) cur_.pitchMax = pose.relPitch;
+    if ((mm - cur_.endMm) * dir_ > 0.0f) {
+        cur_.endMm = mm;
+        cur_.endUs = us;
+        cur_.endMs = rec.sampleMs;
+    }
+
+    if ((cur_.endMm - mm) * dir_ > REP_HYSTERESIS_MM) {
+        // Reversal: the next phase starts at this one's extreme.
+        Phase done = cur_;
+        endPhase(sink);
+        beginPhase((int8_t)-done.dir, done.endMm, done.endUs, done.endMs);
+        cur_.endMm = mm;
+        cur_.endUs = us;
+        cur_.endMs = rec.sampleMs;
+    } else if (settled) {
+        endPhase(sink);
+        dir_ = 0;
+        anchor_mm_ = mm;
+        anchor_us_ = us;
+        anchor_ms_ = rec.sampleMs;
+    }
+}
+
+void RepDetector::beginPhase(int8_t dir, float mm, uint32_t us, uint32_t ms) {
+    dir_ = dir;
+    cur_.dir = dir;
+    cur_.startMm = cur_.endMm = mm;
+    cur_.startUs = cur_.endUs = us;
+    cur_.startMs = cur_.endMs = ms;
+    cur_.peakVelMmS = 0.0f;
+    cur_.rollMin = cur_.pitchMin = INFINITY;
+    cur_.rollMax = cur_.pitchMax = -INFINITY;
+}
+
+void RepDetector::endPhase(RepSink sink) {
+    const Phase &phase = cur_;
+    float rom = fabsf(phase.endMm - phase.startMm);
+    if (rom < REP_MIN_ROM_MM) {
+        // Unracking, walking out, a bounce: not half of a rep.
+        has_first_ = false;
+        return;
+    }
+
+    int8_t openingDir = (order_ == REP_UP_DOWN) ? 1 : -1;
+    if (phase.dir == openingDir) {
+        first_ = phase;
+        has_first_ = true;
+        return;
+    }
+
+    // Closing phase: pairs only with the opening phase right before it.
+    if (has_first_ && (phase.startUs - first_.endUs) <= REP_MAX_PAUSE_MS * 1000UL) {
+        float firstRom = fabsf(first_.endMm - first_.startMm);
+        float ratio = (rom < firstRom) ? rom / firstRom : firstRom / rom;
+        if (ratio >= REP_ROM_MATCH) emitRep(first_, phase, sink);
+    }
+    has_first_ = false;
+}
+
+void RepDetector::emitRep(const Phase &first, const Phase &second, RepSink sink) {
+    const Phase &con = (first.dir > 0) ? first : second;
+    uint32_t conUs = con.endUs - con.startUs;
+
+    liftrr::storage::SessionRep rep;
+    rep.index = ++rep_count_;
+    rep.startMs = sessionTimeMs(first.startMs);
+    rep.endMs = sessionTimeMs(second.endMs);
+    rep.romMm = clampU16(con.endMm - con.startMm);
+    rep.meanVelMmS = conUs ? clampU16((con.endMm - con.startMm) * 1e6f / (float)conUs) : 0;
+    rep.peakVelMmS = clampU16(con.peakVelMmS);
+    rep.concentricMs = conUs / 1000UL;
+    rep.tutMs = (second.endUs - first.startUs) / 1000UL;
+    rep.rollMinDeg = fminf(first.rollMin, second.rollMin);
+    rep.rollMaxDeg = fmaxf(first.rollMax, second.rollMax);
+    rep.pitchMinDeg = fminf(first.pitchMin, second.pitchMin);
+    rep.pitchMaxDeg = fmaxf(first.pitchMax, second.pitchMax);
+    sink(rep);
+}
+
+} // namespace app
+} // namespace liftrr
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "core/config.h"
+#include "core/function_ref.h"
+#include "sensors/sensor_task.h"
+#include "storage/session_format.h"
+
+namespace liftrr {
+namespace app {
+
+typedef liftrr::core::FunctionRef<void(const liftrr::storage::SessionRep &)> RepSink;
+
+// Phase order of one rep.
+enum RepOrder : uint8_t {
+    REP_DOWN_UP,  // starts at the top: squat, bench, press
+    REP_UP_DOWN,  // starts from the floor: deadlift, clean, snatch
+};
+
+// Order for a session's exercise name; case-insensitive, REP_DOWN_UP for
+// anything not known to start from the floor.
+RepOrder repOrderForExercise(const char *exercise);
+
+// Streaming rep segmentation on RelativePose::dispMm/velMmS. The bar path is
+// cut into up and down phases: a phase ends when the bar travels
+// REP_HYSTERESIS_MM back from its extreme, or stays still for REP_REST_MS.
+// An opening phase followed by the opposite phase, in the exercise's
+// RepOrder, of at least REP_MIN_ROM_MM and similar range make one rep; the
+// up phase is the concentric one. A closing phase with no opening phase
+// right before it is dropped, so a stray movement cannot shift the pairing.
+// Constant work and memory per record. Loop task only.
+class RepDetector {
+public:
+    RepDetector();
+
+    // Feeds the next record (in order); calls sink when it completes a rep.
+    void push(const liftrr::sensors::SensorRecord &rec, RepSink sink);
+
+    // Drops the rep in progress (records that must not be analysed).
+    void gap();
+
+    // gap() and rep numbering back to 1, for a new session.
+    void restart(RepOrder order = REP_DOWN_UP);
+
+    uint16_t repCount() const;
+
+private:
+    struct Phase {
+        int8_t dir;  // +1 up, -1 down
+        float startMm;
+        float endMm;
+        uint32_t startUs;
+        uint32_t endUs;
+        uint32_t startMs;
+        uint32_t endMs;
+        float peakVelMmS;  // fastest speed in dir
+        float rollMin;
+        float rollMax;
+        float pitchMin;
+        float pitchMax;
+    };
+
+    void beginPhase(int8_t dir, float mm, uint32_t us, uint32_t ms);
+    void endPhase(RepSink sink);
+    void emitRep(const Phase &first, const Phase &second, RepSink sink);
+
+    RepOrder order_;
+    int8_t dir_;          // 0: still, no phase open
+    Phase cur_;           // open phase; endMm/endUs/endMs track its extreme
+    float anchor_mm_;     // where the bar last stood still
+    uint32_t anchor_us_;
+    uint32_t anchor_ms_;
+    bool has_anchor_;
+    bool still_;
+    uint32_t still_since_us_;
+    bool has_first_;
+    Phase first_;         // completed opening phase waiting for its partner
+    uint16_t rep_count_;
+};
+
+} // namespace app
+} // namespace liftrr
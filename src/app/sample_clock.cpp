@@ -0,0 +1,156 @@
+#include "app/sample_clock.h"
+
+#include "core/rtc.h"
+
+namespace liftrr {
+namespace app {
+
+namespace {
+
+// Shortest-path interpolation so a ±180° crossing does not sweep the circle.
+float lerpAngle(float a, float b, float alpha) {
+    float d = b - a;
+    if (d > 180.0f) d -= 360.0f;
+    if (d < -180.0f) d += 360.0f;
+    return a + d * alpha;
+}
+
+} // namespace
+
+SampleClock::SampleClock()
+    : running_(false),
+      have_prev_(false),
+      prev_(),
+      period_us_(0),
+      grid_start_us_(0),
+      tick_(0),
+      base_ms_(0),
+      last_dist_us_(0),
+      last_imu_us_(0),
+      jitter_sum_us_(0),
+      jitter_count_(0),
+      stats_() {}
+
+void SampleClock::start(uint16_t rateHz) {
+    if (!liftrr::storage::isSupportedSampleRate(rateHz)) {
+        rateHz = (uint16_t)(1000 / LOG_INTERVAL);
+    }
+    running_ = true;
+    have_prev_ = false;
+    period_us_ = 1000000UL / rateHz;
+    last_dist_us_ = 0;
+    jitter_sum_us_ = 0;
+    jitter_count_ = 0;
+    memset(&stats_, 0, sizeof(stats_));
+    stats_.rateHz = rateHz;
+}
+
+void SampleClock::stop() {
+    running_ = false;
+    have_prev_ = false;
+}
+
+bool SampleClock::running() const {
+    return running_;
+}
+
+void SampleClock::gap() {
+    if (!have_prev_) return;
+    have_prev_ = false;
+    stats_.resyncs++;
+}
+
+const liftrr::storage::SessionSampleStats &SampleClock::stats() const {
+    return stats_;
+}
+
+void SampleClock::restart(const liftrr::sensors::SensorRecord &rec) {
+    // Anchor the grid on this record; rows are then exactly period apart.
+    int64_t epoch = liftrr::core::currentEpochMs();
+    base_ms_ = (epoch > 0)
+        ? epoch - (int64_t)((uint32_t)(micros() - rec.sampleUs) / 1000UL)
+        : (int64_t)rec.sampleMs;
+    grid_start_us_ = rec.sampleUs;
+    tick_ = 0;
+    prev_ = rec;
+    have_prev_ = true;
+}
+
+void SampleClock::push(const liftrr::sensors::SensorRecord &rec, GridRowSink sink) {
+    if (!running_) return;
+
+    if (have_prev_) {
+        uint32_t intervalUs = rec.sampleUs - prev_.sampleUs;
+        if (intervalUs > RESYNC_GAP_US) {
+            have_prev_ = false;
+            stats_.resyncs++;
+        } else {
+            uint32_t nominalUs = SENSOR_TASK_PERIOD_MS * 1000UL;
+            uint32_t jitterUs = intervalUs > nominalUs ? intervalUs - nominalUs : nominalUs - intervalUs;
+            jitter_sum_us_ += jitterUs;
+            jitter_count_++;
+            if (jitterUs > stats_.jitterMaxUs) stats_.jitterMaxUs = jitterUs;
+            stats_.jitterMeanUs = (uint32_t)(jitter_sum_us_ / jitter_count_);
+        }
+    }
+    if (!have_prev_) restart(rec);
+    if (rec.sample.imuFresh || rec.sampleUs == grid_start_us_) last_imu_us_ = rec.sampleUs;
+
+    for (;;) {
+        uint32_t tickUs = grid_start_us_ + tick_ * period_us_;
+        if ((int32_t)(rec.sampleUs - tickUs) < 0) break;
+        emitTick(prev_, rec, tickUs, sink);
+        tick_++;
+    }
+    prev_ = rec;
+}
+
+void SampleClock::emitTick(const liftrr::sensors::SensorRecord &a,
+                           const liftrr::sensors::SensorRecord &b,
+                           uint32_t tickUs,
+                           GridRowSink sink) {
+    GridRow row;
+    row.timestampMs = base_ms_ + (int64_t)tick_ * (period_us_ / 1000UL);
+    row.flags = (tick_ == 0) ? liftrr::storage::RECORD_FLAG_RESYNC : 0;
+
+    uint32_t spanUs = b.sampleUs - a.sampleUs;
+    uint32_t intoUs = tickUs - a.sampleUs;
+    bool imuStale = (b.sampleUs - last_imu_us_) > MAX_INTERP_GAP_US;
+    if (imuStale) {
+        row.pose = b.pose;
+        row.flags |= liftrr::storage::RECORD_FLAG_IMU_HELD;
+        stats_.heldRows++;
+    } else if (spanUs == 0 || intoUs >= spanUs) {
+        row.pose = b.pose;
+    } else if (spanUs <= MAX_INTERP_GAP_US) {
+        float alpha = (float)intoUs / (float)spanUs;
+        row.pose.relRoll = lerpAngle(a.pose.relRoll, b.pose.relRoll, alpha);
+        row.pose.relPitch = lerpAngle(a.pose.relPitch, b.pose.relPitch, alpha);
+        row.pose.relYaw = lerpAngle(a.pose.relYaw, b.pose.relYaw, alpha);
+        if (row.pose.relYaw > 180.0f) row.pose.relYaw -= 360.0f;
+        if (row.pose.relYaw < -180.0f) row.pose.relYaw += 360.0f;
+        row.pose.dispMm = a.pose.dispMm + (b.pose.dispMm - a.pose.dispMm) * alpha;
+        row.pose.velMmS = a.pose.velMmS + (b.pose.velMmS - a.pose.velMmS) * alpha;
+        row.pose.accelMmS2 = a.pose.accelMmS2 + (b.pose.accelMmS2 - a.pose.accelMmS2) * alpha;
+    } else {
+        row.pose = a.pose;
+        row.flags |= liftrr::storage::RECORD_FLAG_IMU_HELD;
+        stats_.heldRows++;
+    }
+
+    // Distance: the latest laser measurement taken at or before the tick.
+    const liftrr::sensors::SensorRecord &src =
+        ((int32_t)(tickUs - b.sample.distUs) >= 0) ? b : a;
+    row.rawDist = src.sample.rawDist;
+    row.pose.relDist = src.pose.relDist;
+    if (src.sample.distUs != last_dist_us_) {
+        row.flags |= liftrr::storage::RECORD_FLAG_DIST_FRESH;
+        last_dist_us_ = src.sample.distUs;
+    }
+
+    stats_.rows++;
+    sink(row);
+}
+
+} // namespace app
+} // namespace liftrr
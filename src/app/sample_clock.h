@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "core/function_ref.h"
+#include "sensors/sensor_task.h"
+#include "storage/session_format.h"
+
+namespace liftrr {
+namespace app {
+
+// One row on the fixed logging grid.
+struct GridRow {
+    int64_t timestampMs;  // session time base + tick * period, exact
+    int16_t rawDist;
+    liftrr::sensors::RelativePose pose;
+    uint16_t flags;       // storage RECORD_FLAG_* bits
+};
+
+typedef liftrr::core::FunctionRef<void(const GridRow &)> GridRowSink;
+
+// Resamples sensor-task records onto a fixed-rate grid (20/50/100 Hz).
+// Angles are interpolated between the records bracketing each tick, or held
+// (RECORD_FLAG_IMU_HELD) when the records are too far apart or the IMU has
+// not produced a fresh reading for that long. Distance is
+// sample-and-hold on the laser's own timestamp; RECORD_FLAG_DIST_FRESH marks
+// the first row carrying a new measurement. Loop task only.
+class SampleClock {
+public:
+    SampleClock();
+
+    void start(uint16_t rateHz);
+    void stop();
+    bool running() const;
+
+    // Feeds the next record (in order) and emits every grid tick up to it.
+    void push(const liftrr::sensors::SensorRecord &rec, GridRowSink sink);
+
+    // A record that must not be logged breaks the series; the grid restarts
+    // at the next pushed record.
+    void gap();
+
+    const liftrr::storage::SessionSampleStats &stats() const;
+
+private:
+    void restart(const liftrr::sensors::SensorRecord &rec);
+    void emitTick(const liftrr::sensors::SensorRecord &a,
+                  const liftrr::sensors::SensorRecord &b,
+                  uint32_t tickUs,
+                  GridRowSink sink);
+
+    bool running_;
+    bool have_prev_;
+    liftrr::sensors::SensorRecord prev_;
+    uint32_t period_us_;
+    uint32_t grid_start_us_;
+    uint32_t tick_;
+    int64_t base_ms_;
+    uint32_t last_dist_us_;
+    uint32_t last_imu_us_;  // sampleUs of the newest record with a fresh IMU read
+    uint64_t jitter_sum_us_;
+    uint32_t jitter_count_;
+    liftrr::storage::SessionSampleStats stats_;
+
+    static const uint32_t MAX_INTERP_GAP_US = 3 * SENSOR_TASK_PERIOD_MS * 1000UL;
+    static const uint32_t RESYNC_GAP_US = 1000000UL;
+};
+
+} // namespace app
+} // namespace liftrr
@@ -1,9 +1,12 @@
 #include "serial_commands.h"
 
-#include <functional>
 #include <ArduinoJson.h>
 
 #include "ble/ble_app_internal.h"
+#include "ble/ble_protocol_ids.h"
+#include "core/i2c_bus.h"
+#include "core/json_arena.h"
+#include "core/log.h"
 #include "core/rtc.h"
 #include <SD.h>
 
@@ -13,12 +16,37 @@ namespace app {
 SerialCommandHandler::SerialCommandHandler(liftrr::core::RuntimeState &runtime,
                                            liftrr::storage::StorageManager &storage,
                                            liftrr::sensors::SensorManager &sensors,
+                                           liftrr::sensors::SensorTask &sensorTask,
+                                           DisplayManager &display,
                                            liftrr::comm::BtClassicManager &btClassic)
     : runtime_(runtime),
       storage_(storage),
       sensors_(sensors),
+      sensor_task_(sensorTask),
+      display_(display),
       bt_classic_(btClassic),
-      pending_session_start_(false) {}
+      pending_session_start_(false),
+      pending_session_id_(),
+      pending_lift_(),
+      pending_options_(),
+      line_len_(0),
+      line_overflow_(false),
+      command_allocs_() {}
+
+// Serial output is only written from the loop task.
+static char gSerialTxBuf[SERIAL_LINE_MAX_BYTES];
+
+static void writeSerialLine(JsonDocument &doc) {
+    liftrr::core::LogConsoleGuard console;
+    size_t len = measureJson(doc);
+    if (len < sizeof(gSerialTxBuf)) {
+        serializeJson(doc, gSerialTxBuf, sizeof(gSerialTxBuf));
+        Serial.write(reinterpret_cast<const uint8_t *>(gSerialTxBuf), len);
+    } else {
+        serializeJson(doc, Serial);
+    }
+    Serial.println();
+}
 
 static void sendSerialResp(
         const char *name,
@@ -26,10 +54,12 @@ static void sendSerialResp(
         bool ok,
         const char *code,
         const char *msg,
-        const std::function<void(JsonObject)> &fillBody) {
-    JsonDocument resp;
+        liftrr::ble::BodyFiller fillBody) {
+    char id[12];
+    liftrr::ble::formatMessageId(id);
+    JsonDocument resp(&liftrr::core::messageArena());
     resp["v"]    = 1;
-    resp["id"]   = String(millis());
+    resp["id"]   = id;
     int64_t epoch = liftrr::core::currentEpochMs();
     resp["ts"]   = (epoch > 0) ? epoch : (int64_t)millis();
     resp["src"]  = "device";
@@ -44,16 +74,17 @@ static void sendSerialResp(
     JsonObject body = resp["body"].to<JsonObject>();
     if (fillBody) fillBody(body);
 
-    serializeJson(resp, Serial);
-    Serial.println();
+    writeSerialLine(resp);
 }
 
 static void sendSerialEvt(
         const char *name,
-        const std::function<void(JsonObject)> &fillBody) {
-    JsonDocument evt;
+        liftrr::ble::BodyFiller fillBody) {
+    char id[12];
+    liftrr::ble::formatMessageId(id);
+    JsonDocument evt(&liftrr::core::messageArena());
     evt["v"]    = 1;
-    evt["id"]   = String(millis());
+    evt["id"]   = id;
     int64_t epoch = liftrr::core::currentEpochMs();
     evt["ts"]   = (epoch > 0) ? epoch : (int64_t)millis();
     evt["src"]  = "device";
@@ -64,8 +95,7 @@ static void sendSerialEvt(
     JsonObject body = evt["body"].to<JsonObject>();
     if (fillBody) fillBody(body);
 
-    serializeJson(evt, Serial);
-    Serial.println();
+    writeSerialLine(evt);
 }
 
 static const char* readStr(JsonObject body, JsonDocument &doc, const char *key, const char *defVal) {
@@ -87,8 +117,9 @@ static void applyPhoneEpoch(JsonObject body, JsonDocument &doc) {
 
 void SerialCommandHandler::clearPendingSession() {
     pending_session_start_ = false;
-    pending_session_id_ = "";
-    pending_lift_ = "";
+    pending_session_id_[0] = '\0';
+    pending_lift_[0] = '\0';
+    pending_options_ = liftrr::storage::SessionOptions();
 }
 
 void SerialCommandHandler::processPendingSession() {
@@ -98,16 +129,20 @@ void SerialCommandHandler::processPendingSession() {
     if (!sensors_.isCalibrated() || !sensors_.laserValid()) return;
 
     storage_.startSession(pending_session_id_,
-                          pending_lift_.length() ? pending_lift_.c_str() : "unknown",
+                          pending_lift_[0] ? pending_lift_ : "unknown",
                           sensors_.laserOffset(),
                           sensors_.rollOffset(),
                           sensors_.pitchOffset(),
-                          sensors_.yawOffset());
+                          sensors_.yawOffset(),
+                          pending_options_);
 
     sendSerialEvt("session.started", [&](JsonObject out) {
         out["sessionId"] = pending_session_id_;
         out["lift"]      = pending_lift_;
         out["auto"]      = true;
+        out["format"]    = liftrr::storage::sessionFormatName(pending_options_.format);
+        out["rateHz"]    = pending_options_.sampleRateHz;
+        out["changeLog"] = pending_options_.changeLog.enabled;
     });
 
     clearPendingSession();
@@ -123,18 +158,18 @@ void SerialCommandHandler::handleSerialCommands(MotionState &motionState) {
     // {"id":"2","name":"capabilities.get","body":{}}
     // {"id":"3","name":"time.sync","body":{"phoneEpochMs":1710000000000}}
     // {"id":"4","name":"mode.set","body":{"mode":"RUN"}}   // RUN|IDLE|DUMP
-    // {"id":"5","name":"session.start","body":{"lift":"deadlift","sessionId":"optional"}}
+    // {"id":"5","name":"session.start","body":{"lift":"deadlift","format":"binary","rateHz":100,"expectedDurationS":600}}
     // {"id":"6","name":"session.end","body":{}}
-    // {"id":"7","name":"sessions.list","body":{"cursor":0,"limit":15}}
+    // {"id":"7","name":"sessions.list","body":{"cursor":0,"limit":"all"}}   // limit: N|"all"
     // {"id":"8","name":"session.stream","body":{"sessionId":"1710000000000"}}
     // {"id":"9","name":"sessions.clear","body":{}}
+    // {"id":"10","name":"log.config","body":{"levels":{"storage":"debug"}}}
     // Notes: use "Newline" line ending; send one JSON per line.
-    if (Serial.peek() == '{') {
-        String line = Serial.readStringUntil('\n');
-        line.trim();
-        if (line.length()) {
-            handleJsonCommand(line);
-        }
+
+    // Keep drained log lines out of responses and console dumps.
+    liftrr::core::LogConsoleGuard console;
+    if (line_len_ > 0 || line_overflow_ || Serial.peek() == '{') {
+        readJsonLine();
         return;
     }
 
@@ -161,7 +196,8 @@ void SerialCommandHandler::handleSerialCommands(MotionState &motionState) {
         case 's': {
             // Start a session with a simple auto-generated ID
             int64_t epoch = liftrr::core::currentEpochMs();
-            String sid = storage_.buildSessionId("lift", epoch);
+            char sid[liftrr::storage::SESSION_NAME_BYTES];
+            storage_.buildSessionId("lift", epoch, sid, sizeof(sid));
             if (storage_.isSessionActive()) {
                 Serial.println("Session already active, cannot start new one.");
                 break;
@@ -198,16 +234,9 @@ void SerialCommandHandler::handleSerialCommands(MotionState &motionState) {
                 break;
             }
 
-            Serial.println("--- /sessions/index.ndjson ---");
-            File idx = SD.open("/sessions/index.ndjson", FILE_READ);
-            if (idx) {
-                while (idx.available()) {
-                    String line = idx.readStringUntil('\n');
-                    line.trim();
-                    if (line.length()) Serial.println(line);
-                }
-                idx.close();
-            } else {
+            Serial.println("--- /sessions/index.bin (as NDJSON) ---");
+            size_t indexCount = 0;
+            if (!storage_.writeSessionIndexNdjson(Serial, &indexCount)) {
                 Serial.println("(missing)");
             }
 
@@ -237,6 +266,10 @@ void SerialCommandHandler::handleSerialCommands(MotionState &motionState) {
                 Serial.println("Session active; end it before clearing.");
                 break;
             }
+            if (bt_classic_.isStreaming()) {
+                Serial.println("Classic Bluetooth is streaming; wait before clearing.");
+                break;
+            }
             if (!storage_.clearSessions()) {
                 Serial.println("Failed to clear sessions.");
             } else {
@@ -246,14 +279,71 @@ void SerialCommandHandler::handleSerialCommands(MotionState &motionState) {
         }
 
         case 'd': {
-            liftrr::sensors::SensorSample sample;
-            sensors_.read(sample);
+            liftrr::sensors::SensorRecord latest;
+            if (!sensor_task_.latest(latest)) {
+                Serial.println("No sensor sample yet.");
+                break;
+            }
+            const liftrr::sensors::SensorSample &sample = latest.sample;
             Serial.print("cal: s="); Serial.print(sample.s);
             Serial.print(" g="); Serial.print(sample.g);
             Serial.print(" a="); Serial.print(sample.a);
             Serial.print(" m="); Serial.println(sample.m);
             Serial.print("laserValid="); Serial.print(sensors_.laserValid() ? "1" : "0");
-            Serial.print(" dist="); Serial.println(sample.rawDist);
+            Serial.print(" dist="); Serial.print(sample.rawDist);
+            Serial.print(" distUs="); Serial.println(sample.distUs);
+            liftrr::sensors::DistanceSensorStats laser = sensors_.laserStats();
+            Serial.print("laser: irq="); Serial.print(laser.interruptDriven ? "1" : "0");
+            Serial.print(" samples="); Serial.print(laser.samples);
+            Serial.print(" overruns="); Serial.print(laser.overruns);
+            Serial.print(" missedEdges="); Serial.println(laser.missedEdges);
+            Serial.print("imu: burstErrors="); Serial.println(sensors_.imuErrors());
+            liftrr::core::I2cBus &bus = liftrr::core::i2cBus();
+            uint32_t windowMs = bus.statsWindowMs();
+            for (size_t i = 0; i < (size_t)liftrr::core::I2cDevice::COUNT; i++) {
+                liftrr::core::I2cDevice device = (liftrr::core::I2cDevice)i;
+                liftrr::core::I2cDeviceStats s = bus.stats(device);
+                Serial.print("i2c "); Serial.print(liftrr::core::i2cDeviceName(device));
+                Serial.print(": leases="); Serial.print(s.leases);
+                Serial.print(" busy%="); Serial.print(windowMs ? (float)s.busyUs / (windowMs * 10.0f) : 0.0f, 1);
+                Serial.print(" avgWaitUs="); Serial.print(s.leases ? (uint32_t)(s.waitUs / s.leases) : 0);
+                Serial.print(" maxWaitUs="); Serial.print(s.maxWaitUs);
+                Serial.print(" deadlineMisses="); Serial.print(s.deadlineMisses);
+                Serial.print(" timeouts="); Serial.println(s.timeouts);
+            }
+            liftrr::sensors::SensorTaskStats task = sensor_task_.stats();
+            Serial.print("sensorTask: cycles="); Serial.print(task.cycles);
+            Serial.print(" late="); Serial.print(task.lateCycles);
+            Serial.print(" logOverruns="); Serial.print(task.logOverruns);
+            Serial.print(" maxCycleUs="); Serial.println(task.maxCycleUs);
+            liftrr::sensors::BarEstimatorStats est = sensor_task_.estimatorStats();
+            Serial.print("estimator: disp="); Serial.print(latest.pose.dispMm, 1);
+            Serial.print(" vel="); Serial.print(latest.pose.velMmS, 1);
+            Serial.print(" accel="); Serial.print(latest.pose.accelMmS2, 0);
+            Serial.print(" corrections="); Serial.print(est.corrections);
+            Serial.print(" rejects="); Serial.print(est.rejects);
+            Serial.print(" resets="); Serial.print(est.resets);
+            Serial.print(" sigmaMm="); Serial.print(est.posSigmaMm, 1);
+            Serial.print(" sigmaMmS="); Serial.println(est.velSigmaMmS, 1);
+            const DisplayRenderStats &render = display_.renderStats();
+            Serial.print("render: frames="); Serial.print(render.frames);
+            Serial.print(" templates="); Serial.print(render.templateBuilds);
+            Serial.print(" lastUs="); Serial.print(render.lastRenderUs);
+            Serial.print(" maxUs="); Serial.print(render.maxRenderUs);
+            Serial.print(" lastWidgets="); Serial.println(render.lastWidgets);
+            const DisplayGovernorStats &governor = display_.governorStats();
+            Serial.print("governor: intervalMs="); Serial.print(governor.intervalMs);
+            Serial.print(" framesDue="); Serial.print(governor.framesDue);
+            Serial.print(" budgetSkips="); Serial.println(governor.budgetSkips);
+            const liftrr::ui::OledFlushStats &oled = display_.flushStats();
+            Serial.print("oled: frames="); Serial.print(oled.frames);
+            Serial.print(" lastBytes="); Serial.print(oled.lastBytes);
+            Serial.print(" lastRuns="); Serial.print(oled.lastRuns);
+            Serial.print(" lastPages="); Serial.print(oled.lastPages);
+            Serial.print(" avgBytes="); Serial.print(oled.frames ? (uint32_t)(oled.totalBytes / oled.frames) : 0);
+            Serial.print(" maxBytes="); Serial.print(oled.maxBytes);
+            Serial.print(" lastFlushUs="); Serial.print(oled.lastFlushUs);
+            Serial.print(" errors="); Serial.println(oled.errors);
             Serial.print("isCalibrated="); Serial.println(sensors_.isCalibrated() ? "1" : "0");
             break;
         }
@@ -264,279 +354,391 @@ void SerialCommandHandler::handleSerialCommands(MotionState &motionState) {
     }
 }
 
-void SerialCommandHandler::handleJsonCommand(const String &line) {
-    if (line.length() > 2048) {
-        sendSerialResp("unknown", "", false, "PAYLOAD_TOO_LARGE", "Payload exceeds 2048 bytes", nullptr);
+void SerialCommandHandler::readJsonLine() {
+    // Non-blocking: a partial line stays in line_buf_ until its newline.
+    while (Serial.available()) {
+        char c = (char)Serial.read();
+        if (c != '\n') {
+            if (line_len_ < SERIAL_LINE_MAX_BYTES) {
+                line_buf_[line_len_++] = c;
+            } else {
+                line_overflow_ = true;
+            }
+            continue;
+        }
+
+        while (line_len_ > 0 && isspace((unsigned char)line_buf_[line_len_ - 1])) line_len_--;
+        if (line_overflow_) {
+            sendSerialResp("unknown", "", false, "PAYLOAD_TOO_LARGE", "Payload exceeds 2048 bytes", nullptr);
+        } else if (line_len_ > 0) {
+            line_buf_[line_len_] = '\0';
+            liftrr::core::AllocScope allocScope;
+            handleJsonCommand(line_buf_, line_len_);
+            command_allocs_.record(allocScope.count());
+        }
+        line_len_ = 0;
+        line_overflow_ = false;
         return;
     }
+}
 
-    JsonDocument doc;
-    DeserializationError err = deserializeJson(doc, line);
+void SerialCommandHandler::handleJsonCommand(const char *line, size_t len) {
+    JsonDocument doc(&liftrr::core::requestArena());
+    DeserializationError err = deserializeJson(doc, line, len);
     if (err) {
         sendSerialResp("unknown", "", false, "BAD_JSON", err.c_str(), nullptr);
         return;
     }
 
     const char *nameC = doc["name"] | doc["cmd"] | "";
-    String name = String(nameC);
 
     const char *ref = doc["id"] | "";
     JsonObject body = doc["body"].is<JsonObject>() ? doc["body"].as<JsonObject>() : JsonObject();
     applyPhoneEpoch(body, doc);
 
-    if (name.length() == 0) {
+    if (nameC[0] == '\0') {
         sendSerialResp("unknown", ref, false, "MISSING_NAME", "Missing 'name' (or legacy 'cmd')", nullptr);
         return;
     }
 
-    if (name.equalsIgnoreCase("ping")) {
-        sendSerialResp("ping", ref, true, "OK", "", [&](JsonObject out) {
-            out["uptimeMs"] = (uint32_t)millis();
-            out["epochMs"]  = liftrr::core::currentEpochMs();
-            out["fw"]       = "dev";
-        });
-        return;
-    }
+    switch (liftrr::ble::messageIdForName(nameC)) {
+        case liftrr::ble::MSG_PING: {
+            sendSerialResp("ping", ref, true, "OK", "", [&](JsonObject out) {
+                out["uptimeMs"] = (uint32_t)millis();
+                out["epochMs"]  = liftrr::core::currentEpochMs();
+                out["fw"]       = "dev";
 
-    if (name.equalsIgnoreCase("capabilities.get")) {
-        sendSerialResp("capabilities.get", ref, true, "OK", "", [&](JsonObject out) {
-            JsonObject device = out["device"].to<JsonObject>();
-            device["model"] = "LIFTRR";
-            device["fw"]    = "dev";
-
-            out["maxMtu"] = 185;
-
-            JsonObject features = out["features"].to<JsonObject>();
-            features["time.sync"]     = true;
-            features["mode.set"]      = true;
-            features["session.start"] = true;
-            features["session.end"]   = true;
-            features["sessions.list"] = true;
-            features["session.stream"] = true;
-            features["session.stream.bt_classic"] = true;
-        });
-        return;
-    }
-
-    if (name.equalsIgnoreCase("time.sync")) {
-        int64_t phoneEpoch = readI64(body, doc, "phoneEpochMs", (int64_t)0);
-        if (phoneEpoch <= 0) {
-            sendSerialResp("time.sync", ref, false, "BAD_ARGS", "Missing/invalid phoneEpochMs", nullptr);
+                liftrr::ble::writeHeapStats(out["heap"].to<JsonObject>(), command_allocs_);
+            });
             return;
         }
 
-        liftrr::core::timeSyncSetEpochMs(phoneEpoch);
+        case liftrr::ble::MSG_CAPABILITIES_GET: {
+            sendSerialResp("capabilities.get", ref, true, "OK", "", [&](JsonObject out) {
+                JsonObject device = out["device"].to<JsonObject>();
+                device["model"] = "LIFTRR";
+                device["fw"]    = "dev";
+
+                out["maxMtu"] = 185;
+
+                JsonObject features = out["features"].to<JsonObject>();
+                features["time.sync"]     = true;
+                features["mode.set"]      = true;
+                features["session.start"] = true;
+                features["session.end"]   = true;
+                features["sessions.list"] = true;
+                features["session.stream"] = true;
+                features["session.stream.bt_classic"] = true;
+                features["session.stream.resume"] = true;
+                features["sessions.streamMany"] = true;
+                features["log.config"] = true;
+
+                JsonArray formats = out["sessionFormats"].to<JsonArray>();
+                formats.add("csv");
+                formats.add("binary");
+
+                JsonArray framings = out["streamFramings"].to<JsonArray>();
+                framings.add("raw");
+                framings.add("framed");
+                out["streamFrameVersion"] = liftrr::comm::BT_STREAM_FRAME_VERSION;
+                out["streamChunkSize"]    = (uint32_t)BT_STREAM_CHUNK_SIZE;
+            });
+            return;
+        }
 
-        sendSerialResp("time.sync", ref, true, "OK", "", [&](JsonObject out) {
-            out["epochAtSyncMs"]  = liftrr::core::timeSyncEpochMs();
-            out["millisAtSyncMs"] = liftrr::core::timeSyncMillisMs();
-        });
-        return;
-    }
+        case liftrr::ble::MSG_TIME_SYNC: {
+            int64_t phoneEpoch = readI64(body, doc, "phoneEpochMs", (int64_t)0);
+            if (phoneEpoch <= 0) {
+                sendSerialResp("time.sync", ref, false, "BAD_ARGS", "Missing/invalid phoneEpochMs", nullptr);
+                return;
+            }
 
-    if (name.equalsIgnoreCase("mode.set")) {
-        String modeStr = String(readStr(body, doc, "mode", ""));
+            liftrr::core::timeSyncSetEpochMs(phoneEpoch);
 
-        if (modeStr.length() == 0) {
-            sendSerialResp("mode.set", ref, false, "BAD_ARGS", "Missing mode", nullptr);
+            sendSerialResp("time.sync", ref, true, "OK", "", [&](JsonObject out) {
+                out["epochAtSyncMs"]  = liftrr::core::timeSyncEpochMs();
+                out["millisAtSyncMs"] = liftrr::core::timeSyncMillisMs();
+            });
             return;
         }
 
-        if (!modeStr.equalsIgnoreCase("RUN") &&
-            !modeStr.equalsIgnoreCase("IDLE") &&
-            !modeStr.equalsIgnoreCase("DUMP")) {
-            sendSerialResp("mode.set", ref, false, "BAD_ARGS", "mode must be RUN/IDLE/DUMP", nullptr);
-            return;
-        }
+        case liftrr::ble::MSG_MODE_SET: {
+            const char *modeStr = readStr(body, doc, "mode", "");
 
-        if (modeStr.equalsIgnoreCase("RUN")) {
-            runtime_.setDeviceMode(liftrr::core::MODE_RUN);
-        } else if (modeStr.equalsIgnoreCase("IDLE")) {
-            runtime_.setDeviceMode(liftrr::core::MODE_IDLE);
-        } else if (modeStr.equalsIgnoreCase("DUMP")) {
-            runtime_.setDeviceMode(liftrr::core::MODE_DUMP);
-        } else if (modeStr.equalsIgnoreCase("CALIBRATE")) {
-            runtime_.setDeviceMode(liftrr::core::MODE_CALIBRATE);
-        }
+            if (modeStr[0] == '\0') {
+                sendSerialResp("mode.set", ref, false, "BAD_ARGS", "Missing mode", nullptr);
+                return;
+            }
 
-        sendSerialResp("mode.set", ref, true, "OK", "", [&](JsonObject out) {
-            out["mode"] = modeStr;
-        });
-        return;
-    }
+            if (strcasecmp(modeStr, "RUN") != 0 &&
+                strcasecmp(modeStr, "IDLE") != 0 &&
+                strcasecmp(modeStr, "DUMP") != 0) {
+                sendSerialResp("mode.set", ref, false, "BAD_ARGS", "mode must be RUN/IDLE/DUMP", nullptr);
+                return;
+            }
 
-    if (name.equalsIgnoreCase("session.start")) {
-        if (storage_.isSessionActive()) {
-            sendSerialResp("session.start", ref, false, "ALREADY_ACTIVE", "Session already active", nullptr);
-            return;
-        }
+            if (strcasecmp(modeStr, "RUN") == 0) {
+                runtime_.setDeviceMode(liftrr::core::MODE_RUN);
+            } else if (strcasecmp(modeStr, "IDLE") == 0) {
+                runtime_.setDeviceMode(liftrr::core::MODE_IDLE);
+            } else if (strcasecmp(modeStr, "DUMP") == 0) {
+                runtime_.setDeviceMode(liftrr::core::MODE_DUMP);
+            } else if (strcasecmp(modeStr, "CALIBRATE") == 0) {
+                runtime_.setDeviceMode(liftrr::core::MODE_CALIBRATE);
+            }
 
-        runtime_.setDeviceMode(liftrr::core::MODE_RUN);
-
-        const char *liftC = readStr(body, doc, "lift", "unknown");
-        int64_t e = liftrr::core::currentEpochMs();
-        String sid = storage_.buildSessionId(liftC, e);
-
-        if (!sensors_.isCalibrated() || !sensors_.laserValid()) {
-            pending_session_start_ = true;
-            pending_session_id_ = sid;
-            pending_lift_ = String(liftC);
-
-            sendSerialResp("session.start", ref, false, "CALIBRATION_REQUIRED",
-                           "Calibration required; session will auto-start when ready.",
-                           [&](JsonObject out) {
-                               out["pending"]   = true;
-                               out["sessionId"] = sid;
-                               out["lift"]      = liftC;
-                               out["mode"]      = "RUN";
-                           });
+            sendSerialResp("mode.set", ref, true, "OK", "", [&](JsonObject out) {
+                out["mode"] = modeStr;
+            });
             return;
         }
 
-        storage_.startSession(sid,
-                              liftC,
-                              sensors_.laserOffset(),
-                              sensors_.rollOffset(),
-                              sensors_.pitchOffset(),
-                              sensors_.yawOffset());
-        clearPendingSession();
-
-        sendSerialResp("session.start", ref, true, "OK", "", [&](JsonObject out) {
-            out["sessionId"] = sid;
-            out["lift"]      = liftC;
-            out["mode"]      = "RUN";
-        });
-        return;
-    }
+        case liftrr::ble::MSG_SESSION_START: {
+            if (storage_.isSessionActive()) {
+                sendSerialResp("session.start", ref, false, "ALREADY_ACTIVE", "Session already active", nullptr);
+                return;
+            }
 
-    if (name.equalsIgnoreCase("session.end")) {
-        if (pending_session_start_ && !storage_.isSessionActive()) {
+            liftrr::storage::SessionOptions options;
+            const char *formatC = readStr(body, doc, "format", "csv");
+            if (!liftrr::storage::parseSessionFormat(formatC, &options.format)) {
+                sendSerialResp("session.start", ref, false, "BAD_ARGS", "format must be csv/binary", nullptr);
+                return;
+            }
+            int64_t durationIn = readI64(body, doc, "expectedDurationS", (int64_t)0);
+            if (durationIn > 0) options.expectedDurationS = (uint32_t)durationIn;
+            int64_t rateIn = readI64(body, doc, "rateHz", (int64_t)0);
+            if (rateIn != 0) {
+                if (!liftrr::storage::isSupportedSampleRate(rateIn)) {
+                    sendSerialResp("session.start", ref, false, "BAD_ARGS", "rateHz must be 20/50/100", nullptr);
+                    return;
+                }
+                options.sampleRateHz = (uint16_t)rateIn;
+            }
+            const char *changeLogErr = liftrr::ble::readChangeLogOptions(body, doc, options.changeLog);
+            if (changeLogErr) {
+                sendSerialResp("session.start", ref, false, "BAD_ARGS", changeLogErr, nullptr);
+                return;
+            }
+            const char *formatName = liftrr::storage::sessionFormatName(options.format);
+
+            runtime_.setDeviceMode(liftrr::core::MODE_RUN);
+
+            const char *liftC = readStr(body, doc, "lift", "unknown");
+            int64_t e = liftrr::core::currentEpochMs();
+            char sid[liftrr::storage::SESSION_NAME_BYTES];
+            storage_.buildSessionId(liftC, e, sid, sizeof(sid));
+
+            if (!sensors_.isCalibrated() || !sensors_.laserValid()) {
+                pending_session_start_ = true;
+                snprintf(pending_session_id_, sizeof(pending_session_id_), "%s", sid);
+                snprintf(pending_lift_, sizeof(pending_lift_), "%s", liftC);
+                pending_options_ = options;
+
+                sendSerialResp("session.start", ref, false, "CALIBRATION_REQUIRED",
+                               "Calibration required; session will auto-start when ready.",
+                               [&](JsonObject out) {
+                                   out["pending"]   = true;
+                                   out["sessionId"] = sid;
+                                   out["lift"]      = liftC;
+                                   out["mode"]      = "RUN";
+                                   out["format"]    = formatName;
+                                   out["rateHz"]    = options.sampleRateHz;
+                                   out["changeLog"] = options.changeLog.enabled;
+                               });
+                return;
+            }
+
+            storage_.startSession(sid,
+                                  liftC,
+                                  sensors_.laserOffset(),
+                                  sensors_.rollOffset(),
+                                  sensors_.pitchOffset(),
+                                  sensors_.yawOffset(),
+                                  options);
             clearPendingSession();
-            sendSerialResp("session.end", ref, true, "OK", "Canceled pending session.start", nullptr);
-            return;
-        }
 
-        if (!storage_.isSessionActive()) {
-            sendSerialResp("session.end", ref, false, "NOT_ACTIVE", "No active session", nullptr);
+            sendSerialResp("session.start", ref, true, "OK", "", [&](JsonObject out) {
+                out["sessionId"] = sid;
+                out["lift"]      = liftC;
+                out["mode"]      = "RUN";
+                out["format"]    = formatName;
+                out["rateHz"]    = options.sampleRateHz;
+                out["changeLog"] = options.changeLog.enabled;
+            });
             return;
         }
 
-        storage_.endSession();
-        sendSerialResp("session.end", ref, true, "OK", "", nullptr);
-        return;
-    }
+        case liftrr::ble::MSG_SESSION_END: {
+            if (pending_session_start_ && !storage_.isSessionActive()) {
+                clearPendingSession();
+                sendSerialResp("session.end", ref, true, "OK", "Canceled pending session.start", nullptr);
+                return;
+            }
 
-    if (name.equalsIgnoreCase("sessions.list")) {
-        int64_t cursorIn = readI64(body, doc, "cursor", (int64_t)0);
-        int64_t limitIn = readI64(body, doc, "limit", (int64_t)15);
-        if (cursorIn < 0) cursorIn = 0;
-        if (limitIn <= 0) limitIn = 15;
-        if (limitIn > 15) limitIn = 15;
-
-        size_t nextCursor = (size_t)cursorIn;
-        bool hasMore = false;
-        bool ok = storage_.readSessionIndex(
-            (size_t)cursorIn,
-            (size_t)limitIn,
-            &nextCursor,
-            &hasMore,
-            liftrr::ble::discardSessionIndexItem,
-            nullptr);
-        if (!ok) {
-            sendSerialResp("sessions.list", ref, false, "SD_ERROR", "Failed to read session index", nullptr);
+            if (!storage_.isSessionActive()) {
+                sendSerialResp("session.end", ref, false, "NOT_ACTIVE", "No active session", nullptr);
+                return;
+            }
+
+            storage_.endSession();
+            sendSerialResp("session.end", ref, true, "OK", "", nullptr);
             return;
         }
 
-        sendSerialResp("sessions.list", ref, true, "OK", "", [&](JsonObject out) {
-            JsonArray items = out["items"].to<JsonArray>();
-            liftrr::ble::SessionIndexListCtx ctx{items};
-            storage_.readSessionIndex(
-                (size_t)cursorIn,
-                (size_t)limitIn,
-                &nextCursor,
-                &hasMore,
-                liftrr::ble::appendSessionIndexItem,
-                &ctx);
-            out["nextCursor"] = (uint32_t)nextCursor;
-            out["hasMore"] = hasMore;
-        });
-        return;
-    }
+        case liftrr::ble::MSG_SESSIONS_LIST: {
+            int64_t cursorIn = readI64(body, doc, "cursor", (int64_t)0);
+            if (cursorIn < 0) cursorIn = 0;
+            size_t limit = liftrr::ble::readSessionsListLimit(body, doc);
 
-    if (name.equalsIgnoreCase("session.stream")) {
-        const char *sidC = readStr(body, doc, "sessionId", "");
-        if (!sidC || sidC[0] == '\0') {
-            sendSerialResp("session.stream", ref, false, "BAD_ARGS", "Missing sessionId", nullptr);
-            return;
-        }
+            if (!storage_.ensureSessionIndex()) {
+                sendSerialResp("sessions.list", ref, false, "SD_ERROR", "Failed to read session index", nullptr);
+                return;
+            }
 
-        if (!bt_classic_.isConnected()) {
-            sendSerialResp("session.stream", ref, false, "NO_BT_CLASSIC", "Classic Bluetooth not connected", nullptr);
+            liftrr::ble::writeSessionsListResponse(Serial, storage_, "host", ref, (size_t)cursorIn, limit);
             return;
         }
 
-        if (!storage_.initSd()) {
-            sendSerialResp("session.stream", ref, false, "SD_ERROR", "SD init failed", nullptr);
-            return;
-        }
+        case liftrr::ble::MSG_SESSION_STREAM: {
+            const char *sidC = readStr(body, doc, "sessionId", "");
+            if (!sidC || sidC[0] == '\0') {
+                sendSerialResp("session.stream", ref, false, "BAD_ARGS", "Missing sessionId", nullptr);
+                return;
+            }
 
-        String sessionId = String(sidC);
-        if (sessionId.endsWith(".csv") || sessionId.endsWith(".tmp")) {
-            int dot = sessionId.lastIndexOf('.');
-            if (dot > 0) sessionId = sessionId.substring(0, dot);
-        }
-        String indexedName;
-        if (!storage_.findSessionInIndex(sessionId, indexedName)) {
-            sendSerialResp("session.stream", ref, false, "NOT_FOUND", "Session file not found", nullptr);
-            return;
-        }
+            if (!bt_classic_.isConnected()) {
+                sendSerialResp("session.stream", ref, false, "NO_BT_CLASSIC", "Classic Bluetooth not connected", nullptr);
+                return;
+            }
 
-        String path = String("/sessions/") + indexedName;
-        if (!SD.exists(path)) {
-            sendSerialResp("session.stream", ref, false, "NOT_FOUND", "Indexed file missing on SD", nullptr);
-            return;
-        }
+            if (!storage_.initSd()) {
+                sendSerialResp("session.stream", ref, false, "SD_ERROR", "SD init failed", nullptr);
+                return;
+            }
+
+            char sessionId[liftrr::storage::SESSION_NAME_BYTES];
+            char indexedName[liftrr::storage::SESSION_NAME_BYTES];
+            if (!liftrr::ble::readSessionId(sidC, sessionId, sizeof(sessionId), nullptr) ||
+                !storage_.findSessionInIndex(sessionId, indexedName, sizeof(indexedName))) {
+                sendSerialResp("session.stream", ref, false, "NOT_FOUND", "Session file not found", nullptr);
+                return;
+            }
+
+            char path[liftrr::comm::STREAM_PATH_BYTES];
+            liftrr::comm::streamFilePath(indexedName, path, sizeof(path));
+            if (!SD.exists(path)) {
+                sendSerialResp("session.stream", ref, false, "NOT_FOUND", "Indexed file missing on SD", nullptr);
+                return;
+            }
+
+            File f = SD.open(path, FILE_READ);
+            if (!f) {
+                sendSerialResp("session.stream", ref, false, "SD_ERROR", "Failed to open session file", nullptr);
+                return;
+            }
+            size_t size = f.size();
+            f.close();
+
+            liftrr::comm::StreamOptions streamOptions;
+            const char *rangeErr = liftrr::ble::readStreamOptions(body, doc, size, streamOptions);
+            if (rangeErr) {
+                sendSerialResp("session.stream", ref, false, "BAD_ARGS", rangeErr, nullptr);
+                return;
+            }
+
+            sendSerialResp("session.stream", ref, true, "OK", "", [&](JsonObject out) {
+                out["sessionId"] = sessionId;
+                out["size"] = (uint32_t)size;
+                out["offset"] = (uint32_t)streamOptions.offset;
+                out["length"] = (uint32_t)streamOptions.length;
+                out["framing"] = streamOptions.framed ? "framed" : "raw";
+            });
 
-        File f = SD.open(path, FILE_READ);
-        if (!f) {
-            sendSerialResp("session.stream", ref, false, "SD_ERROR", "Failed to open session file", nullptr);
+            if (!bt_classic_.startFileStream(indexedName, size, sessionId, streamOptions)) {
+                sendSerialEvt("session.file.error", [&](JsonObject out) {
+                    out["sessionId"] = sessionId;
+                    out["code"] = "BT_CLASSIC_STREAM_FAILED";
+                });
+            }
             return;
         }
-        size_t size = f.size();
-        f.close();
 
-        sendSerialResp("session.stream", ref, true, "OK", "", [&](JsonObject out) {
-            out["sessionId"] = sessionId;
-            out["size"] = (uint32_t)size;
-        });
+        case liftrr::ble::MSG_SESSIONS_STREAM_MANY: {
+            if (!bt_classic_.isConnected()) {
+                sendSerialResp("sessions.streamMany", ref, false, "NO_BT_CLASSIC", "Classic Bluetooth not connected", nullptr);
+                return;
+            }
+            liftrr::comm::StreamFile *files = bt_classic_.prepareBatch();
+            if (!files) {
+                sendSerialResp("sessions.streamMany", ref, false, "BT_CLASSIC_BUSY", "Classic Bluetooth is streaming a file", nullptr);
+                return;
+            }
+            if (!storage_.initSd()) {
+                sendSerialResp("sessions.streamMany", ref, false, "SD_ERROR", "SD init failed", nullptr);
+                return;
+            }
 
-        if (!bt_classic_.startFileStream(path, size, sessionId)) {
-            sendSerialEvt("session.file.error", [&](JsonObject out) {
-                out["sessionId"] = sessionId;
-                out["code"] = "BT_CLASSIC_STREAM_FAILED";
+            liftrr::ble::StreamManySelection sel;
+            if (!liftrr::ble::selectStreamManyFiles(body, doc, storage_, files, sel)) {
+                sendSerialResp("sessions.streamMany", ref, false, sel.code, sel.msg, nullptr);
+                return;
+            }
+
+            if (!bt_classic_.startBatchStream(sel.fileCount)) {
+                sendSerialResp("sessions.streamMany", ref, false, "BT_CLASSIC_STREAM_FAILED", "Failed to start Classic stream", nullptr);
+                return;
+            }
+
+            sendSerialResp("sessions.streamMany", ref, true, "SENT_VIA_BT_CLASSIC", "", [&](JsonObject out) {
+                out["fileCount"] = (uint32_t)sel.fileCount;
+                out["missing"] = (uint32_t)sel.missing;
+                if (sel.byCursor) {
+                    out["nextCursor"] = (uint32_t)sel.nextCursor;
+                    out["hasMore"] = sel.hasMore;
+                }
             });
+            return;
         }
-        return;
-    }
 
-    if (name.equalsIgnoreCase("sessions.clear")) {
-        if (storage_.isSessionActive()) {
-            sendSerialResp("sessions.clear", ref, false, "SESSION_ACTIVE",
-                           "End the active session before clearing.", nullptr);
+        case liftrr::ble::MSG_SESSIONS_CLEAR: {
+            if (storage_.isSessionActive()) {
+                sendSerialResp("sessions.clear", ref, false, "SESSION_ACTIVE",
+                               "End the active session before clearing.", nullptr);
+                return;
+            }
+            if (bt_classic_.isStreaming()) {
+                sendSerialResp("sessions.clear", ref, false, "BT_CLASSIC_BUSY", "Classic Bluetooth is streaming a file", nullptr);
+                return;
+            }
+
+            if (!storage_.clearSessions()) {
+                sendSerialResp("sessions.clear", ref, false, "SD_ERROR",
+                               "Failed to clear sessions.", nullptr);
+                return;
+            }
+
+            sendSerialResp("sessions.clear", ref, true, "OK", "", nullptr);
             return;
         }
 
-        if (!storage_.clearSessions()) {
-            sendSerialResp("sessions.clear", ref, false, "SD_ERROR",
-                           "Failed to clear sessions.", nullptr);
+        case liftrr::ble::MSG_LOG_CONFIG: {
+            const char *err = liftrr::ble::applyLogLevels(body, doc);
+            if (err) {
+                sendSerialResp("log.config", ref, false, "BAD_ARGS", err, nullptr);
+                return;
+            }
+            sendSerialResp("log.config", ref, true, "OK", "", [&](JsonObject out) {
+                liftrr::ble::writeLogStatus(out);
+            });
             return;
         }
 
-        sendSerialResp("sessions.clear", ref, true, "OK", "", nullptr);
-        return;
+        default:
+            break;
     }
 
-    sendSerialResp(name.c_str(), ref, false, "UNSUPPORTED", "Command not supported on this firmware", nullptr);
+    sendSerialResp(nameC, ref, false, "UNSUPPORTED", "Command not supported on this firmware", nullptr);
 }
 
 } // namespace app
@@ -1,8 +1,12 @@
 #pragma once
 
+#include "app_display.h"
 #include "app_motion.h"
 #include "comm/bt_classic.h"
+#include "core/alloc_probe.h"
+#include "core/config.h"
 #include "core/globals.h"
+#include "sensors/sensor_task.h"
 #include "sensors/sensors.h"
 #include "storage/storage.h"
 
@@ -14,22 +18,34 @@ public:
     SerialCommandHandler(liftrr::core::RuntimeState &runtime,
                          liftrr::storage::StorageManager &storage,
                          liftrr::sensors::SensorManager &sensors,
+                         liftrr::sensors::SensorTask &sensorTask,
+                         DisplayManager &display,
                          liftrr::comm::BtClassicManager &btClassic);
 
     void handleSerialCommands(MotionState &motionState);
 
 private:
-    void handleJsonCommand(const String &line);
+    void readJsonLine();
+    void handleJsonCommand(const char *line, size_t len);
     void processPendingSession();
     void clearPendingSession();
 
     liftrr::core::RuntimeState &runtime_;
     liftrr::storage::StorageManager &storage_;
     liftrr::sensors::SensorManager &sensors_;
+    liftrr::sensors::SensorTask &sensor_task_;
+    DisplayManager &display_;
     liftrr::comm::BtClassicManager &bt_classic_;
     bool pending_session_start_;
-    String pending_session_id_;
-    String pending_lift_;
+    char pending_session_id_[liftrr::storage::SESSION_NAME_BYTES];
+    char pending_lift_[liftrr::storage::SESSION_LIFT_BYTES];
+    liftrr::storage::SessionOptions pending_options_;
+
+    // One JSON command line, parsed in place; no String per line.
+    char line_buf_[SERIAL_LINE_MAX_BYTES + 1];
+    size_t line_len_;
+    bool line_overflow_;
+    liftrr::core::CommandAllocStats command_allocs_;
 };
 
 } // namespace app
@@ -1,5 +1,7 @@
 #include "ble.h"
 
+#include "core/log.h"
+
 namespace liftrr {
 namespace ble {
 
@@ -12,12 +14,20 @@ const char *const LIFTRR_COMMAND_CHAR_UUID =
 const char *const LIFTRR_STATUS_CHAR_UUID =
     "27746aa3-5fae-44c1-a1eb-65844cc315dc";
 
+// Default ATT MTU until the client negotiates a larger one.
+static const uint16_t kDefaultAttMtu = 23;
+// ATT notification opcode + handle.
+static const size_t kAttNotifyOverhead = 3;
+
+BleManager *BleManager::_instance = nullptr;
+
 // BleCallbacks defaults.
 
 BleCallbacks::~BleCallbacks() = default;
 
-void BleCallbacks::onRawCommand(const std::string &raw) {
-    (void)raw; // default no-op
+void BleCallbacks::onRawCommand(const char *data, size_t len) {
+    (void)data; // default no-op
+    (void)len;
 }
 
 void BleCallbacks::onConnected() {
@@ -39,7 +49,53 @@ BleManager::BleManager()
       _server(nullptr),
       _controlService(nullptr),
       _commandChar(nullptr),
-      _statusChar(nullptr) {}
+      _statusChar(nullptr),
+      _mtu(kDefaultAttMtu),
+      _congested(false),
+      _fragmentation(false),
+      _encoding(BleEncoding::JSON),
+      _txMsgId(0),
+      _txCurLen(0),
+      _txCurFragmented(false),
+      _txCurOffset(0),
+      _txCurFragIdx(0),
+      _txCurActive(false),
+      _txConnGen(0),
+      _connGen(0),
+      _txIssued(0),
+      _txConfirmed(0),
+      _txLastIssueMs(0),
+      _txNotifyFailed(false),
+      _txParkLen(0),
+      _txParkFragmented(false),
+      _rxLen(0),
+      _rxMsgId(0),
+      _rxNextIdx(0),
+      _rxActive(false),
+      _rxOverflow(false),
+      _txQueued(0),
+      _txMessages(0),
+      _txFragments(0),
+      _txCoalesced(0),
+      _txDropped(0),
+      _txParked(0),
+      _txTruncated(0),
+      _txErrors(0),
+      _txRejected(0),
+      _txQueuePeakBytes(0),
+      _congestWaits(0),
+      _confTimeouts(0),
+      _rxMessages(0),
+      _rxFragments(0),
+      _rxErrors(0),
+      _rxOverflows(0) {
+    for (CoalesceSlot &slot : _txCoalesce) {
+        slot.key = 0;
+        slot.pending = false;
+        slot.fragmented = false;
+        slot.len = 0;
+    }
+}
 
 void BleManager::setError(BleError err, const char *msg) {
     _lastError = err;
@@ -57,6 +113,8 @@ BleError BleManager::begin(const BleInitConfig &cfg, BleCallbacks *appCallbacks)
 
     // Initialize the BLE stack
     BLEDevice::init(name);
+    _instance = this;
+    BLEDevice::setCustomGattsHandler(gattsEventHandler);
 
     if (cfg.mtu > 0) {
         BLEDevice::setMTU(cfg.mtu);
@@ -102,6 +160,8 @@ BleError BleManager::begin(const BleInitConfig &cfg, BleCallbacks *appCallbacks)
         return _lastError;
     }
 
+    _statusChar->setCallbacks(this);
+
     // CCCD descriptor so Android can enable notifications
     _statusChar->addDescriptor(new BLE2902());
 
@@ -128,8 +188,11 @@ BleError BleManager::begin(const BleInitConfig &cfg, BleCallbacks *appCallbacks)
 }
 
 void BleManager::loop() {
-    // Currently nothing required here – BLE stack is event-driven.
-    // Keep this for future timeouts / periodic tasks if needed.
+    pumpOutbound();
+    if (_txParkLen && _txResponses.push(_txPark, _txParkLen, _txParkFragmented)) {
+        _txParkLen = 0;
+        pumpOutbound();
+    }
 }
 
 BleError BleManager::lastError() const {
@@ -141,16 +204,251 @@ const String &BleManager::lastErrorMessage() const {
 }
 
 bool BleManager::sendStatus(const String &payload) {
+    return sendStatus(payload.c_str(), payload.length());
+}
+
+bool BleManager::sendStatus(const char *payload, size_t len,
+                            BlePriority priority, uint8_t coalesceKey) {
     if (!_statusChar || !_isConnected) {
         return false;
     }
-    Serial.println("[BLE] Sending status:");
-    Serial.println(payload);
-    _statusChar->setValue(payload.c_str());
-    _statusChar->notify();
+    LIFTRR_LOGD(BLE, "Sending status: %.*s", (int)len, payload);
+    return enqueue(reinterpret_cast<const uint8_t *>(payload), len, priority, coalesceKey);
+}
+
+bool BleManager::sendMessage(const uint8_t *data, size_t len,
+                             BlePriority priority, uint8_t coalesceKey) {
+    if (!_statusChar || !_isConnected) {
+        return false;
+    }
+    LIFTRR_LOGD(BLE, "Sending binary status, bytes=%lu", (unsigned long)len);
+    return enqueue(data, len, priority, coalesceKey);
+}
+
+bool BleManager::enqueue(const uint8_t *data, size_t len,
+                         BlePriority priority, uint8_t coalesceKey) {
+    if (len == 0 || len > BLE_MAX_MESSAGE_BYTES) {
+        _txDropped++;
+        return false;
+    }
+    if (_txConnGen != _connGen) clearOutbound();
+
+    // Framing is fixed per message, so link.config can switch modes while
+    // older messages are still queued.
+    bool fragmented = _fragmentation;
+    bool queued = false;
+    if (priority == BlePriority::EVENT && coalesceKey != 0 && len <= BLE_TX_COALESCE_BYTES) {
+        CoalesceSlot *slot = nullptr;
+        for (CoalesceSlot &s : _txCoalesce) {
+            if (s.key == coalesceKey) { slot = &s; break; }
+            if (!slot && s.key == 0) slot = &s;
+        }
+        if (slot) {
+            if (slot->key == coalesceKey && slot->pending) _txCoalesced++;
+            slot->key = coalesceKey;
+            slot->pending = true;
+            slot->fragmented = fragmented;
+            slot->len = (uint16_t)len;
+            memcpy(slot->data, data, len);
+            queued = true;
+        }
+    }
+
+    if (!queued && priority == BlePriority::RESPONSE) {
+        // Back-pressure without waiting: a response that finds the queue
+        // full is parked for loop() to retry. Responses behind it are
+        // dropped until then, so none overtakes it.
+        if (_txParkLen == 0) {
+            queued = _txResponses.push(data, len, fragmented);
+            if (!queued) {
+                memcpy(_txPark, data, len);
+                _txParkLen = len;
+                _txParkFragmented = fragmented;
+                _txParked++;
+                queued = true;
+            }
+        }
+    } else if (!queued) {
+        // Events make room by dropping the oldest queued event.
+        while (!(queued = _txEvents.push(data, len, fragmented)) && _txEvents.count() > 0) {
+            _txEvents.pop();
+            _txDropped++;
+        }
+    }
+
+    if (!queued) {
+        _txDropped++;
+        return false;
+    }
+    _txQueued++;
+    uint32_t bytes = (uint32_t)(_txResponses.bytesUsed() + _txEvents.bytesUsed());
+    if (bytes > _txQueuePeakBytes) _txQueuePeakBytes = bytes;
+
+    pumpOutbound();
     return true;
 }
 
+void BleManager::clearOutbound() {
+    size_t pending = _txResponses.count() + _txEvents.count() + (_txCurActive ? 1 : 0) +
+                     (_txParkLen ? 1 : 0);
+    for (CoalesceSlot &slot : _txCoalesce) {
+        if (slot.pending) pending++;
+        slot.key = 0;
+        slot.pending = false;
+    }
+    _txDropped += (uint32_t)pending;
+    _txResponses.clear();
+    _txEvents.clear();
+    _txParkLen = 0;
+    _txCurActive = false;
+    _txIssued = _txConfirmed;
+    _txConnGen = _connGen;
+}
+
+uint32_t BleManager::inFlight() const {
+    int32_t n = (int32_t)(_txIssued - _txConfirmed);
+    return n > 0 ? (uint32_t)n : 0;
+}
+
+bool BleManager::loadNextMessage() {
+    size_t len = 0;
+    uint8_t fragmented = 0;
+    const uint8_t *data = _txResponses.front(len, fragmented);
+    if (data) {
+        memcpy(_txCur, data, len);
+        _txResponses.pop();
+    } else if ((data = _txEvents.front(len, fragmented)) != nullptr) {
+        memcpy(_txCur, data, len);
+        _txEvents.pop();
+    } else {
+        CoalesceSlot *slot = nullptr;
+        for (CoalesceSlot &s : _txCoalesce) {
+            if (s.pending) { slot = &s; break; }
+        }
+        if (!slot) return false;
+        len = slot->len;
+        fragmented = slot->fragmented;
+        memcpy(_txCur, slot->data, len);
+        slot->pending = false;
+    }
+
+    _txCurLen = len;
+    _txCurOffset = 0;
+    _txCurFragIdx = 0;
+    _txCurActive = true;
+    _txCurFragmented = fragmented != 0;
+    if (_txCurFragmented) _txMsgId++;
+    return true;
+}
+
+void BleManager::pumpOutbound() {
+    if (_txConnGen != _connGen) clearOutbound();
+    if (!_statusChar || !_isConnected) return;
+
+    // Credits come back with CONF_EVT; don't wait forever for a lost one.
+    if (inFlight() > 0 && millis() - _txLastIssueMs >= BLE_TX_CONF_TIMEOUT_MS) {
+        _confTimeouts++;
+        _txIssued = _txConfirmed;
+    }
+
+    while (inFlight() < BLE_TX_MAX_IN_FLIGHT) {
+        if (_congested) {
+            _congestWaits++;
+            return;
+        }
+        if (!_txCurActive && !loadNextMessage()) return;
+
+        _txNotifyFailed = false;
+
+        if (!_txCurFragmented) {
+            // Without fragmentation the stack cuts the notification at
+            // MTU-3; count it so diag.commands shows the loss.
+            uint16_t mtu = _mtu;
+            if (mtu < kDefaultAttMtu) mtu = kDefaultAttMtu;
+            if (_txCurLen > (size_t)(mtu - kAttNotifyOverhead)) _txTruncated++;
+            _statusChar->setValue(_txCur, _txCurLen);
+            _statusChar->notify();
+            _txCurOffset = _txCurLen;
+        } else {
+            uint16_t mtu = _mtu;
+            if (mtu < kDefaultAttMtu) mtu = kDefaultAttMtu;
+            size_t chunk = mtu - kAttNotifyOverhead - BLE_FRAGMENT_HEADER_BYTES;
+            if (chunk > 512) chunk = 512;
+
+            uint8_t frag[BLE_FRAGMENT_HEADER_BYTES + 512];
+            size_t n = _txCurLen - _txCurOffset;
+            if (n > chunk) n = chunk;
+            bool last = (_txCurOffset + n) >= _txCurLen;
+            frag[0] = _txMsgId;
+            frag[1] = _txCurFragIdx++;
+            frag[2] = last ? BLE_FRAGMENT_FLAG_LAST : 0;
+            memcpy(frag + BLE_FRAGMENT_HEADER_BYTES, _txCur + _txCurOffset, n);
+            _statusChar->setValue(frag, BLE_FRAGMENT_HEADER_BYTES + n);
+            _statusChar->notify();
+            _txCurOffset += n;
+        }
+
+        if (_txNotifyFailed) {
+            _txRejected++;
+        } else {
+            _txIssued++;
+            _txLastIssueMs = millis();
+        }
+        _txFragments++;
+        if (_txCurOffset >= _txCurLen) {
+            _txCurActive = false;
+            _txMessages++;
+        }
+    }
+}
+
+void BleManager::setFragmentation(bool enabled) {
+    _fragmentation = enabled;
+}
+
+bool BleManager::fragmentationEnabled() const {
+    return _fragmentation;
+}
+
+void BleManager::setEncoding(BleEncoding encoding) {
+    _encoding = encoding;
+}
+
+BleEncoding BleManager::encoding() const {
+    return _encoding;
+}
+
+uint16_t BleManager::mtu() const {
+    return _mtu;
+}
+
+BleLinkStats BleManager::linkStats() const {
+    BleLinkStats stats;
+    stats.mtu = _mtu;
+    stats.fragments = _fragmentation;
+    stats.txQueued = _txQueued;
+    stats.txMessages = _txMessages;
+    stats.txFragments = _txFragments;
+    stats.txCoalesced = _txCoalesced;
+    stats.txDropped = _txDropped;
+    stats.txParked = _txParked;
+    stats.txTruncated = _txTruncated;
+    stats.txErrors = _txErrors + _txRejected;
+    stats.txPending = (uint32_t)(_txResponses.count() + _txEvents.count() + (_txCurActive ? 1 : 0) +
+                                 (_txParkLen ? 1 : 0));
+    for (const CoalesceSlot &slot : _txCoalesce) {
+        if (slot.pending) stats.txPending++;
+    }
+    stats.txQueuePeakBytes = _txQueuePeakBytes;
+    stats.congestWaits = _congestWaits;
+    stats.confTimeouts = _confTimeouts;
+    stats.rxMessages = _rxMessages;
+    stats.rxFragments = _rxFragments;
+    stats.rxErrors = _rxErrors;
+    stats.rxOverflows = _rxOverflows;
+    return stats;
+}
+
 bool BleManager::sendSessionsList(const String &payload) {
     return sendStatus(payload);
 }
@@ -167,6 +465,7 @@ bool BleManager::isConnected() const {
 
 void BleManager::onConnect(BLEServer *pServer) {
     (void)pServer;
+    _connGen++;
     _isConnected = true;
     if (_appCallbacks) {
         _appCallbacks->onConnected();
@@ -176,6 +475,12 @@ void BleManager::onConnect(BLEServer *pServer) {
 void BleManager::onDisconnect(BLEServer *pServer) {
     (void)pServer;
     _isConnected = false;
+    _connGen++;
+    _fragmentation = false;
+    _encoding = BleEncoding::JSON;
+    _congested = false;
+    _mtu = kDefaultAttMtu;
+    resetReassembly();
 
     if (_appCallbacks) {
         _appCallbacks->onDisconnected();
@@ -185,9 +490,99 @@ void BleManager::onDisconnect(BLEServer *pServer) {
     BLEDevice::startAdvertising();
 }
 
-void BleManager::handleIncomingCommand(const std::string &data) {
+void BleManager::handleIncomingCommand(const char *data, size_t len) {
     if (_appCallbacks) {
-        _appCallbacks->onRawCommand(data);
+        _appCallbacks->onRawCommand(data, len);
+    }
+}
+
+void BleManager::resetReassembly() {
+    _rxLen = 0;
+    _rxNextIdx = 0;
+    _rxActive = false;
+    _rxOverflow = false;
+}
+
+void BleManager::handleIncomingFragment(const uint8_t *data, size_t len) {
+    if (len < BLE_FRAGMENT_HEADER_BYTES) {
+        _rxErrors++;
+        return;
+    }
+    _rxFragments++;
+
+    uint8_t msgId = data[0];
+    uint8_t idx = data[1];
+    bool last = (data[2] & BLE_FRAGMENT_FLAG_LAST) != 0;
+    data += BLE_FRAGMENT_HEADER_BYTES;
+    len -= BLE_FRAGMENT_HEADER_BYTES;
+
+    if (idx == 0) {
+        if (_rxActive) _rxErrors++;  // previous message never completed
+        resetReassembly();
+        _rxActive = true;
+        _rxMsgId = msgId;
+    } else if (!_rxActive || msgId != _rxMsgId || idx != _rxNextIdx) {
+        _rxErrors++;
+        resetReassembly();
+        return;
+    }
+    _rxNextIdx = idx + 1;
+
+    if (!_rxOverflow) {
+        if (_rxLen + len > sizeof(_rxBuf)) {
+            _rxOverflow = true;
+        } else {
+            memcpy(_rxBuf + _rxLen, data, len);
+            _rxLen += len;
+        }
+    }
+
+    if (!last) return;
+
+    if (_rxOverflow) {
+        _rxOverflows++;
+    } else {
+        _rxMessages++;
+        handleIncomingCommand(reinterpret_cast<const char *>(_rxBuf), _rxLen);
+    }
+    resetReassembly();
+}
+
+void BleManager::gattsEventHandler(esp_gatts_cb_event_t event,
+                                   esp_gatt_if_t gattsIf,
+                                   esp_ble_gatts_cb_param_t *param) {
+    (void)gattsIf;
+    BleManager *self = _instance;
+    if (!self || !param) return;
+
+    switch (event) {
+        case ESP_GATTS_MTU_EVT:
+            self->_mtu = param->mtu.mtu;
+            break;
+        case ESP_GATTS_CONGEST_EVT:
+            self->_congested = param->congest.congested;
+            break;
+        case ESP_GATTS_CONF_EVT:
+            // Sent for notifications too, once Bluedroid has queued (or
+            // failed) each one; returns the credit taken in pumpOutbound().
+            // ESP_GATT_CONGESTED still means the packet was accepted.
+            if (param->conf.status != ESP_GATT_OK && param->conf.status != ESP_GATT_CONGESTED) {
+                self->_txErrors++;
+            }
+            self->_txConfirmed++;
+            break;
+        default:
+            break;
+    }
+}
+
+void BleManager::onStatus(BLECharacteristic *pCharacteristic, Status s, uint32_t code) {
+    (void)code;
+    if (pCharacteristic != _statusChar) return;
+    // Called from inside notify() on the loop task. A failure here never
+    // reaches the stack, so no CONF_EVT will return its credit.
+    if (s == Status::ERROR_GATT || s == Status::ERROR_NO_CLIENT || s == Status::ERROR_NOTIFY_DISABLED) {
+        _txNotifyFailed = true;
     }
 }
 
@@ -196,9 +591,14 @@ void BleManager::onWrite(BLECharacteristic *pCharacteristic) {
         return;
     }
 
-    std::string value = pCharacteristic->getValue();
-    if (!value.empty()) {
-        handleIncomingCommand(value);
+    if (_fragmentation) {
+        handleIncomingFragment(pCharacteristic->getData(), pCharacteristic->getLength());
+        return;
+    }
+
+    size_t len = pCharacteristic->getLength();
+    if (len > 0) {
+        handleIncomingCommand(reinterpret_cast<const char *>(pCharacteristic->getData()), len);
     }
 }
 
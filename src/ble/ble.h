@@ -7,6 +7,9 @@
 #include <BLEServer.h>
 #include <BLEUtils.h>
 #include <BLE2902.h>
+#include <esp_gatts_api.h>
+
+#include "core/config.h"
 
 namespace liftrr {
 namespace ble {
@@ -35,13 +38,138 @@ public:
 
     // Raw command payload received from the phone over the COMMAND characteristic.
     // Implementation in bluetooth.cpp will be a no-op by default.
-    virtual void onRawCommand(const std::string &raw);
+    virtual void onRawCommand(const char *data, size_t len);
 
     // Optional: connection state changes
     virtual void onConnected();
     virtual void onDisconnected();
 };
 
+// Message encoding used on COMMAND/STATUS for the current connection.
+enum class BleEncoding : uint8_t {
+    JSON = 0,
+    MSGPACK
+};
+
+// Outbound queue class. Responses always go before queued events.
+enum class BlePriority : uint8_t {
+    RESPONSE = 0,
+    EVENT
+};
+
+// Link counters for the outbound queue and fragmentation layer.
+struct BleLinkStats {
+    uint16_t mtu;
+    bool fragments;
+    uint32_t txQueued;         // messages accepted by sendStatus/sendMessage
+    uint32_t txMessages;       // messages fully handed to the stack
+    uint32_t txFragments;      // notifications issued
+    uint32_t txCoalesced;      // queued state events replaced by a newer one
+    uint32_t txDropped;        // messages discarded (queue full or link lost)
+    uint32_t txParked;         // responses held back for a full response queue
+    uint32_t txTruncated;      // unfragmented messages cut at MTU-3
+    uint32_t txErrors;         // notifications the stack confirmed with an error
+    uint32_t txPending;        // messages waiting in the queue now
+    uint32_t txQueuePeakBytes;
+    uint32_t congestWaits;     // pump passes held back by congestion
+    uint32_t confTimeouts;     // in-flight notifications never confirmed
+    uint32_t rxMessages;
+    uint32_t rxFragments;
+    uint32_t rxErrors;         // out-of-order or interleaved fragments
+    uint32_t rxOverflows;      // messages above BLE_MAX_MESSAGE_BYTES
+};
+
+// Fragment header used on COMMAND writes and STATUS notifications once a
+// client enables fragmentation (link.config). Each ATT payload is
+//   msgId:u8, fragIdx:u8, flags:u8, then up to MTU-3-3 message bytes;
+// the fragment with BLE_FRAGMENT_FLAG_LAST completes the message.
+static const size_t BLE_FRAGMENT_HEADER_BYTES = 3;
+static const uint8_t BLE_FRAGMENT_FLAG_LAST = 0x01;
+static const size_t BLE_MAX_MESSAGE_BYTES = 2048;
+
+// Variable-length message FIFO over a fixed buffer: each record is a u16
+// length, a caller tag byte and the payload, stored contiguously (a 0xFFFF
+// length or a tail too short for a header means "continue at 0").
+// Loop task only.
+template <size_t N>
+class BleMessageFifo {
+public:
+    BleMessageFifo() : head_(0), tail_(0), count_(0) {}
+
+    // False when the message does not fit; the FIFO is unchanged.
+    bool push(const uint8_t *data, size_t len, uint8_t tag) {
+        size_t need = kHeaderBytes + len;
+        if (len >= kWrapMarker || need > N) return false;
+        if (count_ == 0) head_ = tail_ = 0;
+
+        size_t at;
+        if (count_ > 0 && tail_ <= head_) {
+            if (need > head_ - tail_) return false;
+            at = tail_;
+        } else if (need <= N - tail_) {
+            at = tail_;
+        } else if (need <= head_) {
+            if (N - tail_ >= kHeaderBytes) writeLen(tail_, kWrapMarker);
+            at = 0;
+        } else {
+            return false;
+        }
+
+        writeLen(at, (uint16_t)len);
+        buf_[at + 2] = tag;
+        memcpy(buf_ + at + kHeaderBytes, data, len);
+        tail_ = at + need;
+        count_++;
+        return true;
+    }
+
+    // Oldest message, or nullptr when empty.
+    const uint8_t *front(size_t &len, uint8_t &tag) const {
+        if (count_ == 0) return nullptr;
+        size_t at = recordStart();
+        len = readLen(at);
+        tag = buf_[at + 2];
+        return buf_ + at + kHeaderBytes;
+    }
+
+    void pop() {
+        if (count_ == 0) return;
+        size_t at = recordStart();
+        head_ = at + kHeaderBytes + readLen(at);
+        if (--count_ == 0) head_ = tail_ = 0;
+    }
+
+    void clear() { head_ = tail_ = count_ = 0; }
+    size_t count() const { return count_; }
+
+    // Bytes between head and tail, including any skipped tail space.
+    size_t bytesUsed() const {
+        if (count_ == 0) return 0;
+        return (tail_ > head_) ? tail_ - head_ : N - head_ + tail_;
+    }
+
+private:
+    static const size_t kHeaderBytes = 3;
+    static const uint16_t kWrapMarker = 0xFFFF;
+
+    size_t recordStart() const {
+        if (N - head_ < kHeaderBytes || readLen(head_) == kWrapMarker) return 0;
+        return head_;
+    }
+    uint16_t readLen(size_t at) const {
+        return (uint16_t)(buf_[at] | (buf_[at + 1] << 8));
+    }
+    void writeLen(size_t at, uint16_t len) {
+        buf_[at] = (uint8_t)(len & 0xFF);
+        buf_[at + 1] = (uint8_t)(len >> 8);
+    }
+
+    uint8_t buf_[N];
+    size_t head_;
+    size_t tail_;
+    size_t count_;
+};
+
 // BLE UUIDs.
 extern const char *const LIFTRR_CONTROL_SERVICE_UUID;
 extern const char *const LIFTRR_COMMAND_CHAR_UUID;
@@ -63,9 +191,18 @@ public:
     BleError lastError() const;
     const String &lastErrorMessage() const;
 
-    // Helper: send a status JSON (or any UTF-8 string) to the phone via notifications.
-    // Returns false if not connected or STATUS characteristic not ready.
+    // Helper: queue a status JSON (or any UTF-8 string) for the phone. Sent
+    // from loop() as the link accepts it; responses go before events, and
+    // an event with a non-zero coalesceKey replaces a queued one with the
+    // same key. Returns false if not connected or the message was dropped.
     bool sendStatus(const String &payload);
+    bool sendStatus(const char *payload, size_t len,
+                    BlePriority priority = BlePriority::RESPONSE,
+                    uint8_t coalesceKey = 0);
+    // Binary-safe variant used for MessagePack messages.
+    bool sendMessage(const uint8_t *data, size_t len,
+                     BlePriority priority = BlePriority::RESPONSE,
+                     uint8_t coalesceKey = 0);
 
     // Convenience aliases – logically different, same transport for now.
     bool sendSessionsList(const String &payload);
@@ -73,6 +210,16 @@ public:
 
     bool isConnected() const;
 
+    // Switches COMMAND/STATUS between one-write-per-message and fragments.
+    void setFragmentation(bool enabled);
+    bool fragmentationEnabled() const;
+    uint16_t mtu() const;
+    BleLinkStats linkStats() const;
+
+    // Per-connection response/event encoding; back to JSON on disconnect.
+    void setEncoding(BleEncoding encoding);
+    BleEncoding encoding() const;
+
 protected:
     // BLEServerCallbacks
     void onConnect(BLEServer *pServer) override;
@@ -81,9 +228,25 @@ protected:
     // BLECharacteristicCallbacks – called when phone writes to COMMAND characteristic
     void onWrite(BLECharacteristic *pCharacteristic) override;
 
+    // BLECharacteristicCallbacks – STATUS notify() results
+    void onStatus(BLECharacteristic *pCharacteristic, Status s, uint32_t code) override;
+
 private:
     void setError(BleError err, const char *msg);
-    void handleIncomingCommand(const std::string &data);
+    void handleIncomingCommand(const char *data, size_t len);
+    void handleIncomingFragment(const uint8_t *data, size_t len);
+    void resetReassembly();
+    bool enqueue(const uint8_t *data, size_t len, BlePriority priority, uint8_t coalesceKey);
+    void pumpOutbound();
+    bool loadNextMessage();
+    void clearOutbound();
+    uint32_t inFlight() const;
+
+    // Bluedroid GATTS hook for MTU and congestion events.
+    static void gattsEventHandler(esp_gatts_cb_event_t event,
+                                  esp_gatt_if_t gattsIf,
+                                  esp_ble_gatts_cb_param_t *param);
+    static BleManager *_instance;
 
     BleError _lastError;
     String _lastErrorMessage;
@@ -97,6 +260,65 @@ private:
     BLEService *_controlService;
     BLECharacteristic *_commandChar;
     BLECharacteristic *_statusChar;
+
+    volatile uint16_t _mtu;
+    volatile bool _congested;
+    volatile bool _fragmentation;
+    BleEncoding _encoding;
+    uint8_t _txMsgId;
+
+    // Outbound queue; touched only on the loop task.
+    struct CoalesceSlot {
+        uint8_t key;
+        bool pending;
+        bool fragmented;
+        uint16_t len;
+        uint8_t data[BLE_TX_COALESCE_BYTES];
+    };
+    BleMessageFifo<BLE_TX_RESPONSE_QUEUE_BYTES> _txResponses;
+    BleMessageFifo<BLE_TX_EVENT_QUEUE_BYTES> _txEvents;
+    CoalesceSlot _txCoalesce[BLE_TX_COALESCE_SLOTS];
+    uint8_t _txCur[BLE_MAX_MESSAGE_BYTES];  // message being sent
+    size_t _txCurLen;
+    bool _txCurFragmented;  // framing chosen when the message was queued
+    size_t _txCurOffset;
+    uint8_t _txCurFragIdx;
+    bool _txCurActive;
+    uint32_t _txConnGen;
+    volatile uint32_t _connGen;     // bumped on connect/disconnect
+    uint32_t _txIssued;             // notifications issued (loop task)
+    volatile uint32_t _txConfirmed; // CONF_EVTs received (Bluedroid task)
+    uint32_t _txLastIssueMs;
+    bool _txNotifyFailed;           // set by onStatus() during notify()
+    // One response that found _txResponses full; loop() moves it in.
+    uint8_t _txPark[BLE_MAX_MESSAGE_BYTES];
+    size_t _txParkLen;              // 0 = empty
+    bool _txParkFragmented;
+
+    // Inbound reassembly; touched only on the Bluedroid task.
+    uint8_t _rxBuf[BLE_MAX_MESSAGE_BYTES];
+    size_t _rxLen;
+    uint8_t _rxMsgId;
+    uint8_t _rxNextIdx;
+    bool _rxActive;
+    bool _rxOverflow;
+
+    uint32_t _txQueued;
+    uint32_t _txMessages;
+    uint32_t _txFragments;
+    uint32_t _txCoalesced;
+    uint32_t _txDropped;
+    uint32_t _txParked;
+    uint32_t _txTruncated;
+    volatile uint32_t _txErrors;   // CONF_EVT failures (Bluedroid task)
+    uint32_t _txRejected;          // notify() failures (loop task)
+    uint32_t _txQueuePeakBytes;
+    uint32_t _congestWaits;
+    uint32_t _confTimeouts;
+    volatile uint32_t _rxMessages;
+    volatile uint32_t _rxFragments;
+    volatile uint32_t _rxErrors;
+    volatile uint32_t _rxOverflows;
 };
 
 } // namespace ble
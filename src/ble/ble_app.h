@@ -2,7 +2,10 @@
 
 #include "ble/ble.h"
 #include "comm/bt_classic.h"
+#include "core/alloc_probe.h"
+#include "core/config.h"
 #include "core/globals.h"
+#include "core/spsc_ring.h"
 #include "sensors/sensors.h"
 #include "storage/storage.h"
 
@@ -18,6 +21,17 @@ struct IModeApplier {
   virtual void applyMode(const char* mode) = 0;
 };
 
+// Counters for the BLE command queue. Latency is enqueue to response sent.
+struct BleCommandQueueStats {
+  uint32_t depth;
+  uint32_t maxDepth;
+  uint32_t processed;
+  uint32_t dropped;    // queue full
+  uint32_t oversized;  // payload above kMaxCommandBytes
+  uint32_t maxWaitUs;  // time spent queued
+  uint32_t maxLatencyUs;
+};
+
 class BleApp {
 public:
   BleApp(liftrr::ble::BleManager &ble,
@@ -33,9 +47,33 @@ public:
   void setModeApplier(IModeApplier *applier);
   void notifyFacing(liftrr::sensors::DeviceFacing facing);
   void notifyCalibration(bool imuCalibrated, bool laserValid);
+  // rep.completed; logged tells whether it went into the session's rep table.
+  void notifyRep(const liftrr::storage::SessionRep &rep, bool logged);
+
+  BleCommandQueueStats commandQueueStats() const;
+  const liftrr::core::CommandAllocStats &commandAllocStats() const { return command_allocs_; }
+
+  static const size_t kMaxCommandBytes = 2048;
 
 private:
-  void handleRawCommand(const std::string &raw);
+  // Command copied out of the GATT write callback; executed in loop().
+  struct PendingCommand {
+    uint32_t enqueuedUs;
+    uint32_t len;
+    char data[kMaxCommandBytes];
+  };
+
+  // A write turned away because command_queue_ was full; ref and name are
+  // peeked on the Bluedroid task so the BUSY answer can be correlated.
+  struct RejectedCommand {
+    char ref[24];
+    char name[32];
+  };
+
+  // Called on the Bluedroid task: copy only, never parse or touch SD.
+  void enqueueRawCommand(const char *data, size_t len);
+  void drainCommands();
+  void handleRawCommand(const char *raw, size_t len, uint32_t enqueuedUs);
   void onConnected();
   void onDisconnected();
   void clearPendingSession();
@@ -51,11 +89,25 @@ private:
   BleCallbacks *callbacks_;
   IModeApplier *mode_applier_;
   bool pending_session_start_;
-  String pending_session_id_;
-  String pending_lift_;
+  char pending_session_id_[liftrr::storage::SESSION_NAME_BYTES];
+  char pending_lift_[liftrr::storage::SESSION_LIFT_BYTES];
+  liftrr::storage::SessionOptions pending_options_;
   bool pending_time_sync_;
   uint32_t time_sync_requested_ms_;
 
+  liftrr::core::SpscRing<PendingCommand, BLE_COMMAND_QUEUE_DEPTH> command_queue_;
+  liftrr::core::SpscRing<RejectedCommand, BLE_COMMAND_QUEUE_DEPTH> rejected_commands_;
+  volatile uint32_t commands_dropped_;
+  volatile uint32_t commands_oversized_;
+  volatile bool connect_pending_;
+  volatile bool disconnect_pending_;
+  uint32_t commands_processed_;
+  uint32_t commands_max_depth_;
+  uint32_t commands_max_wait_us_;
+  uint32_t commands_max_latency_us_;
+  uint32_t commands_dropped_reported_;
+  liftrr::core::CommandAllocStats command_allocs_;
+
   static const uint32_t kTimeSyncTimeoutMs = 10000;
 };
 } // namespace ble
@@ -2,7 +2,11 @@
 
 #include <ArduinoJson.h>
 
+#include "ble_protocol_ids.h"
 #include "comm/bt_classic.h"
+#include "core/i2c_bus.h"
+#include "core/json_arena.h"
+#include "core/log.h"
 #include "core/rtc.h"
 #include <SD.h>
 
@@ -29,10 +33,18 @@ public:
         handle(ctx, ref, doc, body);
     }
 
-    bool matches(const String &cmd) const {
-        return equalsIgnoreCase(cmd, name());
+    void recordRun(uint32_t us, uint32_t allocs) {
+        count_++;
+        total_us_ += us;
+        if (us > max_us_) max_us_ = us;
+        allocs_ += allocs;
     }
 
+    uint32_t count() const { return count_; }
+    uint32_t allocs() const { return allocs_; }
+    uint32_t maxLatencyUs() const { return max_us_; }
+    uint32_t avgLatencyUs() const { return count_ ? (uint32_t)(total_us_ / count_) : 0; }
+
 protected:
     virtual void handle(BleCommandContext &ctx, const char *ref, JsonDocument &doc, JsonObject body) = 0;
 
@@ -43,10 +55,14 @@ protected:
         }
     }
 
-    void setPendingSession(BleCommandContext &ctx, const String &sid, const String &lift) const {
+    void setPendingSession(BleCommandContext &ctx,
+                           const char *sid,
+                           const char *lift,
+                           const liftrr::storage::SessionOptions &options) const {
         ctx.app.pending_session_start_ = true;
-        ctx.app.pending_session_id_ = sid;
-        ctx.app.pending_lift_ = lift;
+        snprintf(ctx.app.pending_session_id_, sizeof(ctx.app.pending_session_id_), "%s", sid);
+        snprintf(ctx.app.pending_lift_, sizeof(ctx.app.pending_lift_), "%s", lift);
+        ctx.app.pending_options_ = options;
     }
 
     bool hasPendingSession(BleCommandContext &ctx) const {
@@ -60,12 +76,19 @@ protected:
     void setPendingTimeSync(BleCommandContext &ctx, bool value) const {
         ctx.app.pending_time_sync_ = value;
     }
+
+private:
+    uint32_t count_ = 0;
+    uint32_t allocs_ = 0;
+    uint32_t max_us_ = 0;
+    uint64_t total_us_ = 0;
 };
 
 namespace {
 
 class PingCommand : public BleCommandBase {
 public:
+    static constexpr uint8_t kId = MSG_PING;
     const char *name() const override { return "ping"; }
 
 protected:
@@ -74,12 +97,23 @@ protected:
             out["uptimeMs"] = (uint32_t)millis();
             out["epochMs"]  = liftrr::core::currentEpochMs();
             out["fw"]       = "dev";
+
+            BleCommandQueueStats q = ctx.app.commandQueueStats();
+            JsonObject queue = out["cmdQueue"].to<JsonObject>();
+            queue["depth"]        = q.depth;
+            queue["maxDepth"]     = q.maxDepth;
+            queue["processed"]    = q.processed;
+            queue["dropped"]      = q.dropped;
+            queue["maxLatencyUs"] = q.maxLatencyUs;
+
+            writeHeapStats(out["heap"].to<JsonObject>(), ctx.app.commandAllocStats());
         });
     }
 };
 
 class CapabilitiesCommand : public BleCommandBase {
 public:
+    static constexpr uint8_t kId = MSG_CAPABILITIES_GET;
     const char *name() const override { return "capabilities.get"; }
 
 protected:
@@ -91,6 +125,17 @@ protected:
 
             out["maxMtu"] = 185;
 
+            JsonObject link = out["link"].to<JsonObject>();
+            link["mtu"]                 = ctx.ble.mtu();
+            link["fragments"]           = true;
+            link["fragmentHeaderBytes"] = (uint32_t)BLE_FRAGMENT_HEADER_BYTES;
+            link["maxMessageBytes"]     = (uint32_t)BLE_MAX_MESSAGE_BYTES;
+
+            JsonArray encodings = link["encodings"].to<JsonArray>();
+            encodings.add("json");
+            encodings.add("msgpack");
+            link["encoding"] = ctx.ble.encoding() == BleEncoding::MSGPACK ? "msgpack" : "json";
+
             JsonObject features = out["features"].to<JsonObject>();
             features["time.sync"]     = true;
             features["mode.set"]      = true;
@@ -99,13 +144,27 @@ protected:
             features["sessions.list"] = true;
             features["session.stream"] = true;
             features["session.stream.bt_classic"] = true;
+            features["session.stream.resume"] = true;
+            features["sessions.streamMany"] = true;
             features["sessions.clear"] = true;
+            features["log.config"] = true;
+
+            JsonArray formats = out["sessionFormats"].to<JsonArray>();
+            formats.add("csv");
+            formats.add("binary");
+
+            JsonArray framings = out["streamFramings"].to<JsonArray>();
+            framings.add("raw");
+            framings.add("framed");
+            out["streamFrameVersion"] = liftrr::comm::BT_STREAM_FRAME_VERSION;
+            out["streamChunkSize"]    = (uint32_t)BT_STREAM_CHUNK_SIZE;
         });
     }
 };
 
 class TimeSyncCommand : public BleCommandBase {
 public:
+    static constexpr uint8_t kId = MSG_TIME_SYNC;
     const char *name() const override { return "time.sync"; }
 
 protected:
@@ -129,33 +188,34 @@ protected:
 
 class ModeSetCommand : public BleCommandBase {
 public:
+    static constexpr uint8_t kId = MSG_MODE_SET;
     const char *name() const override { return "mode.set"; }
 
 protected:
     void handle(BleCommandContext &ctx, const char *ref, JsonDocument &doc, JsonObject body) override {
-        String modeStr = String(readStr(body, doc, "mode", ""));
+        const char *modeStr = readStr(body, doc, "mode", "");
 
-        if (modeStr.length() == 0) {
+        if (modeStr[0] == '\0') {
             sendBleResp(ctx.ble, "mode.set", ref, false, "BAD_ARGS", "Missing mode", nullptr);
             return;
         }
 
-        if (!modeStr.equalsIgnoreCase("RUN") &&
-            !modeStr.equalsIgnoreCase("IDLE") &&
-            !modeStr.equalsIgnoreCase("DUMP")) {
+        if (strcasecmp(modeStr, "RUN") != 0 &&
+            strcasecmp(modeStr, "IDLE") != 0 &&
+            strcasecmp(modeStr, "DUMP") != 0) {
             sendBleResp(ctx.ble, "mode.set", ref, false, "BAD_ARGS", "mode must be RUN/IDLE/DUMP", nullptr);
             return;
         }
 
         if (ctx.modeApplier) {
-            ctx.modeApplier->applyMode(modeStr.c_str());
-        } else if (modeStr.equalsIgnoreCase("RUN")) {
+            ctx.modeApplier->applyMode(modeStr);
+        } else if (strcasecmp(modeStr, "RUN") == 0) {
             ctx.runtime.setDeviceMode(liftrr::core::MODE_RUN);
-        } else if (modeStr.equalsIgnoreCase("IDLE")) {
+        } else if (strcasecmp(modeStr, "IDLE") == 0) {
             ctx.runtime.setDeviceMode(liftrr::core::MODE_IDLE);
-        } else if (modeStr.equalsIgnoreCase("DUMP")) {
+        } else if (strcasecmp(modeStr, "DUMP") == 0) {
             ctx.runtime.setDeviceMode(liftrr::core::MODE_DUMP);
-        } else if (modeStr.equalsIgnoreCase("CALIBRATE")) {
+        } else if (strcasecmp(modeStr, "CALIBRATE") == 0) {
             ctx.runtime.setDeviceMode(liftrr::core::MODE_CALIBRATE);
         }
 
@@ -167,6 +227,7 @@ protected:
 
 class SessionStartCommand : public BleCommandBase {
 public:
+    static constexpr uint8_t kId = MSG_SESSION_START;
     const char *name() const override { return "session.start"; }
 
 protected:
@@ -177,16 +238,42 @@ protected:
             return;
         }
 
+        liftrr::storage::SessionOptions options;
+        const char *formatC = readStr(body, doc, "format", "csv");
+        if (!liftrr::storage::parseSessionFormat(formatC, &options.format)) {
+            sendBleResp(ctx.ble, "session.start", ref, false, "BAD_ARGS",
+                        "format must be csv/binary", nullptr);
+            return;
+        }
+        int64_t durationIn = readI64(body, doc, "expectedDurationS", (int64_t)0);
+        if (durationIn > 0) options.expectedDurationS = (uint32_t)durationIn;
+        int64_t rateIn = readI64(body, doc, "rateHz", (int64_t)0);
+        if (rateIn != 0) {
+            if (!liftrr::storage::isSupportedSampleRate(rateIn)) {
+                sendBleResp(ctx.ble, "session.start", ref, false, "BAD_ARGS",
+                            "rateHz must be 20/50/100", nullptr);
+                return;
+            }
+            options.sampleRateHz = (uint16_t)rateIn;
+        }
+        const char *changeLogErr = readChangeLogOptions(body, doc, options.changeLog);
+        if (changeLogErr) {
+            sendBleResp(ctx.ble, "session.start", ref, false, "BAD_ARGS", changeLogErr, nullptr);
+            return;
+        }
+        const char *formatName = liftrr::storage::sessionFormatName(options.format);
+
         if (ctx.modeApplier) ctx.modeApplier->applyMode("RUN");
         else ctx.runtime.setDeviceMode(liftrr::core::MODE_RUN);
 
         const char *liftC = readStr(body, doc, "lift", "unknown");
 
         int64_t e = liftrr::core::currentEpochMs();
-        String sid = ctx.storage.buildSessionId(liftC, e);
+        char sid[liftrr::storage::SESSION_NAME_BYTES];
+        ctx.storage.buildSessionId(liftC, e, sid, sizeof(sid));
 
         if (!ctx.sensors.isCalibrated() || !ctx.sensors.laserValid()) {
-            setPendingSession(ctx, sid, String(liftC));
+            setPendingSession(ctx, sid, liftC, options);
 
             sendBleResp(ctx.ble, "session.start", ref, false, "CALIBRATION_REQUIRED",
                         "Calibration required; session will auto-start when ready.",
@@ -195,6 +282,9 @@ protected:
                             out["sessionId"] = sid;
                             out["lift"]      = liftC;
                             out["mode"]      = "RUN";
+                            out["format"]    = formatName;
+                            out["rateHz"]    = options.sampleRateHz;
+                            out["changeLog"] = options.changeLog.enabled;
                         });
             return;
         }
@@ -204,19 +294,24 @@ protected:
                                  ctx.sensors.laserOffset(),
                                  ctx.sensors.rollOffset(),
                                  ctx.sensors.pitchOffset(),
-                                 ctx.sensors.yawOffset());
+                                 ctx.sensors.yawOffset(),
+                                 options);
         clearPendingSession(ctx);
 
         sendBleResp(ctx.ble, "session.start", ref, true, "OK", "", [&](JsonObject out) {
             out["sessionId"] = sid;
             out["lift"]      = liftC;
             out["mode"]      = "RUN";
+            out["format"]    = formatName;
+            out["rateHz"]    = options.sampleRateHz;
+            out["changeLog"] = options.changeLog.enabled;
         });
     }
 };
 
 class SessionEndCommand : public BleCommandBase {
 public:
+    static constexpr uint8_t kId = MSG_SESSION_END;
     const char *name() const override { return "session.end"; }
 
 protected:
@@ -239,15 +334,14 @@ protected:
 
 class SessionsListCommand : public BleCommandBase {
 public:
+    static constexpr uint8_t kId = MSG_SESSIONS_LIST;
     const char *name() const override { return "sessions.list"; }
 
 protected:
     void handle(BleCommandContext &ctx, const char *ref, JsonDocument &doc, JsonObject body) override {
         int64_t cursorIn = readI64(body, doc, "cursor", (int64_t)0);
-        int64_t limitIn = readI64(body, doc, "limit", (int64_t)15);
         if (cursorIn < 0) cursorIn = 0;
-        if (limitIn <= 0) limitIn = 15;
-        if (limitIn > 15) limitIn = 15;
+        size_t limit = readSessionsListLimit(body, doc);
 
         if (!ctx.btClassic.isConnected()) {
             sendBleResp(ctx.ble, "sessions.list", ref, false, "NO_BT_CLASSIC",
@@ -255,57 +349,34 @@ protected:
             return;
         }
 
-        size_t nextCursor = (size_t)cursorIn;
-        bool hasMore = false;
-        bool ok = ctx.storage.readSessionIndex(
-            (size_t)cursorIn,
-            (size_t)limitIn,
-            &nextCursor,
-            &hasMore,
-            discardSessionIndexItem,
-            nullptr);
-        if (!ok) {
+        Print *link = ctx.btClassic.jsonLineStream();
+        if (!link) {
+            sendBleResp(ctx.ble, "sessions.list", ref, false, "BT_CLASSIC_BUSY",
+                        "Classic Bluetooth is streaming a file", nullptr);
+            return;
+        }
+
+        if (!ctx.storage.ensureSessionIndex()) {
             sendBleResp(ctx.ble, "sessions.list", ref, false, "SD_ERROR",
                         "Failed to read session index", nullptr);
             return;
         }
 
-        JsonDocument resp;
-        resp["v"]    = 1;
-        resp["id"]   = String(millis());
-        int64_t epoch = liftrr::core::currentEpochMs();
-        resp["ts"]   = (epoch > 0) ? epoch : (int64_t)millis();
-        resp["src"]  = "device";
-        resp["dst"]  = "phone";
-        resp["kind"] = "resp";
-        resp["name"] = "sessions.list";
-        if (ref && ref[0] != '\0') resp["ref"] = ref;
-        resp["ok"]   = true;
-        resp["code"] = "OK";
-
-        JsonObject out = resp["body"].to<JsonObject>();
-        JsonArray items = out["items"].to<JsonArray>();
-        SessionIndexListCtx ctxList{items};
-        ctx.storage.readSessionIndex(
-            (size_t)cursorIn,
-            (size_t)limitIn,
-            &nextCursor,
-            &hasMore,
-            appendSessionIndexItem,
-            &ctxList);
-        out["nextCursor"] = (uint32_t)nextCursor;
-        out["hasMore"] = hasMore;
-
-        String payload;
-        serializeJson(resp, payload);
-        ctx.btClassic.sendJsonLine(payload);
-
-        sendBleResp(ctx.ble, "sessions.list", ref, true, "SENT_VIA_BT_CLASSIC", "", nullptr);
+        SessionsListResult result = writeSessionsListResponse(
+            *link, ctx.storage, "phone", ref, (size_t)cursorIn, limit);
+
+        sendBleResp(ctx.ble, "sessions.list", ref, result.ok,
+                    result.ok ? "SENT_VIA_BT_CLASSIC" : "SD_ERROR", "", [&](JsonObject out) {
+            out["count"] = (uint32_t)result.count;
+            out["nextCursor"] = (uint32_t)result.nextCursor;
+            out["hasMore"] = result.hasMore;
+        });
     }
 };
 
 class SessionStreamCommand : public BleCommandBase {
 public:
+    static constexpr uint8_t kId = MSG_SESSION_STREAM;
     const char *name() const override { return "session.stream"; }
 
 protected:
@@ -327,19 +398,22 @@ protected:
             return;
         }
 
-        String sessionId = String(sidC);
-        if (sessionId.endsWith(".csv") || sessionId.endsWith(".tmp")) {
-            int dot = sessionId.lastIndexOf('.');
-            if (dot > 0) sessionId = sessionId.substring(0, dot);
-        }
-
-        String indexedName;
-        if (!ctx.storage.findSessionInIndex(sessionId, indexedName)) {
+        // "<id>.rep" selects the session's rep table instead of its samples.
+        char sessionId[liftrr::storage::SESSION_NAME_BYTES];
+        char indexedName[liftrr::storage::SESSION_NAME_BYTES];
+        bool repTable = false;
+        if (!readSessionId(sidC, sessionId, sizeof(sessionId), &repTable) ||
+            !ctx.storage.findSessionInIndex(sessionId, indexedName, sizeof(indexedName))) {
             sendBleResp(ctx.ble, "session.stream", ref, false, "NOT_FOUND", "Session file not found", nullptr);
             return;
         }
+        if (repTable) {
+            snprintf(indexedName, sizeof(indexedName), "%s%s", sessionId, liftrr::storage::SESSION_REP_EXTENSION);
+            memcpy(sessionId, indexedName, sizeof(sessionId));
+        }
 
-        String path = String("/sessions/") + indexedName;
+        char path[liftrr::comm::STREAM_PATH_BYTES];
+        liftrr::comm::streamFilePath(indexedName, path, sizeof(path));
         if (!SD.exists(path)) {
             sendBleResp(ctx.ble, "session.stream", ref, false, "NOT_FOUND", "Indexed file missing on SD", nullptr);
             return;
@@ -353,12 +427,23 @@ protected:
         size_t size = f.size();
         f.close();
 
+        liftrr::comm::StreamOptions streamOptions;
+        const char *rangeErr = readStreamOptions(body, doc, size, streamOptions);
+        if (rangeErr) {
+            sendBleResp(ctx.ble, "session.stream", ref, false, "BAD_ARGS", rangeErr, nullptr);
+            return;
+        }
+
         sendBleResp(ctx.ble, "session.stream", ref, true, "OK", "", [&](JsonObject out) {
             out["sessionId"] = sessionId;
             out["size"] = (uint32_t)size;
+            out["offset"] = (uint32_t)streamOptions.offset;
+            out["length"] = (uint32_t)streamOptions.length;
+            out["framing"] = streamOptions.framed ? "framed" : "raw";
+            out["reps"] = repTable;
         });
 
-        if (!ctx.btClassic.startFileStream(path, size, sessionId)) {
+        if (!ctx.btClassic.startFileStream(indexedName, size, sessionId, streamOptions)) {
             sendBleEvt(ctx.ble, "session.file.error", [&](JsonObject out) {
                 out["sessionId"] = sessionId;
                 out["code"] = "BT_CLASSIC_STREAM_FAILED";
@@ -367,8 +452,55 @@ protected:
     }
 };
 
+class SessionsStreamManyCommand : public BleCommandBase {
+public:
+    static constexpr uint8_t kId = MSG_SESSIONS_STREAM_MANY;
+    const char *name() const override { return "sessions.streamMany"; }
+
+protected:
+    void handle(BleCommandContext &ctx, const char *ref, JsonDocument &doc, JsonObject body) override {
+        if (!ctx.btClassic.isConnected()) {
+            sendBleResp(ctx.ble, "sessions.streamMany", ref, false, "NO_BT_CLASSIC",
+                        "Classic Bluetooth not connected", nullptr);
+            return;
+        }
+        liftrr::comm::StreamFile *files = ctx.btClassic.prepareBatch();
+        if (!files) {
+            sendBleResp(ctx.ble, "sessions.streamMany", ref, false, "BT_CLASSIC_BUSY",
+                        "Classic Bluetooth is streaming a file", nullptr);
+            return;
+        }
+        if (!ctx.storage.initSd()) {
+            sendBleResp(ctx.ble, "sessions.streamMany", ref, false, "SD_ERROR", "SD init failed", nullptr);
+            return;
+        }
+
+        StreamManySelection sel;
+        if (!selectStreamManyFiles(body, doc, ctx.storage, files, sel)) {
+            sendBleResp(ctx.ble, "sessions.streamMany", ref, false, sel.code, sel.msg, nullptr);
+            return;
+        }
+
+        if (!ctx.btClassic.startBatchStream(sel.fileCount)) {
+            sendBleResp(ctx.ble, "sessions.streamMany", ref, false, "BT_CLASSIC_STREAM_FAILED",
+                        "Failed to start Classic stream", nullptr);
+            return;
+        }
+
+        sendBleResp(ctx.ble, "sessions.streamMany", ref, true, "SENT_VIA_BT_CLASSIC", "", [&](JsonObject out) {
+            out["fileCount"] = (uint32_t)sel.fileCount;
+            out["missing"] = (uint32_t)sel.missing;
+            if (sel.byCursor) {
+                out["nextCursor"] = (uint32_t)sel.nextCursor;
+                out["hasMore"] = sel.hasMore;
+            }
+        });
+    }
+};
+
 class SessionsClearCommand : public BleCommandBase {
 public:
+    static constexpr uint8_t kId = MSG_SESSIONS_CLEAR;
     const char *name() const override { return "sessions.clear"; }
 
 protected:
@@ -378,6 +510,11 @@ protected:
                         "End the active session before clearing.", nullptr);
             return;
         }
+        if (ctx.btClassic.isStreaming()) {
+            sendBleResp(ctx.ble, "sessions.clear", ref, false, "BT_CLASSIC_BUSY",
+                        "Classic Bluetooth is streaming a file", nullptr);
+            return;
+        }
 
         if (!ctx.storage.clearSessions()) {
             sendBleResp(ctx.ble, "sessions.clear", ref, false, "SD_ERROR",
@@ -389,6 +526,76 @@ protected:
     }
 };
 
+class LinkConfigCommand : public BleCommandBase {
+public:
+    static constexpr uint8_t kId = MSG_LINK_CONFIG;
+    const char *name() const override { return "link.config"; }
+
+protected:
+    void handle(BleCommandContext &ctx, const char *ref, JsonDocument &doc, JsonObject body) override {
+        bool fragments = ctx.ble.fragmentationEnabled();
+        BleEncoding encoding = ctx.ble.encoding();
+
+        JsonVariant fragmentsIn = body ? JsonVariant(body["fragments"]) : JsonVariant(doc["fragments"]);
+        if (!fragmentsIn.isNull()) {
+            if (!fragmentsIn.is<bool>()) {
+                sendBleResp(ctx.ble, "link.config", ref, false, "BAD_ARGS", "fragments must be true/false", nullptr);
+                return;
+            }
+            fragments = fragmentsIn.as<bool>();
+        }
+
+        const char *encodingIn = readStr(body, doc, "encoding", "");
+        if (encodingIn[0] != '\0') {
+            if (strcasecmp(encodingIn, "json") == 0) {
+                encoding = BleEncoding::JSON;
+            } else if (strcasecmp(encodingIn, "msgpack") == 0) {
+                encoding = BleEncoding::MSGPACK;
+            } else {
+                sendBleResp(ctx.ble, "link.config", ref, false, "BAD_ARGS", "encoding must be json/msgpack", nullptr);
+                return;
+            }
+        }
+
+        // Answer in the current mode; the switch applies to the next message.
+        sendBleResp(ctx.ble, "link.config", ref, true, "OK", "", [&](JsonObject out) {
+            out["fragments"]       = fragments;
+            out["encoding"]        = encoding == BleEncoding::MSGPACK ? "msgpack" : "json";
+            out["mtu"]             = ctx.ble.mtu();
+            out["maxMessageBytes"] = (uint32_t)BLE_MAX_MESSAGE_BYTES;
+        });
+        ctx.ble.setFragmentation(fragments);
+        ctx.ble.setEncoding(encoding);
+    }
+};
+
+class DiagCommandsCommand : public BleCommandBase {
+public:
+    static constexpr uint8_t kId = MSG_DIAG_COMMANDS;
+    const char *name() const override { return "diag.commands"; }
+
+protected:
+    void handle(BleCommandContext &ctx, const char *ref, JsonDocument &, JsonObject) override;
+};
+
+class LogConfigCommand : public BleCommandBase {
+public:
+    static constexpr uint8_t kId = MSG_LOG_CONFIG;
+    const char *name() const override { return "log.config"; }
+
+protected:
+    void handle(BleCommandContext &ctx, const char *ref, JsonDocument &doc, JsonObject body) override {
+        const char *err = applyLogLevels(body, doc);
+        if (err) {
+            sendBleResp(ctx.ble, "log.config", ref, false, "BAD_ARGS", err, nullptr);
+            return;
+        }
+        sendBleResp(ctx.ble, "log.config", ref, true, "OK", "", [&](JsonObject out) {
+            writeLogStatus(out);
+        });
+    }
+};
+
 static PingCommand kPingCommand;
 static CapabilitiesCommand kCapabilitiesCommand;
 static TimeSyncCommand kTimeSyncCommand;
@@ -397,58 +604,211 @@ static SessionStartCommand kSessionStartCommand;
 static SessionEndCommand kSessionEndCommand;
 static SessionsListCommand kSessionsListCommand;
 static SessionStreamCommand kSessionStreamCommand;
+static SessionsStreamManyCommand kSessionsStreamManyCommand;
 static SessionsClearCommand kSessionsClearCommand;
+static LinkConfigCommand kLinkConfigCommand;
+static DiagCommandsCommand kDiagCommandsCommand;
+static LogConfigCommand kLogConfigCommand;
+
+struct CommandSlot {
+    uint8_t id;
+    BleCommandBase *command;
+};
+
+template <typename T>
+constexpr CommandSlot commandSlot(T &command) {
+    return CommandSlot{T::kId, &command};
+}
 
-static BleCommandBase *const kCommands[] = {
-    &kPingCommand,
-    &kCapabilitiesCommand,
-    &kTimeSyncCommand,
-    &kModeSetCommand,
-    &kSessionStartCommand,
-    &kSessionEndCommand,
-    &kSessionsListCommand,
-    &kSessionStreamCommand,
-    &kSessionsClearCommand,
+// Indexed by message id - 1 (ble_protocol_ids.h); each slot carries its
+// command's kId so a misplaced entry fails to compile.
+static constexpr CommandSlot kCommands[] = {
+    commandSlot(kPingCommand),
+    commandSlot(kCapabilitiesCommand),
+    commandSlot(kTimeSyncCommand),
+    commandSlot(kModeSetCommand),
+    commandSlot(kSessionStartCommand),
+    commandSlot(kSessionEndCommand),
+    commandSlot(kSessionsListCommand),
+    commandSlot(kSessionStreamCommand),
+    commandSlot(kSessionsClearCommand),
+    commandSlot(kSessionsStreamManyCommand),
+    commandSlot(kLinkConfigCommand),
+    commandSlot(kDiagCommandsCommand),
+    commandSlot(kLogConfigCommand),
 };
 
+static constexpr size_t kCommandCount = sizeof(kCommands) / sizeof(kCommands[0]);
+
+constexpr bool commandsInIdOrder(size_t i = 0) {
+    return i >= kCommandCount ? true
+         : kCommands[i].id == i + 1 && commandsInIdOrder(i + 1);
+}
+
+static_assert(kCommandCount == MSG_LAST_COMMAND, "kCommands must list every command id");
+static_assert(commandsInIdOrder(), "kCommands slot i must hold the command with id i + 1");
+
+BleCommandBase *commandForId(uint8_t id) {
+    if (id == MSG_NONE || id > MSG_LAST_COMMAND) return nullptr;
+    return kCommands[id - 1].command;
+}
+
+void DiagCommandsCommand::handle(BleCommandContext &ctx, const char *ref, JsonDocument &, JsonObject) {
+    BleCommandQueueStats q = ctx.app.commandQueueStats();
+    sendBleResp(ctx.ble, "diag.commands", ref, true, "OK", "", [&](JsonObject out) {
+        JsonObject queue = out["queue"].to<JsonObject>();
+        queue["depth"]        = q.depth;
+        queue["capacity"]     = (uint32_t)BLE_COMMAND_QUEUE_DEPTH;
+        queue["maxDepth"]     = q.maxDepth;
+        queue["processed"]    = q.processed;
+        queue["dropped"]      = q.dropped;
+        queue["oversized"]    = q.oversized;
+        queue["maxWaitUs"]    = q.maxWaitUs;
+        queue["maxLatencyUs"] = q.maxLatencyUs;
+
+        BleLinkStats l = ctx.ble.linkStats();
+        JsonObject link = out["link"].to<JsonObject>();
+        link["mtu"]             = l.mtu;
+        link["fragments"]       = l.fragments;
+        link["txQueued"]        = l.txQueued;
+        link["txMessages"]      = l.txMessages;
+        link["txFragments"]     = l.txFragments;
+        link["txCoalesced"]     = l.txCoalesced;
+        link["txDropped"]       = l.txDropped;
+        link["txParked"]        = l.txParked;
+        link["txTruncated"]     = l.txTruncated;
+        link["txErrors"]        = l.txErrors;
+        link["txPending"]       = l.txPending;
+        link["txQueuePeakBytes"] = l.txQueuePeakBytes;
+        link["congestWaits"]    = l.congestWaits;
+        link["confTimeouts"]    = l.confTimeouts;
+        link["rxMessages"]      = l.rxMessages;
+        link["rxFragments"]     = l.rxFragments;
+        link["rxErrors"]        = l.rxErrors;
+        link["rxOverflows"]     = l.rxOverflows;
+
+        liftrr::core::I2cBus &bus = liftrr::core::i2cBus();
+        uint32_t windowMs = bus.statsWindowMs();
+        JsonObject i2c = out["i2c"].to<JsonObject>();
+        i2c["clockHz"]  = (uint32_t)I2C_CLOCK_HZ;
+        i2c["windowMs"] = windowMs;
+        JsonArray devices = i2c["devices"].to<JsonArray>();
+        for (size_t i = 0; i < (size_t)liftrr::core::I2cDevice::COUNT; i++) {
+            liftrr::core::I2cDevice device = (liftrr::core::I2cDevice)i;
+            liftrr::core::I2cDeviceStats s = bus.stats(device);
+            JsonObject item = devices.add<JsonObject>();
+            item["name"]           = liftrr::core::i2cDeviceName(device);
+            item["leases"]         = s.leases;
+            item["busyPermille"]   = windowMs ? (uint32_t)(s.busyUs / windowMs) : 0;
+            item["avgWaitUs"]      = s.leases ? (uint32_t)(s.waitUs / s.leases) : 0;
+            item["maxWaitUs"]      = s.maxWaitUs;
+            item["deadlineMisses"] = s.deadlineMisses;
+            item["timeouts"]       = s.timeouts;
+        }
+
+        JsonArray commands = out["commands"].to<JsonArray>();
+        for (const CommandSlot &slot : kCommands) {
+            BleCommandBase *cmd = slot.command;
+            if (cmd->count() == 0) continue;
+            JsonObject item = commands.add<JsonObject>();
+            item["name"]  = cmd->name();
+            item["count"] = cmd->count();
+            item["avgUs"] = cmd->avgLatencyUs();
+            item["maxUs"] = cmd->maxLatencyUs();
+            item["allocs"] = cmd->allocs();
+        }
+    });
+}
+
 } // namespace
 
-void BleApp::handleRawCommand(const std::string &raw) {
+void BleApp::handleRawCommand(const char *raw, size_t len, uint32_t enqueuedUs) {
     if (!ble_.isConnected()) return;
 
-    if (raw.empty()) return;
-    if (raw.size() > 2048) {
+    if (len == 0) return;
+    if (len > kMaxCommandBytes) {
         sendBleResp(ble_, "unknown", "", false, "PAYLOAD_TOO_LARGE", "Payload exceeds 2048 bytes", nullptr);
         return;
     }
 
-    JsonDocument doc;
-    DeserializationError err = deserializeJson(doc, raw);
-    if (err) {
-        sendBleResp(ble_, "unknown", "", false, "BAD_JSON", err.c_str(), nullptr);
-        return;
+    if ((uint8_t)raw[0] == '{') {
+        LIFTRR_LOGD(BLE, "Command received: %.*s", (int)len, raw);
+    } else {
+        LIFTRR_LOGD(BLE, "Command received: <binary, bytes=%lu>", (unsigned long)len);
     }
 
-    const char *nameC = doc["name"] | doc["cmd"] | "";
-    String name = String(nameC);
-
-    const char *ref = doc["id"] | "";
-    JsonObject body = doc["body"].is<JsonObject>() ? doc["body"].as<JsonObject>() : JsonObject();
+    // Everything below runs out of the static arenas and TX buffer; the
+    // scope counts any heap allocation that still slips in.
+    liftrr::core::AllocScope allocScope;
+    JsonDocument doc(&liftrr::core::requestArena());
+    const char *nameC = "";
+    const char *ref = "";
+    char refBuf[12];
+    uint8_t id = MSG_NONE;
+    JsonObject body;
+
+    // MessagePack requests are arrays (fixarray/array16/array32); JSON
+    // requests are objects. Either is accepted on any connection.
+    uint8_t first = (uint8_t)raw[0];
+    if ((first >= 0x90 && first <= 0x9f) || first == 0xdc || first == 0xdd) {
+        DeserializationError err = deserializeMsgPack(doc, raw, len);
+        if (err) {
+            sendBleResp(ble_, "unknown", "", false, "BAD_MSGPACK", err.c_str(), nullptr);
+            return;
+        }
+        JsonArray env = doc.as<JsonArray>();
+        if (env.size() < 3 || (env[0] | 255) != MSGPACK_KIND_REQ) {
+            sendBleResp(ble_, "unknown", "", false, "BAD_ENVELOPE", "Expected [0, ref, name, body]", nullptr);
+            return;
+        }
+        if (env[1].is<uint32_t>()) {
+            snprintf(refBuf, sizeof(refBuf), "%lu", (unsigned long)env[1].as<uint32_t>());
+            ref = refBuf;
+        } else {
+            ref = env[1] | "";
+        }
+        if (env[2].is<uint32_t>()) {
+            uint32_t wireId = env[2].as<uint32_t>();
+            const char *known = messageNameForId(wireId);
+            if (known) {
+                nameC = known;
+                id = (uint8_t)wireId;
+            }
+        } else {
+            nameC = env[2] | "";
+            id = messageIdForName(nameC);
+        }
+        if (env[3].is<JsonObject>()) body = env[3].as<JsonObject>();
+    } else {
+        DeserializationError err = deserializeJson(doc, raw, len);
+        if (err) {
+            sendBleResp(ble_, "unknown", "", false, "BAD_JSON", err.c_str(), nullptr);
+            return;
+        }
+        nameC = doc["name"] | doc["cmd"] | "";
+        ref = doc["id"] | "";
+        id = messageIdForName(nameC);
+        if (doc["body"].is<JsonObject>()) body = doc["body"].as<JsonObject>();
+    }
 
-    if (name.length() == 0) {
+    if (nameC[0] == '\0') {
         sendBleResp(ble_, "unknown", ref, false, "MISSING_NAME", "Missing 'name' (or legacy 'cmd')", nullptr);
         return;
     }
 
-    BleCommandContext ctx{*this, ble_, runtime_, sensors_, storage_, bt_classic_, mode_applier_};
-    for (BleCommandBase *cmd : kCommands) {
-        if (cmd->matches(name)) {
-            cmd->run(ctx, ref, doc, body);
-            return;
-        }
+    BleCommandBase *cmd = commandForId(id);
+    if (!cmd) {
+        sendBleResp(ble_, nameC, ref, false, "UNSUPPORTED", "Command not supported on this firmware", nullptr);
+        return;
     }
 
-    sendBleResp(ble_, name.c_str(), ref, false, "UNSUPPORTED", "Command not supported on this firmware", nullptr);
+    BleCommandContext ctx{*this, ble_, runtime_, sensors_, storage_, bt_classic_, mode_applier_};
+    cmd->run(ctx, ref, doc, body);
+    uint32_t latencyUs = micros() - enqueuedUs;
+    uint32_t allocs = allocScope.count();
+    cmd->recordRun(latencyUs, allocs);
+    command_allocs_.record(allocs);
+    if (latencyUs > commands_max_latency_us_) commands_max_latency_us_ = latencyUs;
 }
 
 } // namespace ble
@@ -3,6 +3,7 @@
 #include <Arduino.h>
 
 #include "ble.h"
+#include "core/log.h"
 namespace liftrr {
 namespace ble {
 
@@ -10,18 +11,17 @@ class AppBleCallbacks : public BleCallbacks {
 public:
     explicit AppBleCallbacks(BleApp &app) : app_(app) {}
 
-    void onRawCommand(const std::string &raw) override {
-        Serial.println("[BLE] Command received:");
-        Serial.println(raw.c_str());
-        app_.handleRawCommand(raw);
+    // These run on the Bluedroid task; the work is deferred to BleApp::loop().
+    void onRawCommand(const char *data, size_t len) override {
+        app_.enqueueRawCommand(data, len);
     }
 
     void onConnected() override {
-        app_.onConnected();
+        app_.connect_pending_ = true;
     }
 
     void onDisconnected() override {
-        app_.onDisconnected();
+        app_.disconnect_pending_ = true;
     }
 
 private:
@@ -41,10 +41,23 @@ BleApp::BleApp(liftrr::ble::BleManager &ble,
       callbacks_(new AppBleCallbacks(*this)),
       mode_applier_(nullptr),
       pending_session_start_(false),
-      pending_session_id_(""),
-      pending_lift_(""),
+      pending_session_id_(),
+      pending_lift_(),
+      pending_options_(),
       pending_time_sync_(false),
-      time_sync_requested_ms_(0) {}
+      time_sync_requested_ms_(0),
+      command_queue_(),
+      rejected_commands_(),
+      commands_dropped_(0),
+      commands_oversized_(0),
+      connect_pending_(false),
+      disconnect_pending_(false),
+      commands_processed_(0),
+      commands_max_depth_(0),
+      commands_max_wait_us_(0),
+      commands_max_latency_us_(0),
+      commands_dropped_reported_(0),
+      command_allocs_() {}
 
 BleApp::~BleApp() {
     delete callbacks_;
@@ -60,7 +73,7 @@ void BleApp::init() {
 }
 
 void BleApp::onConnected() {
-    Serial.println("[BLE] Client connected");
+    LIFTRR_LOGI(BLE, "Client connected");
     ble_.sendStatus(F("{\"event\":\"CONNECTED\"}"));
     pending_time_sync_ = true;
     time_sync_requested_ms_ = millis();
@@ -77,19 +90,103 @@ void BleApp::onConnected() {
 }
 
 void BleApp::onDisconnected() {
-    Serial.println("[BLE] Client disconnected");
+    LIFTRR_LOGI(BLE, "Client disconnected");
     pending_time_sync_ = false;
 }
 
 void BleApp::clearPendingSession() {
     pending_session_start_ = false;
-    pending_session_id_ = "";
-    pending_lift_ = "";
+    pending_session_id_[0] = '\0';
+    pending_lift_[0] = '\0';
+    pending_options_ = liftrr::storage::SessionOptions();
+}
+
+void BleApp::enqueueRawCommand(const char *data, size_t len) {
+    PendingCommand *slot = command_queue_.prepare();
+    if (!slot) {
+        // If this ring is full too, the drop is still counted and loop()
+        // answers it with an uncorrelated BUSY.
+        RejectedCommand *rejected = rejected_commands_.prepare();
+        if (rejected) {
+            peekRequestRef(data, len,
+                           rejected->ref, sizeof(rejected->ref),
+                           rejected->name, sizeof(rejected->name));
+            rejected_commands_.commit();
+        }
+        commands_dropped_++;
+        return;
+    }
+    slot->enqueuedUs = micros();
+    slot->len = (uint32_t)len;
+    if (len > kMaxCommandBytes) {
+        // Keep the slot so loop() can answer PAYLOAD_TOO_LARGE in order.
+        commands_oversized_++;
+    } else {
+        memcpy(slot->data, data, len);
+    }
+    command_queue_.commit();
+}
+
+void BleApp::drainCommands() {
+    size_t depth = command_queue_.size();
+    if (depth > commands_max_depth_) commands_max_depth_ = (uint32_t)depth;
+
+    // Commands that arrive while draining wait for the next loop pass.
+    for (size_t i = 0; i < depth; i++) {
+        PendingCommand *cmd = command_queue_.front();
+        if (!cmd) break;
+
+        uint32_t waitUs = micros() - cmd->enqueuedUs;
+        if (waitUs > commands_max_wait_us_) commands_max_wait_us_ = waitUs;
+
+        handleRawCommand(cmd->data, cmd->len, cmd->enqueuedUs);
+        command_queue_.pop();
+        commands_processed_++;
+    }
+
+    uint32_t dropped = commands_dropped_;
+    if (dropped != commands_dropped_reported_) {
+        uint32_t unanswered = dropped - commands_dropped_reported_;
+        commands_dropped_reported_ = dropped;
+        LIFTRR_LOGW(BLE, "Command queue full, dropped=%lu", (unsigned long)dropped);
+        RejectedCommand rejected;
+        while (unanswered > 0 && rejected_commands_.pop(rejected)) {
+            sendBleResp(ble_, rejected.name[0] ? rejected.name : "unknown", rejected.ref,
+                        false, "BUSY", "Command queue full; retry", nullptr);
+            unanswered--;
+        }
+        if (unanswered > 0) {
+            sendBleResp(ble_, "unknown", "", false, "BUSY", "Command queue full; retry", nullptr);
+        }
+    }
+}
+
+BleCommandQueueStats BleApp::commandQueueStats() const {
+    BleCommandQueueStats stats;
+    stats.depth = (uint32_t)command_queue_.size();
+    stats.maxDepth = commands_max_depth_;
+    stats.processed = commands_processed_;
+    stats.dropped = commands_dropped_;
+    stats.oversized = commands_oversized_;
+    stats.maxWaitUs = commands_max_wait_us_;
+    stats.maxLatencyUs = commands_max_latency_us_;
+    return stats;
 }
 
 void BleApp::loop() {
     ble_.loop();
 
+    if (disconnect_pending_) {
+        disconnect_pending_ = false;
+        onDisconnected();
+    }
+    if (connect_pending_) {
+        connect_pending_ = false;
+        if (ble_.isConnected()) onConnected();
+    }
+
+    drainCommands();
+
     if (pending_time_sync_ &&
         (millis() - time_sync_requested_ms_) >= kTimeSyncTimeoutMs) {
         pending_time_sync_ = false;
@@ -98,6 +195,36 @@ void BleApp::loop() {
         });
     }
 
+    liftrr::comm::BtClassicManager::StreamStats streamStats;
+    bool streamDone = bt_classic_.takeFinishedStream(streamStats) && ble_.isConnected();
+    if (streamDone && streamStats.batch) {
+        sendBleEvt(ble_, "sessions.streamMany.done", [&](JsonObject out) {
+            out["ok"]          = streamStats.ok;
+            out["fileCount"]   = streamStats.fileCount;
+            out["filesOk"]     = streamStats.filesOk;
+            out["bytesSent"]   = streamStats.bytesSent;
+            out["elapsedMs"]   = streamStats.elapsedMs;
+            out["bytesPerSec"] = streamStats.bytesPerSec;
+            out["sdStallMs"]   = streamStats.sdStallMs;
+            out["linkStallMs"] = streamStats.linkStallMs;
+        });
+    } else if (streamDone) {
+        sendBleEvt(ble_, "session.stream.done", [&](JsonObject out) {
+            out["sessionId"]   = streamStats.sessionId;
+            out["ok"]          = streamStats.ok;
+            out["size"]        = streamStats.size;
+            out["offset"]      = streamStats.offset;
+            out["length"]      = streamStats.length;
+            out["framing"]     = streamStats.framed ? "framed" : "raw";
+            out["bytesSent"]   = streamStats.bytesSent;
+            out["elapsedMs"]   = streamStats.elapsedMs;
+            out["bytesPerSec"] = streamStats.bytesPerSec;
+            out["sdStallMs"]   = streamStats.sdStallMs;
+            out["linkStallMs"] = streamStats.linkStallMs;
+            if (streamStats.framed) out["fileCrc32"] = streamStats.fileCrc32;
+        });
+    }
+
     if (pending_session_start_ &&
         runtime_.deviceMode() == liftrr::core::MODE_RUN &&
         !storage_.isSessionActive() &&
@@ -105,16 +232,20 @@ void BleApp::loop() {
         sensors_.laserValid()) {
 
         storage_.startSession(pending_session_id_,
-                              pending_lift_.length() ? pending_lift_.c_str() : "unknown",
+                              pending_lift_[0] ? pending_lift_ : "unknown",
                               sensors_.laserOffset(),
                               sensors_.rollOffset(),
                               sensors_.pitchOffset(),
-                              sensors_.yawOffset());
+                              sensors_.yawOffset(),
+                              pending_options_);
 
         sendBleEvt(ble_, "session.started", [&](JsonObject out) {
             out["sessionId"] = pending_session_id_;
             out["lift"]      = pending_lift_;
             out["auto"]      = true;
+            out["format"]    = liftrr::storage::sessionFormatName(pending_options_.format);
+            out["rateHz"]    = pending_options_.sampleRateHz;
+            out["changeLog"] = pending_options_.changeLog.enabled;
         });
 
         clearPendingSession();
@@ -156,7 +287,7 @@ void BleApp::notifyFacing(liftrr::sensors::DeviceFacing facing) {
     sendBleEvt(ble_, "orientation.status", [&](JsonObject out) {
         out["facing"] = facingStr;
         out["ok"] = ok;
-    });
+    }, true);
 }
 
 void BleApp::notifyCalibration(bool imuCalibrated, bool laserValid) {
@@ -178,5 +309,25 @@ void BleApp::notifyCalibration(bool imuCalibrated, bool laserValid) {
     });
 }
 
+void BleApp::notifyRep(const liftrr::storage::SessionRep &rep, bool logged) {
+    if (!ble_.isConnected()) return;
+
+    sendBleEvt(ble_, "rep.completed", [&](JsonObject out) {
+        out["rep"]          = rep.index;
+        out["logged"]       = logged;
+        out["startMs"]      = rep.startMs;
+        out["endMs"]        = rep.endMs;
+        out["romMm"]        = rep.romMm;
+        out["meanVelMmS"]   = rep.meanVelMmS;
+        out["peakVelMmS"]   = rep.peakVelMmS;
+        out["concentricMs"] = rep.concentricMs;
+        out["tutMs"]        = rep.tutMs;
+        out["rollMin"]      = rep.rollMinDeg;
+        out["rollMax"]      = rep.rollMaxDeg;
+        out["pitchMin"]     = rep.pitchMinDeg;
+        out["pitchMax"]     = rep.pitchMaxDeg;
+    });
+}
+
 } // namespace ble
 } // namespace liftrr
@@ -2,14 +2,18 @@
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
-#include <functional>
 #include <string>
 
 #include "ble_app.h"
+#include "core/alloc_probe.h"
+#include "core/function_ref.h"
 
 namespace liftrr {
 namespace ble {
 
+// Fills a response/event body. Non-owning, so pass the lambda inline.
+typedef liftrr::core::FunctionRef<void(JsonObject)> BodyFiller;
+
 void sendBleResp(
         liftrr::ble::BleManager &ble,
         const char *name,
@@ -17,30 +21,106 @@ void sendBleResp(
         bool ok,
         const char *code,
         const char *msg,
-        const std::function<void(JsonObject)> &fillBody);
+        BodyFiller fillBody);
 
+// `coalesce` marks superseded state (e.g. orientation.status): a newer
+// event replaces one still waiting in the BLE send queue.
 void sendBleEvt(
         liftrr::ble::BleManager &ble,
         const char *name,
-        const std::function<void(JsonObject)> &fillBody);
+        BodyFiller fillBody,
+        bool coalesce = false);
+
+// Pulls the request ref (JSON "id" / MessagePack ref) and name out of a raw
+// command without parsing it, to answer a write that never reaches the
+// command queue. Bounded scan of `raw`, no allocation, so it may run on the
+// Bluedroid task. Leaves an empty string for anything it cannot find.
+void peekRequestRef(const char *raw, size_t len,
+                    char *ref, size_t refLen,
+                    char *name, size_t nameLen);
+
+// Envelope "id": millis() as a decimal string, without a heap String.
+void formatMessageId(char (&out)[12]);
+
+// ping "heap" object: command-path allocations plus JSON arena usage.
+void writeHeapStats(JsonObject out, const liftrr::core::CommandAllocStats &allocs);
+
+// log.config: applies "levels" ({"ble":"debug",...}) to the async logger.
+// Returns nullptr on success, otherwise a BAD_ARGS message; nothing is
+// changed unless every entry is valid.
+const char *applyLogLevels(JsonObject body, JsonDocument &doc);
 
-bool equalsIgnoreCase(const String &a, const char *b);
+// log.config response body: per-module levels and ring counters.
+void writeLogStatus(JsonObject out);
+
+// session.start "changeLog": true, or {"heartbeatMs","deadbandMm","deadbandDeg"}.
+// Returns nullptr on success (out untouched when absent), otherwise a
+// BAD_ARGS message.
+const char *readChangeLogOptions(JsonObject body, JsonDocument &doc,
+                                 liftrr::storage::SessionChangeLog &out);
 
 struct SessionIndexListCtx {
     JsonArray items;
 };
 
-bool discardSessionIndexItem(const char *,
-                             uint32_t,
-                             uint64_t,
-                             size_t,
-                             void *);
-
-bool appendSessionIndexItem(const char *name,
-                            uint32_t size,
-                            uint64_t mtimeMs,
-                            size_t lineIndex,
-                            void *ctx);
+bool discardSessionIndexItem(const liftrr::storage::SessionIndexEntry &, void *);
+
+bool appendSessionIndexItem(const liftrr::storage::SessionIndexEntry &entry, void *ctx);
+
+struct SessionsListResult {
+    bool ok = false;
+    size_t count = 0;
+    size_t nextCursor = 0;
+    bool hasMore = false;
+};
+
+// Default page size when a sessions.list request omits "limit".
+static const size_t kSessionsListDefaultLimit = 15;
+
+// Reads "limit": a positive count, or "all" for the rest of the index.
+size_t readSessionsListLimit(JsonObject body, JsonDocument &doc);
+
+// Writes one complete sessions.list response line to `out` in a single
+// index pass, serializing each entry as it is read (bounded RAM).
+SessionsListResult writeSessionsListResponse(Print &out,
+                                             liftrr::storage::StorageManager &storage,
+                                             const char *dst,
+                                             const char *ref,
+                                             size_t cursor,
+                                             size_t limit);
+
+// Reads session.stream "offset"/"length"/"framing" ("raw" or "framed").
+// Returns nullptr on success, otherwise a BAD_ARGS message.
+const char *readStreamOptions(JsonObject body,
+                              JsonDocument &doc,
+                              size_t fileSize,
+                              liftrr::comm::StreamOptions &out);
+
+struct StreamManySelection {
+    const char *code = "OK";  // error code when selection fails
+    const char *msg = "";
+    size_t fileCount = 0;     // entries written to files
+    size_t missing = 0;       // requested ids not in the index
+    bool byCursor = false;
+    size_t nextCursor = 0;
+    bool hasMore = false;
+};
+
+// Copies a requested session id into `out` without its .csv/.lrb/.tmp
+// extension. With `repTable` non-null a ".rep" suffix is dropped too and
+// reported there. Returns false if the id is empty or does not fit.
+bool readSessionId(const char *in, char *out, size_t outLen, bool *repTable);
+
+// Resolves sessions.streamMany "ids" (array of session ids) or
+// "sinceCursor" (index record number; finalized sessions only) into
+// `files`, which holds BT_STREAM_MAX_FILES entries (see
+// BtClassicManager::prepareBatch). Returns false with sel.code/msg set on
+// error.
+bool selectStreamManyFiles(JsonObject body,
+                           JsonDocument &doc,
+                           liftrr::storage::StorageManager &storage,
+                           liftrr::comm::StreamFile *files,
+                           StreamManySelection &sel);
 
 const char* readStr(JsonObject body, JsonDocument &doc, const char *key, const char *defVal);
 int64_t readI64(JsonObject body, JsonDocument &doc, const char *key, int64_t defVal);
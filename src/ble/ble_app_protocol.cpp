@@ -1,10 +1,148 @@
 #include "ble_app_internal.h"
 
+#include <Esp.h>
+
+#include "ble_protocol_ids.h"
+#include "core/json_arena.h"
+#include "core/log.h"
 #include "core/rtc.h"
 
 namespace liftrr {
 namespace ble {
 
+namespace {
+
+// All BLE sends happen on the loop task, so one encode buffer is enough.
+uint8_t gBleTxBuf[BLE_MAX_MESSAGE_BYTES];
+
+int64_t envelopeTimestamp() {
+    int64_t epoch = liftrr::core::currentEpochMs();
+    return (epoch > 0) ? epoch : (int64_t)millis();
+}
+
+void addMsgPackName(JsonArray env, const char *name) {
+    uint8_t id = messageIdForName(name);
+    if (id) env.add(id);
+    else env.add(name);
+}
+
+void addMsgPackRef(JsonArray env, const char *ref) {
+    if (!ref || ref[0] == '\0') {
+        env.add<JsonVariant>();
+        return;
+    }
+    size_t len = strlen(ref);
+    bool numeric = len <= 9;
+    for (size_t i = 0; numeric && i < len; i++) {
+        if (ref[i] < '0' || ref[i] > '9') numeric = false;
+    }
+    if (numeric) env.add((uint32_t)strtoul(ref, nullptr, 10));
+    else env.add(ref);
+}
+
+void copyBounded(char *out, size_t outLen, const char *src, size_t srcLen) {
+    if (outLen == 0) return;
+    if (srcLen >= outLen) srcLen = outLen - 1;
+    memcpy(out, src, srcLen);
+    out[srcLen] = '\0';
+}
+
+// Value of the first `"key": <string|number>` in a JSON text.
+bool peekJsonValue(const char *raw, size_t len, const char *key, char *out, size_t outLen) {
+    size_t keyLen = strlen(key);
+    for (size_t i = 0; i + keyLen + 2 <= len; i++) {
+        if (raw[i] != '"' || raw[i + keyLen + 1] != '"' ||
+            memcmp(raw + i + 1, key, keyLen) != 0) {
+            continue;
+        }
+        size_t p = i + keyLen + 2;
+        while (p < len && (raw[p] == ' ' || raw[p] == '\t')) p++;
+        if (p >= len || raw[p] != ':') continue;
+        p++;
+        while (p < len && (raw[p] == ' ' || raw[p] == '\t')) p++;
+        if (p >= len) return false;
+
+        size_t start = p;
+        if (raw[p] == '"') {
+            start = ++p;
+            while (p < len && raw[p] != '"' && raw[p] != '\\') p++;
+            if (p >= len || raw[p] != '"') return false;
+        } else {
+            while (p < len && ((raw[p] >= '0' && raw[p] <= '9') || raw[p] == '-')) p++;
+            if (p == start) return false;
+        }
+        copyBounded(out, outLen, raw + start, p - start);
+        return true;
+    }
+    return false;
+}
+
+// One MessagePack uint/str/nil at raw[p], copied to `out` as text (numbers in
+// decimal, also stored in *number, and flagged via *isNumber). Advances p.
+// False for any other type.
+bool peekMsgPackScalar(const uint8_t *raw, size_t len, size_t &p,
+                       char *out, size_t outLen,
+                       bool *isNumber = nullptr, uint32_t *number = nullptr) {
+    if (isNumber) *isNumber = false;
+    if (p >= len) return false;
+    uint8_t tag = raw[p++];
+    uint32_t value = 0;
+    size_t strLen = 0;
+    if (tag <= 0x7f) {
+        value = tag;
+    } else if (tag == 0xcc || tag == 0xcd || tag == 0xce) {
+        size_t n = (tag == 0xcc) ? 1 : (tag == 0xcd) ? 2 : 4;
+        if (p + n > len) return false;
+        for (size_t i = 0; i < n; i++) value = (value << 8) | raw[p + i];
+        p += n;
+    } else if ((tag & 0xe0) == 0xa0 || tag == 0xd9) {
+        if (tag == 0xd9) {
+            if (p >= len) return false;
+            strLen = raw[p++];
+        } else {
+            strLen = tag & 0x1f;
+        }
+        if (p + strLen > len) return false;
+        copyBounded(out, outLen, reinterpret_cast<const char *>(raw + p), strLen);
+        p += strLen;
+        return true;
+    } else if (tag == 0xc0) {
+        copyBounded(out, outLen, "", 0);
+        return true;
+    } else {
+        return false;
+    }
+    if (outLen) snprintf(out, outLen, "%lu", (unsigned long)value);
+    if (isNumber) *isNumber = true;
+    if (number) *number = value;
+    return true;
+}
+
+void sendEnvelope(liftrr::ble::BleManager &ble,
+                  JsonDocument &doc,
+                  BlePriority priority,
+                  uint8_t coalesceKey) {
+    bool msgpack = ble.encoding() == BleEncoding::MSGPACK;
+    size_t len = msgpack ? measureMsgPack(doc) : measureJson(doc);
+    if (len >= sizeof(gBleTxBuf)) {  // serializeJson also writes a NUL
+        LIFTRR_LOGW(BLE, "Message too large, bytes=%lu", (unsigned long)len);
+        return;
+    }
+
+    // Bluedroid copies each notification onto its own heap; that is the
+    // stack's allocation, not the command path's.
+    liftrr::core::AllocPause pause;
+    if (msgpack) {
+        serializeMsgPack(doc, gBleTxBuf, sizeof(gBleTxBuf));
+        ble.sendMessage(gBleTxBuf, len, priority, coalesceKey);
+    } else {
+        serializeJson(doc, reinterpret_cast<char *>(gBleTxBuf), sizeof(gBleTxBuf));
+        ble.sendStatus(reinterpret_cast<const char *>(gBleTxBuf), len, priority, coalesceKey);
+    }
+}
+
+} // namespace
+
 void sendBleResp(
         liftrr::ble::BleManager &ble,
         const char *name,
@@ -12,77 +150,445 @@ void sendBleResp(
         bool ok,
         const char *code,
         const char *msg,
-        const std::function<void(JsonObject)> &fillBody) {
+        BodyFiller fillBody) {
 
-    JsonDocument resp;
-    resp["v"]    = 1;
-    resp["id"]   = String(millis());
-    int64_t epoch = liftrr::core::currentEpochMs();
-    resp["ts"]   = (epoch > 0) ? epoch : (int64_t)millis();
-    resp["src"]  = "device";
-    resp["dst"]  = "phone";
-    resp["kind"] = "resp";
-    resp["name"] = name;
-    if (ref && ref[0] != '\0') resp["ref"] = ref;
-    resp["ok"]   = ok;
-    resp["code"] = code ? code : (ok ? "OK" : "ERR");
-    if (msg && msg[0] != '\0') resp["msg"] = msg;
+    JsonDocument resp(&liftrr::core::messageArena());
+    JsonObject body;
+    if (ble.encoding() == BleEncoding::MSGPACK) {
+        JsonArray env = resp.to<JsonArray>();
+        env.add((uint8_t)MSGPACK_KIND_RESP);
+        env.add((uint32_t)millis());
+        env.add(envelopeTimestamp());
+        addMsgPackName(env, name);
+        addMsgPackRef(env, ref);
+        env.add(ok);
+        env.add(code ? code : (ok ? "OK" : "ERR"));
+        if (msg && msg[0] != '\0') env.add(msg);
+        else env.add<JsonVariant>();
+        body = env.add<JsonObject>();
+    } else {
+        char id[12];
+        formatMessageId(id);
+        resp["v"]    = 1;
+        resp["id"]   = id;
+        resp["ts"]   = envelopeTimestamp();
+        resp["src"]  = "device";
+        resp["dst"]  = "phone";
+        resp["kind"] = "resp";
+        resp["name"] = name;
+        if (ref && ref[0] != '\0') resp["ref"] = ref;
+        resp["ok"]   = ok;
+        resp["code"] = code ? code : (ok ? "OK" : "ERR");
+        if (msg && msg[0] != '\0') resp["msg"] = msg;
+        body = resp["body"].to<JsonObject>();
+    }
 
-    JsonObject body = resp["body"].to<JsonObject>();
     if (fillBody) fillBody(body);
-
-    String out;
-    serializeJson(resp, out);
-    ble.sendStatus(out);
+    sendEnvelope(ble, resp, BlePriority::RESPONSE, 0);
 }
 
 void sendBleEvt(
         liftrr::ble::BleManager &ble,
         const char *name,
-        const std::function<void(JsonObject)> &fillBody) {
+        BodyFiller fillBody,
+        bool coalesce) {
 
-    JsonDocument evt;
-    evt["v"]    = 1;
-    evt["id"]   = String(millis());
-    int64_t epoch = liftrr::core::currentEpochMs();
-    evt["ts"]   = (epoch > 0) ? epoch : (int64_t)millis();
-    evt["src"]  = "device";
-    evt["dst"]  = "phone";
-    evt["kind"] = "evt";
-    evt["name"] = name;
+    JsonDocument evt(&liftrr::core::messageArena());
+    JsonObject body;
+    if (ble.encoding() == BleEncoding::MSGPACK) {
+        JsonArray env = evt.to<JsonArray>();
+        env.add((uint8_t)MSGPACK_KIND_EVT);
+        env.add((uint32_t)millis());
+        env.add(envelopeTimestamp());
+        addMsgPackName(env, name);
+        body = env.add<JsonObject>();
+    } else {
+        char id[12];
+        formatMessageId(id);
+        evt["v"]    = 1;
+        evt["id"]   = id;
+        evt["ts"]   = envelopeTimestamp();
+        evt["src"]  = "device";
+        evt["dst"]  = "phone";
+        evt["kind"] = "evt";
+        evt["name"] = name;
+        body = evt["body"].to<JsonObject>();
+    }
 
-    JsonObject body = evt["body"].to<JsonObject>();
     if (fillBody) fillBody(body);
+    // Coalesced events share a queue slot per name: only the latest is sent.
+    sendEnvelope(ble, evt, BlePriority::EVENT, coalesce ? messageIdForName(name) : 0);
+}
+
+void peekRequestRef(const char *raw, size_t len,
+                    char *ref, size_t refLen,
+                    char *name, size_t nameLen) {
+    if (refLen) ref[0] = '\0';
+    if (nameLen) name[0] = '\0';
+    if (!raw || len == 0) return;
+
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(raw);
+    uint8_t first = bytes[0];
+    if ((first >= 0x90 && first <= 0x9f) || first == 0xdc || first == 0xdd) {
+        // [KIND_REQ, ref, name, body]
+        size_t p = (first == 0xdc) ? 3 : (first == 0xdd) ? 5 : 1;
+        char scratch[12];
+        bool numeric = false;
+        uint32_t value = 0;
+        if (!peekMsgPackScalar(bytes, len, p, scratch, sizeof(scratch), &numeric, &value) ||
+            !numeric || value != MSGPACK_KIND_REQ) {
+            return;
+        }
+        if (!peekMsgPackScalar(bytes, len, p, ref, refLen)) return;
+        if (peekMsgPackScalar(bytes, len, p, name, nameLen, &numeric, &value) && numeric) {
+            const char *known = messageNameForId(value);
+            copyBounded(name, nameLen, known ? known : "", known ? strlen(known) : 0);
+        }
+        return;
+    }
+
+    peekJsonValue(raw, len, "id", ref, refLen);
+    if (!peekJsonValue(raw, len, "name", name, nameLen)) {
+        peekJsonValue(raw, len, "cmd", name, nameLen);
+    }
+}
+
+void formatMessageId(char (&out)[12]) {
+    snprintf(out, sizeof(out), "%lu", (unsigned long)millis());
+}
+
+void writeHeapStats(JsonObject out, const liftrr::core::CommandAllocStats &allocs) {
+    liftrr::core::JsonArena &request = liftrr::core::requestArena();
+    liftrr::core::JsonArena &message = liftrr::core::messageArena();
+    out["allocProbe"]       = liftrr::core::kAllocProbeEnabled;
+    out["lastCmdAllocs"]    = allocs.lastCommand;
+    out["totalAllocs"]      = allocs.total;
+    out["allocCmds"]        = allocs.allocatingCommands;
+    out["requestArenaPeak"] = (uint32_t)request.highWater();
+    out["messageArenaPeak"] = (uint32_t)message.highWater();
+    out["arenaFailures"]    = request.failures() + message.failures();
+    out["free"]             = (uint32_t)ESP.getFreeHeap();
+}
+
+const char *applyLogLevels(JsonObject body, JsonDocument &doc) {
+    JsonVariant levelsIn = body ? JsonVariant(body["levels"]) : JsonVariant(doc["levels"]);
+    if (levelsIn.isNull()) return nullptr;
+    JsonObject levels = levelsIn.as<JsonObject>();
+    if (!levels) return "levels must be an object";
+
+    uint8_t next[(size_t)liftrr::core::LogModule::COUNT];
+    for (size_t i = 0; i < (size_t)liftrr::core::LogModule::COUNT; i++) {
+        next[i] = liftrr::core::logLevel((liftrr::core::LogModule)i);
+    }
+    for (JsonPair kv : levels) {
+        liftrr::core::LogModule module;
+        uint8_t level;
+        if (!liftrr::core::parseLogModule(kv.key().c_str(), &module)) {
+            return "unknown log module";
+        }
+        if (!liftrr::core::parseLogLevel(kv.value().as<const char *>(), &level)) {
+            return "level must be none/error/warn/info/debug";
+        }
+        next[(size_t)module] = level;
+    }
+    for (size_t i = 0; i < (size_t)liftrr::core::LogModule::COUNT; i++) {
+        liftrr::core::logSetLevel((liftrr::core::LogModule)i, next[i]);
+    }
+    return nullptr;
+}
 
-    String out;
-    serializeJson(evt, out);
-    ble.sendStatus(out);
+void writeLogStatus(JsonObject out) {
+    JsonObject levels = out["levels"].to<JsonObject>();
+    for (size_t i = 0; i < (size_t)liftrr::core::LogModule::COUNT; i++) {
+        liftrr::core::LogModule module = (liftrr::core::LogModule)i;
+        levels[liftrr::core::logModuleName(module)] =
+            liftrr::core::logLevelName(liftrr::core::logLevel(module));
+    }
+    liftrr::core::LogStats stats = liftrr::core::logStats();
+    out["written"] = stats.written;
+    out["dropped"] = stats.dropped;
+    out["pending"] = stats.pending;
+    out["draining"] = stats.draining;
 }
 
-bool equalsIgnoreCase(const String &a, const char *b) {
-    return a.equalsIgnoreCase(String(b));
+const char *readChangeLogOptions(JsonObject body, JsonDocument &doc,
+                                 liftrr::storage::SessionChangeLog &out) {
+    JsonVariant in = body ? JsonVariant(body["changeLog"]) : JsonVariant(doc["changeLog"]);
+    if (in.isNull()) return nullptr;
+
+    liftrr::storage::SessionChangeLog next;
+    next.heartbeatMs = CHANGE_LOG_HEARTBEAT_MS;
+    if (in.is<bool>()) {
+        next.enabled = in.as<bool>();
+        out = next;
+        return nullptr;
+    }
+    JsonObject cfg = in.as<JsonObject>();
+    if (!cfg) return "changeLog must be a bool or an object";
+
+    int64_t heartbeatMs = cfg["heartbeatMs"] | (int64_t)CHANGE_LOG_HEARTBEAT_MS;
+    int64_t deadbandMm = cfg["deadbandMm"] | (int64_t)0;
+    float deadbandDeg = cfg["deadbandDeg"] | 0.0f;
+    if (heartbeatMs < 1 || heartbeatMs > 60000) return "changeLog.heartbeatMs must be 1..60000";
+    if (deadbandMm < 0 || deadbandMm > 1000) return "changeLog.deadbandMm must be 0..1000";
+    if (!(deadbandDeg >= 0.0f && deadbandDeg <= 45.0f)) return "changeLog.deadbandDeg must be 0..45";
+
+    next.enabled = true;
+    next.heartbeatMs = (uint16_t)heartbeatMs;
+    next.deadbandMm = (uint16_t)deadbandMm;
+    next.deadbandDeg = deadbandDeg;
+    out = next;
+    return nullptr;
 }
 
-bool discardSessionIndexItem(const char *,
-                             uint32_t,
-                             uint64_t,
-                             size_t,
-                             void *) {
+bool discardSessionIndexItem(const liftrr::storage::SessionIndexEntry &, void *) {
     return true;
 }
 
-bool appendSessionIndexItem(const char *name,
-                            uint32_t size,
-                            uint64_t mtimeMs,
-                            size_t lineIndex,
-                            void *ctx) {
+bool appendSessionIndexItem(const liftrr::storage::SessionIndexEntry &entry, void *ctx) {
     if (!ctx) return false;
     auto *listCtx = static_cast<SessionIndexListCtx*>(ctx);
     JsonObject item = listCtx->items.add<JsonObject>();
-    item["name"] = name;
-    item["size"] = size;
-    item["mtime"] = (unsigned long long)mtimeMs;
-    item["line"] = (uint32_t)lineIndex;
+    item["name"] = entry.name;
+    item["size"] = entry.size;
+    item["mtime"] = (unsigned long long)entry.mtimeMs;
+    item["line"] = (uint32_t)entry.position;
+    item["samples"] = entry.sampleCount;
+    item["flags"] = entry.flags;
+    item["reps"] = (entry.flags & liftrr::storage::INDEX_FLAG_REPS) != 0;
+    return true;
+}
+
+namespace {
+
+// Coalesces the many small prints of a streamed response into link-sized writes.
+class BufferedPrint : public Print {
+public:
+    explicit BufferedPrint(Print &out) : out_(out), len_(0) {}
+    ~BufferedPrint() override { flush(); }
+
+    size_t write(uint8_t c) override {
+        if (len_ == sizeof(buf_)) flush();
+        buf_[len_++] = c;
+        return 1;
+    }
+
+    size_t write(const uint8_t *data, size_t size) override {
+        for (size_t i = 0; i < size; i++) write(data[i]);
+        return size;
+    }
+
+    void flush() override {
+        if (len_ == 0) return;
+        out_.write(buf_, len_);
+        len_ = 0;
+    }
+
+private:
+    Print &out_;
+    uint8_t buf_[512];
+    size_t len_;
+};
+
+struct SessionsListStreamCtx {
+    Print &out;
+    size_t count;
+};
+
+bool streamSessionIndexItem(const liftrr::storage::SessionIndexEntry &entry, void *ctx) {
+    auto *streamCtx = static_cast<SessionsListStreamCtx*>(ctx);
+    JsonDocument item(&liftrr::core::messageArena());
+    item["name"] = entry.name;
+    item["size"] = entry.size;
+    item["mtime"] = (unsigned long long)entry.mtimeMs;
+    item["line"] = (uint32_t)entry.position;
+    item["samples"] = entry.sampleCount;
+    item["flags"] = entry.flags;
+    item["reps"] = (entry.flags & liftrr::storage::INDEX_FLAG_REPS) != 0;
+
+    if (streamCtx->count > 0) streamCtx->out.write(',');
+    serializeJson(item, streamCtx->out);
+    streamCtx->count++;
+    return true;
+}
+
+} // namespace
+
+size_t readSessionsListLimit(JsonObject body, JsonDocument &doc) {
+    JsonVariant limit = body ? JsonVariant(body["limit"]) : JsonVariant(doc["limit"]);
+    if (limit.is<const char*>()) {
+        const char *s = limit.as<const char*>();
+        if (s && strcasecmp(s, "all") == 0) return SIZE_MAX;
+        return kSessionsListDefaultLimit;
+    }
+    int64_t n = limit | (int64_t)0;
+    if (n <= 0) return kSessionsListDefaultLimit;
+    return (size_t)n;
+}
+
+SessionsListResult writeSessionsListResponse(Print &rawOut,
+                                             liftrr::storage::StorageManager &storage,
+                                             const char *dst,
+                                             const char *ref,
+                                             size_t cursor,
+                                             size_t limit) {
+    SessionsListResult result;
+    result.nextCursor = cursor;
+
+    BufferedPrint out(rawOut);
+
+    // Envelope first, with the closing brace dropped so the body can follow.
+    char id[12];
+    formatMessageId(id);
+    JsonDocument resp(&liftrr::core::messageArena());
+    resp["v"]    = 1;
+    resp["id"]   = id;
+    int64_t epoch = liftrr::core::currentEpochMs();
+    resp["ts"]   = (epoch > 0) ? epoch : (int64_t)millis();
+    resp["src"]  = "device";
+    resp["dst"]  = dst;
+    resp["kind"] = "resp";
+    resp["name"] = "sessions.list";
+    if (ref && ref[0] != '\0') resp["ref"] = ref;
+    resp["ok"]   = true;
+    resp["code"] = "OK";
+
+    char envelope[256];
+    size_t envLen = serializeJson(resp, envelope, sizeof(envelope));
+    if (envLen < 2 || envLen >= sizeof(envelope)) return result;
+    out.write(reinterpret_cast<const uint8_t*>(envelope), envLen - 1);
+    out.print(",\"body\":{\"items\":[");
+
+    SessionsListStreamCtx ctx{out, 0};
+    result.ok = storage.readSessionIndex(cursor,
+                                         limit,
+                                         &result.nextCursor,
+                                         &result.hasMore,
+                                         streamSessionIndexItem,
+                                         &ctx);
+    result.count = ctx.count;
+
+    out.print("],\"nextCursor\":");
+    out.print((uint32_t)result.nextCursor);
+    out.print(",\"hasMore\":");
+    out.print(result.hasMore ? "true" : "false");
+    out.print("}}\r\n");
+    out.flush();
+    return result;
+}
+
+const char *readStreamOptions(JsonObject body,
+                              JsonDocument &doc,
+                              size_t fileSize,
+                              liftrr::comm::StreamOptions &out) {
+    out = liftrr::comm::StreamOptions();
+
+    const char *framing = readStr(body, doc, "framing", "raw");
+    if (strcasecmp(framing, "framed") == 0) {
+        out.framed = true;
+    } else if (strcasecmp(framing, "raw") != 0) {
+        return "framing must be raw/framed";
+    }
+
+    int64_t offset = readI64(body, doc, "offset", (int64_t)0);
+    int64_t length = readI64(body, doc, "length", (int64_t)0);
+    if (offset < 0 || length < 0) return "offset/length must be >= 0";
+    if ((uint64_t)offset > fileSize) return "offset beyond end of file";
+
+    size_t remaining = fileSize - (size_t)offset;
+    out.offset = (size_t)offset;
+    out.length = (length == 0 || (uint64_t)length > remaining) ? remaining : (size_t)length;
+    return nullptr;
+}
+
+namespace {
+
+bool hasSuffix(const char *s, size_t len, const char *suffix) {
+    size_t n = strlen(suffix);
+    return len > n && strcmp(s + len - n, suffix) == 0;
+}
+
+struct StreamFileSink {
+    liftrr::comm::StreamFile *files;
+    size_t &count;
+};
+
+bool collectFinalSession(const liftrr::storage::SessionIndexEntry &entry, void *ctx) {
+    auto *sink = static_cast<StreamFileSink *>(ctx);
+    if (!(entry.flags & liftrr::storage::INDEX_FLAG_FINAL)) return true;
+    if (sink->count >= BT_STREAM_MAX_FILES) return false;
+
+    liftrr::comm::StreamFile &file = sink->files[sink->count++];
+    copyBounded(file.name, sizeof(file.name), entry.name, strlen(entry.name));
+    return true;
+}
+
+} // namespace
+
+bool readSessionId(const char *in, char *out, size_t outLen, bool *repTable) {
+    if (repTable) *repTable = false;
+    if (!in || in[0] == '\0' || outLen == 0) return false;
+
+    size_t len = strlen(in);
+    if (repTable && hasSuffix(in, len, liftrr::storage::SESSION_REP_EXTENSION)) {
+        *repTable = true;
+        len -= strlen(liftrr::storage::SESSION_REP_EXTENSION);
+    } else if (hasSuffix(in, len, ".csv") || hasSuffix(in, len, ".lrb") || hasSuffix(in, len, ".tmp")) {
+        len -= 4;
+    }
+    if (len >= outLen) return false;
+    copyBounded(out, outLen, in, len);
+    return true;
+}
+
+bool selectStreamManyFiles(JsonObject body,
+                           JsonDocument &doc,
+                           liftrr::storage::StorageManager &storage,
+                           liftrr::comm::StreamFile *files,
+                           StreamManySelection &sel) {
+    sel = StreamManySelection();
+
+    if (!storage.ensureSessionIndex()) {
+        sel.code = "SD_ERROR";
+        sel.msg = "Failed to read session index";
+        return false;
+    }
+
+    JsonArray ids = body ? body["ids"].as<JsonArray>() : doc["ids"].as<JsonArray>();
+    if (ids) {
+        if (ids.size() == 0 || ids.size() > BT_STREAM_MAX_FILES) {
+            sel.code = "BAD_ARGS";
+            sel.msg = "ids must be a non-empty list within the batch limit";
+            return false;
+        }
+        for (JsonVariant v : ids) {
+            char sessionId[liftrr::storage::SESSION_NAME_BYTES];
+            liftrr::comm::StreamFile &file = files[sel.fileCount];
+            if (!readSessionId(v.as<const char*>(), sessionId, sizeof(sessionId), nullptr) ||
+                !storage.findSessionInIndex(sessionId, file.name, sizeof(file.name))) {
+                sel.missing++;
+                continue;
+            }
+            sel.fileCount++;
+        }
+    } else {
+        int64_t cursor = readI64(body, doc, "sinceCursor", (int64_t)0);
+        if (cursor < 0) cursor = 0;
+        sel.byCursor = true;
+        StreamFileSink sink = {files, sel.fileCount};
+        if (!storage.readSessionIndex((size_t)cursor, SIZE_MAX, &sel.nextCursor, &sel.hasMore,
+                                      collectFinalSession, &sink)) {
+            sel.code = "SD_ERROR";
+            sel.msg = "Failed to read session index";
+            return false;
+        }
+    }
+
+    if (sel.fileCount == 0) {
+        sel.code = "NOT_FOUND";
+        sel.msg = "No sessions to stream";
+        return false;
+    }
     return true;
 }
 
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <strings.h>
+
+#include "core/name_hash.h"
+
+namespace liftrr {
+namespace ble {
+
+// MessagePack envelope (BLE, after link.config {"encoding":"msgpack"}).
+// Envelopes are positional arrays so no key strings go on air:
+//   request  [KIND_REQ,  ref, name, body]
+//   response [KIND_RESP, id, ts, name, ref, ok, code, msg, body]
+//   event    [KIND_EVT,  id, ts, name, body]
+// `name` is a message id from kMessageIds, or the name string for anything
+// not in the table. `ref` is echoed as an unsigned int when the request id
+// was numeric, otherwise as a string; nil when absent, like `msg`.
+enum MsgPackKind : uint8_t {
+    MSGPACK_KIND_REQ  = 0,
+    MSGPACK_KIND_RESP = 1,
+    MSGPACK_KIND_EVT  = 2,
+};
+
+// Wire ids for command and event names. Append-only: ids are part of the
+// MessagePack protocol, and commands also dispatch on them.
+enum MessageIdValue : uint8_t {
+    MSG_NONE = 0,
+    // Commands.
+    MSG_PING = 1,
+    MSG_CAPABILITIES_GET = 2,
+    MSG_TIME_SYNC = 3,
+    MSG_MODE_SET = 4,
+    MSG_SESSION_START = 5,
+    MSG_SESSION_END = 6,
+    MSG_SESSIONS_LIST = 7,
+    MSG_SESSION_STREAM = 8,
+    MSG_SESSIONS_CLEAR = 9,
+    MSG_SESSIONS_STREAM_MANY = 10,
+    MSG_LINK_CONFIG = 11,
+    MSG_DIAG_COMMANDS = 12,
+    MSG_LOG_CONFIG = 13,
+    MSG_LAST_COMMAND = MSG_LOG_CONFIG,
+    // Events.
+    MSG_TIME_SYNC_REQUEST = 64,
+    MSG_TIME_SYNC_TIMEOUT = 65,
+    MSG_BT_CLASSIC_REQUIRED = 66,
+    MSG_SESSION_STARTED = 67,
+    MSG_ORIENTATION_STATUS = 68,
+    MSG_CALIBRATION_SUCCEEDED = 69,
+    MSG_SESSION_FILE_ERROR = 70,
+    MSG_SESSION_STREAM_DONE = 71,
+    MSG_SESSIONS_STREAM_MANY_DONE = 72,
+    MSG_REP_COMPLETED = 73,
+};
+
+struct MessageId {
+    uint8_t id;
+    const char *name;
+    uint32_t hash;  // liftrr::core::nameHash(name)
+};
+
+constexpr MessageId messageId(uint8_t id, const char *name) {
+    return MessageId{id, name, liftrr::core::nameHash(name)};
+}
+
+// Hashed at compile time; lookups compare hashes before names.
+static constexpr MessageId kMessageIds[] = {
+    messageId(MSG_PING, "ping"),
+    messageId(MSG_CAPABILITIES_GET, "capabilities.get"),
+    messageId(MSG_TIME_SYNC, "time.sync"),
+    messageId(MSG_MODE_SET, "mode.set"),
+    messageId(MSG_SESSION_START, "session.start"),
+    messageId(MSG_SESSION_END, "session.end"),
+    messageId(MSG_SESSIONS_LIST, "sessions.list"),
+    messageId(MSG_SESSION_STREAM, "session.stream"),
+    messageId(MSG_SESSIONS_CLEAR, "sessions.clear"),
+    messageId(MSG_SESSIONS_STREAM_MANY, "sessions.streamMany"),
+    messageId(MSG_LINK_CONFIG, "link.config"),
+    messageId(MSG_DIAG_COMMANDS, "diag.commands"),
+    messageId(MSG_LOG_CONFIG, "log.config"),
+    messageId(MSG_TIME_SYNC_REQUEST, "time.sync.request"),
+    messageId(MSG_TIME_SYNC_TIMEOUT, "time.sync.timeout"),
+    messageId(MSG_BT_CLASSIC_REQUIRED, "bt_classic.required"),
+    messageId(MSG_SESSION_STARTED, "session.started"),
+    messageId(MSG_ORIENTATION_STATUS, "orientation.status"),
+    messageId(MSG_CALIBRATION_SUCCEEDED, "calibration.succeeded"),
+    messageId(MSG_SESSION_FILE_ERROR, "session.file.error"),
+    messageId(MSG_SESSION_STREAM_DONE, "session.stream.done"),
+    messageId(MSG_SESSIONS_STREAM_MANY_DONE, "sessions.streamMany.done"),
+    messageId(MSG_REP_COMPLETED, "rep.completed"),
+};
+
+static constexpr size_t kMessageIdCount = sizeof(kMessageIds) / sizeof(kMessageIds[0]);
+
+constexpr bool messageIdsDistinct(size_t i = 0, size_t j = 1) {
+    return i >= kMessageIdCount ? true
+         : j >= kMessageIdCount ? messageIdsDistinct(i + 1, i + 2)
+         : (kMessageIds[i].hash != kMessageIds[j].hash &&
+            kMessageIds[i].id != kMessageIds[j].id &&
+            messageIdsDistinct(i, j + 1));
+}
+
+static_assert(messageIdsDistinct(), "message ids and name hashes must be unique");
+
+// MSG_NONE when `name` has no id.
+inline uint8_t messageIdForName(const char *name) {
+    if (!name || name[0] == '\0') return MSG_NONE;
+    uint32_t hash = liftrr::core::nameHash(name);
+    for (const MessageId &m : kMessageIds) {
+        if (m.hash == hash && strcasecmp(m.name, name) == 0) return m.id;
+    }
+    return MSG_NONE;
+}
+
+// nullptr when `id` is unknown.
+inline const char *messageNameForId(uint32_t id) {
+    for (const MessageId &m : kMessageIds) {
+        if (m.id == id) return m.name;
+    }
+    return nullptr;
+}
+
+} // namespace ble
+} // namespace liftrr
@@ -3,12 +3,30 @@
 #include <SD.h>
 #include <ArduinoJson.h>
 #include "bt_classic.h"
+#include "core/config.h"
+#include "core/crc32.h"
+#include "core/log.h"
 
 namespace liftrr {
 namespace comm {
 
 BtClassicManager::BtClassicManager(fs::SDFS &sd)
-    : sd_(sd), bt_ready_(false) {}
+    : sd_(sd),
+      bt_ready_(false),
+      blocks_{nullptr, nullptr},
+      free_q_(nullptr),
+      full_q_(nullptr),
+      reader_task_(nullptr),
+      sender_task_(nullptr),
+      abort_(false),
+      done_(false),
+      bytes_sent_(0),
+      sd_stall_ms_(0),
+      link_stall_ms_(0),
+      read_errors_(0),
+      seq_(0),
+      files_ok_(0),
+      has_finished_(false) {}
 
 void BtClassicManager::sendEventLine(const char *eventName,
                                      const String &sessionId,
@@ -28,35 +46,130 @@ bool BtClassicManager::init(const char *deviceName) {
         deviceName = "LIFTRR";
     }
     bt_ready_ = bt_serial_.begin(deviceName);
+    if (bt_ready_ && !startPipeline()) {
+        LIFTRR_LOGE(COMM, "Stream pipeline init failed");
+    }
     return bt_ready_;
 }
 
+bool BtClassicManager::startPipeline() {
+    if (reader_task_ && sender_task_) return true;
+
+    for (size_t i = 0; i < BLOCK_COUNT; i++) {
+        if (!blocks_[i]) {
+            blocks_[i] = static_cast<uint8_t *>(malloc(FRAME_PREFIX + BT_STREAM_CHUNK_SIZE));
+            if (!blocks_[i]) return false;
+        }
+    }
+    if (!free_q_) free_q_ = xQueueCreate(BLOCK_COUNT, sizeof(uint8_t));
+    if (!full_q_) full_q_ = xQueueCreate(BLOCK_COUNT + 1, sizeof(Job));
+    if (!free_q_ || !full_q_) return false;
+
+    xQueueReset(free_q_);
+    xQueueReset(full_q_);
+    for (size_t i = 0; i < BLOCK_COUNT; i++) {
+        uint8_t idx = (uint8_t)i;
+        xQueueSend(free_q_, &idx, 0);
+    }
+
+    if (!sender_task_ &&
+        xTaskCreatePinnedToCore(senderEntry, "btSppSend", TASK_STACK_BYTES, this,
+                                TASK_PRIORITY, &sender_task_, TASK_CORE) != pdPASS) {
+        sender_task_ = nullptr;
+        return false;
+    }
+    if (!reader_task_ &&
+        xTaskCreatePinnedToCore(readerEntry, "btSdRead", TASK_STACK_BYTES, this,
+                                TASK_PRIORITY, &reader_task_, TASK_CORE) != pdPASS) {
+        reader_task_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
 bool BtClassicManager::isConnected() {
     return bt_ready_ && bt_serial_.hasClient();
 }
 
-bool BtClassicManager::startFileStream(const String &path,
+bool BtClassicManager::isStreaming() const {
+    return stream_.active;
+}
+
+bool BtClassicManager::beginStream() {
+    stream_.active = true;
+    stream_.startMs = millis();
+
+    abort_ = false;
+    done_ = false;
+    bytes_sent_ = 0;
+    sd_stall_ms_ = 0;
+    link_stall_ms_ = 0;
+    read_errors_ = 0;
+    seq_ = 0;
+    files_ok_ = 0;
+    last_file_ = FileResult();
+    xTaskNotifyGive(reader_task_);
+    return true;
+}
+
+// Leaves the file table alone; it is overwritten by the next start.
+void BtClassicManager::resetStream() {
+    stream_.active = false;
+    stream_.framed = false;
+    stream_.batch = false;
+    stream_.fileCount = 0;
+    stream_.start = 0;
+    stream_.length = 0;
+    stream_.sessionId[0] = '\0';
+    stream_.startMs = 0;
+}
+
+bool BtClassicManager::startFileStream(const char *name,
                                        size_t size,
-                                       const String &sessionId) {
+                                       const char *sessionId,
+                                       const StreamOptions &options) {
     if (!isConnected()) return false;
     if (stream_.active) return false;
+    if (!startPipeline()) return false;
+    char path[STREAM_PATH_BYTES];
+    streamFilePath(name, path, sizeof(path));
     if (!sd_.exists(path)) return false;
+    if (options.offset > size) return false;
 
-    File f = sd_.open(path, FILE_READ);
-    if (!f) return false;
+    resetStream();
+    strncpy(stream_.files[0].name, name, STREAM_NAME_BYTES - 1);
+    stream_.files[0].name[STREAM_NAME_BYTES - 1] = '\0';
+    stream_.fileCount = 1;
+    stream_.framed = options.framed;
+    stream_.start = options.offset;
+    stream_.length = options.length;
+    strncpy(stream_.sessionId, sessionId, sizeof(stream_.sessionId) - 1);
 
-    stream_.file = f;
-    stream_.active = true;
-    stream_.offset = 0;
-    stream_.size = size;
-    stream_.sessionId = sessionId;
+    LIFTRR_LOGI(COMM, "Stream start: %s bytes=%lu offset=%lu %s",
+                path, (unsigned long)size, (unsigned long)options.offset,
+                options.framed ? "framed" : "raw");
 
-    Serial.print("[BT] Stream start: ");
-    Serial.print(path);
-    Serial.print(" bytes=");
-    Serial.println(size);
+    return beginStream();
+}
 
-    return true;
+StreamFile *BtClassicManager::prepareBatch() {
+    return stream_.active ? nullptr : stream_.files;
+}
+
+bool BtClassicManager::startBatchStream(size_t count) {
+    if (!isConnected()) return false;
+    if (stream_.active) return false;
+    if (count == 0 || count > BT_STREAM_MAX_FILES) return false;
+    if (!startPipeline()) return false;
+
+    resetStream();
+    stream_.fileCount = count;
+    stream_.framed = true;
+    stream_.batch = true;
+
+    LIFTRR_LOGI(COMM, "Batch stream start: files=%lu", (unsigned long)count);
+
+    return beginStream();
 }
 
 bool BtClassicManager::sendJsonLine(const String &line) {
@@ -65,35 +178,325 @@ bool BtClassicManager::sendJsonLine(const String &line) {
     return true;
 }
 
-void BtClassicManager::loop() {
-    if (!stream_.active) return;
-    if (!isConnected()) {
-        if (stream_.file) stream_.file.close();
-        stream_ = BtStreamState{};
-        return;
+Print *BtClassicManager::jsonLineStream() {
+    if (!isConnected() || stream_.active) return nullptr;
+    return &bt_serial_;
+}
+
+bool BtClassicManager::takeFinishedStream(StreamStats &out) {
+    if (!has_finished_) return false;
+    out = finished_;
+    has_finished_ = false;
+    return true;
+}
+
+void BtClassicManager::readerEntry(void *arg) {
+    static_cast<BtClassicManager *>(arg)->readerLoop();
+}
+
+void BtClassicManager::senderEntry(void *arg) {
+    static_cast<BtClassicManager *>(arg)->senderLoop();
+}
+
+bool BtClassicManager::takeBlock(uint8_t &idx) {
+    while (xQueueReceive(free_q_, &idx, pdMS_TO_TICKS(100)) != pdTRUE) {
+        if (abort_) return false;
     }
+    return true;
+}
+
+bool BtClassicManager::queueFrame(uint8_t type, uint32_t offset, const void *payload, size_t len) {
+    uint8_t idx = 0;
+    if (!takeBlock(idx)) return false;
 
-    if (!stream_.file) {
-        stream_ = BtStreamState{};
+    BtStreamFrameHeader header;
+    header.magic = BT_STREAM_FRAME_MAGIC;
+    header.version = BT_STREAM_FRAME_VERSION;
+    header.type = type;
+    header.headerSize = sizeof(BtStreamFrameHeader);
+    header.seq = seq_++;
+    header.offset = offset;
+    header.length = (uint32_t)len;
+    header.crc32 = liftrr::core::crc32Update(0, payload, len);
+    memcpy(blocks_[idx], &header, sizeof(header));
+    memcpy(blocks_[idx] + sizeof(header), payload, len);
+
+    Job job;
+    job.op = JOB_SEND;
+    job.block = idx;
+    job.start = 0;
+    job.len = (uint32_t)(sizeof(header) + len);
+    job.payload = 0;
+    xQueueSend(full_q_, &job, portMAX_DELAY);
+    return true;
+}
+
+bool BtClassicManager::hashFileSpan(File &file, size_t from, size_t to, uint32_t &crc) {
+    if (from >= to) return true;
+
+    // Borrow a pipeline block as scratch; it goes straight back afterwards.
+    uint8_t idx = 0;
+    if (!takeBlock(idx)) return false;
+
+    bool ok = file.seek(from);
+    uint8_t *buf = blocks_[idx] + FRAME_PREFIX;
+    size_t pos = from;
+    while (ok && !abort_ && pos < to) {
+        size_t want = to - pos;
+        if (want > BT_STREAM_CHUNK_SIZE) want = BT_STREAM_CHUNK_SIZE;
+        size_t n = file.read(buf, want);
+        if (n == 0) {
+            ok = false;
+            break;
+        }
+        crc = liftrr::core::crc32Update(crc, buf, n);
+        pos += n;
+    }
+
+    xQueueSend(free_q_, &idx, 0);
+    return ok && pos >= to;
+}
+
+void BtClassicManager::streamFile(size_t index, FileResult &result) {
+    result = FileResult();
+    const StreamFile &item = stream_.files[index];
+
+    char path[STREAM_PATH_BYTES];
+    streamFilePath(item.name, path, sizeof(path));
+    File file = sd_.open(path, FILE_READ);
+    if (!file) {
+        result.status = BT_STREAM_STATUS_OPEN_ERROR;
         return;
     }
 
-    const size_t kChunkSize = 512;
-    uint8_t buf[kChunkSize];
-    size_t n = stream_.file.read(buf, kChunkSize);
-    if (n > 0) {
-        bt_serial_.write(buf, n);
-        stream_.offset += n;
+    size_t size = file.size();
+    size_t start = stream_.batch ? 0 : stream_.start;
+    if (start > size) start = size;
+    size_t end = size;
+    if (!stream_.batch && stream_.length > 0 && stream_.length < size - start) {
+        end = start + stream_.length;
+    }
+    result.size = (uint32_t)size;
+    result.start = (uint32_t)start;
+
+    if (stream_.batch) {
+        BtStreamFileHeader fh;
+        memset(&fh, 0, sizeof(fh));
+        fh.fileIndex = (uint16_t)index;
+        fh.fileCount = (uint16_t)stream_.fileCount;
+        fh.fileSize = (uint32_t)size;
+        strncpy(fh.name, item.name, sizeof(fh.name) - 1);
+        if (!queueFrame(BT_FRAME_FILE, 0, &fh, sizeof(fh))) {
+            file.close();
+            return;
+        }
+    }
+
+    // Framed transfers also hash the bytes outside the range so the
+    // trailer can carry the whole-file CRC on resumed downloads.
+    bool ok = true;
+    if (stream_.framed) ok = hashFileSpan(file, 0, start, result.fileCrc);
+    if (ok) ok = file.seek(start);
+
+    size_t pos = start;
+    while (ok && !abort_ && pos < end) {
+        uint8_t idx = 0;
+        if (!takeBlock(idx)) break;
+
+        size_t want = end - pos;
+        if (want > BT_STREAM_CHUNK_SIZE) want = BT_STREAM_CHUNK_SIZE;
+        uint8_t *payload = blocks_[idx] + FRAME_PREFIX;
+        size_t n = file.read(payload, want);
+        if (n == 0) {
+            ok = false;
+            xQueueSend(free_q_, &idx, 0);
+            break;
+        }
+
+        Job job;
+        job.op = JOB_SEND;
+        job.block = idx;
+        job.start = FRAME_PREFIX;
+        job.len = (uint32_t)n;
+        job.payload = (uint32_t)n;
+        if (stream_.framed) {
+            BtStreamFrameHeader header;
+            header.magic = BT_STREAM_FRAME_MAGIC;
+            header.version = BT_STREAM_FRAME_VERSION;
+            header.type = BT_FRAME_DATA;
+            header.headerSize = sizeof(BtStreamFrameHeader);
+            header.seq = seq_++;
+            header.offset = (uint32_t)pos;
+            header.length = (uint32_t)n;
+            header.crc32 = liftrr::core::crc32Update(0, payload, n);
+            memcpy(blocks_[idx], &header, sizeof(header));
+            job.start = 0;
+            job.len += FRAME_PREFIX;
+
+            result.rangeCrc = liftrr::core::crc32Update(result.rangeCrc, payload, n);
+            result.fileCrc = liftrr::core::crc32Update(result.fileCrc, payload, n);
+            result.frames++;
+        }
+        pos += n;
+        xQueueSend(full_q_, &job, portMAX_DELAY);
+    }
+    result.length = (uint32_t)(pos - start);
+
+    if (ok && !abort_ && stream_.framed) ok = hashFileSpan(file, end, size, result.fileCrc);
+    file.close();
+    if (!ok && !abort_) result.status = BT_STREAM_STATUS_READ_ERROR;
+}
+
+void BtClassicManager::readerLoop() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // The loop task leaves stream_ alone until done_ is set.
+        uint32_t totalBytes = 0;
+        for (size_t i = 0; i < stream_.fileCount && !abort_; i++) {
+            FileResult result;
+            streamFile(i, result);
+            if (abort_) break;
+
+            if (result.status == BT_STREAM_STATUS_OK) {
+                files_ok_++;
+            } else {
+                read_errors_++;
+            }
+            totalBytes += result.length;
+            last_file_ = result;
+
+            if (stream_.framed) {
+                BtStreamTrailer trailer;
+                memset(&trailer, 0, sizeof(trailer));
+                trailer.fileSize = result.size;
+                trailer.fileCrc32 = result.fileCrc;
+                trailer.rangeOffset = result.start;
+                trailer.rangeLength = result.length;
+                trailer.rangeCrc32 = result.rangeCrc;
+                trailer.frameCount = result.frames;
+                trailer.status = result.status;
+                queueFrame(BT_FRAME_END, result.start, &trailer, sizeof(trailer));
+            }
+        }
+
+        if (stream_.batch && !abort_) {
+            BtStreamBatchTrailer batch;
+            batch.fileCount = (uint16_t)stream_.fileCount;
+            batch.filesOk = (uint16_t)files_ok_;
+            batch.totalBytes = totalBytes;
+            queueFrame(BT_FRAME_BATCH_END, 0, &batch, sizeof(batch));
+        }
+
+        Job end;
+        end.op = JOB_END;
+        end.block = 0;
+        end.start = 0;
+        end.len = 0;
+        end.payload = 0;
+        xQueueSend(full_q_, &end, portMAX_DELAY);
+    }
+}
+
+bool BtClassicManager::sendBlock(const uint8_t *data, size_t len) {
+    uint32_t lastProgressMs = millis();
+    while (len > 0) {
+        if (!isConnected()) return false;
+
+        uint32_t startUs = micros();
+        size_t n = bt_serial_.write(data, len);
+        uint32_t elapsedUs = micros() - startUs;
+        // A write that returns short or sits in the SPP queue is back-pressure.
+        if (n < len || elapsedUs >= BT_STREAM_BLOCKED_US) {
+            link_stall_ms_ += elapsedUs / 1000;
+        }
+
+        if (n > 0) {
+            data += n;
+            len -= n;
+            lastProgressMs = millis();
+            continue;
+        }
+
+        if (millis() - lastProgressMs >= BT_STREAM_STALL_TIMEOUT_MS) return false;
+        vTaskDelay(1);
+        link_stall_ms_ += portTICK_PERIOD_MS;
     }
+    return true;
+}
+
+void BtClassicManager::senderLoop() {
+    bool idle = true;
+    Job job;
+    for (;;) {
+        uint32_t waitStartMs = millis();
+        if (xQueueReceive(full_q_, &job, portMAX_DELAY) != pdTRUE) continue;
+        if (!idle) sd_stall_ms_ += millis() - waitStartMs;
 
-    if (n == 0 || stream_.offset >= stream_.size || !stream_.file.available()) {
-        if (stream_.file) stream_.file.close();
-        Serial.print("[BT] Stream end: sessionId=");
-        Serial.print(stream_.sessionId);
-        Serial.print(" bytes=");
-        Serial.println(stream_.offset);
-        stream_ = BtStreamState{};
+        if (job.op == JOB_END) {
+            done_ = true;
+            idle = true;
+            continue;
+        }
+
+        idle = false;
+        if (!abort_) {
+            if (sendBlock(blocks_[job.block] + job.start, job.len)) {
+                bytes_sent_ += job.payload;
+            } else {
+                abort_ = true;
+            }
+        }
+        xQueueSend(free_q_, &job.block, portMAX_DELAY);
+    }
+}
+
+void BtClassicManager::finishStream() {
+    StreamStats stats;
+    stats.ok = !abort_ && read_errors_ == 0;
+    stats.framed = stream_.framed;
+    stats.batch = stream_.batch;
+    stats.fileCount = (uint32_t)stream_.fileCount;
+    stats.filesOk = files_ok_;
+    if (!stream_.batch) {
+        memcpy(stats.sessionId, stream_.sessionId, sizeof(stats.sessionId));
+        stats.size = last_file_.size;
+        stats.offset = last_file_.start;
+        stats.length = last_file_.length;
+        stats.fileCrc32 = last_file_.fileCrc;
+    }
+    stats.bytesSent = bytes_sent_;
+    stats.elapsedMs = millis() - stream_.startMs;
+    stats.bytesPerSec = stats.elapsedMs > 0
+        ? (uint32_t)(((uint64_t)stats.bytesSent * 1000ULL) / stats.elapsedMs)
+        : stats.bytesSent;
+    stats.sdStallMs = sd_stall_ms_;
+    stats.linkStallMs = link_stall_ms_;
+    stats.readErrors = read_errors_;
+
+    if (stats.batch) {
+        LIFTRR_LOGI(COMM, "Stream end: files=%lu/%lu %s bytes=%lu ms=%lu Bps=%lu sdStallMs=%lu linkStallMs=%lu",
+                    (unsigned long)stats.filesOk, (unsigned long)stats.fileCount,
+                    stats.ok ? "ok" : "aborted", (unsigned long)stats.bytesSent,
+                    (unsigned long)stats.elapsedMs, (unsigned long)stats.bytesPerSec,
+                    (unsigned long)stats.sdStallMs, (unsigned long)stats.linkStallMs);
+    } else {
+        LIFTRR_LOGI(COMM, "Stream end: sessionId=%s %s bytes=%lu ms=%lu Bps=%lu sdStallMs=%lu linkStallMs=%lu",
+                    stats.sessionId, stats.ok ? "ok" : "aborted",
+                    (unsigned long)stats.bytesSent, (unsigned long)stats.elapsedMs,
+                    (unsigned long)stats.bytesPerSec, (unsigned long)stats.sdStallMs,
+                    (unsigned long)stats.linkStallMs);
     }
+
+    finished_ = stats;
+    has_finished_ = true;
+    resetStream();
+}
+
+void BtClassicManager::loop() {
+    if (!stream_.active) return;
+    if (!isConnected()) abort_ = true;
+    if (done_) finishStream();
 }
 
 } // namespace comm
@@ -4,31 +4,140 @@
 #include <BluetoothSerial.h>
 #include <FS.h>
 #include <SD.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+#include "comm/bt_stream_frame.h"
+#include "core/config.h"
 
 namespace liftrr {
 namespace comm {
 
+// Byte range and wire format for one session.stream transfer.
+struct StreamOptions {
+    size_t offset = 0;
+    size_t length = 0;  // 0 = to end of file
+    bool framed = false;
+};
+
+// Streamed files live in /sessions and are named by their file name there.
+static const size_t STREAM_NAME_BYTES = sizeof(BtStreamFileHeader::name);
+static const size_t STREAM_PATH_BYTES = sizeof("/sessions/") + STREAM_NAME_BYTES;
+
+inline void streamFilePath(const char *name, char *out, size_t outSize) {
+    snprintf(out, outSize, "/sessions/%s", name);
+}
+
+// One file of a sessions.streamMany batch.
+struct StreamFile {
+    char name[STREAM_NAME_BYTES];
+};
+
 class BtClassicManager {
 public:
+    // Summary of a finished session.stream / sessions.streamMany transfer.
+    struct StreamStats {
+        bool ok = false;
+        bool framed = false;
+        bool batch = false;
+        char sessionId[STREAM_NAME_BYTES] = {};  // single-file streams only
+        uint32_t size = 0;
+        uint32_t offset = 0;
+        uint32_t length = 0;
+        uint32_t fileCrc32 = 0;  // framed single-file streams only
+        uint32_t fileCount = 0;
+        uint32_t filesOk = 0;
+        uint32_t bytesSent = 0;
+        uint32_t elapsedMs = 0;
+        uint32_t bytesPerSec = 0;
+        uint32_t sdStallMs = 0;    // sender idle, waiting on SD reads
+        uint32_t linkStallMs = 0;  // sender blocked by SPP back-pressure
+        uint32_t readErrors = 0;
+    };
+
     explicit BtClassicManager(fs::SDFS &sd);
 
     bool init(const char *deviceName);
     bool isConnected();
-    bool startFileStream(const String &path,
+    bool isStreaming() const;
+    // `name` is the file name under /sessions.
+    bool startFileStream(const char *name,
                          size_t size,
-                         const String &sessionId);
+                         const char *sessionId,
+                         const StreamOptions &options = StreamOptions());
+    // A batch is filled in place: write up to BT_STREAM_MAX_FILES entries
+    // into prepareBatch() (nullptr while a stream is active), then start it
+    // with startBatchStream(count). Sends the files back to back as one
+    // framed transfer.
+    StreamFile *prepareBatch();
+    bool startBatchStream(size_t count);
     bool sendJsonLine(const String &line);
+    // Link for writing a JSON line piecewise; nullptr when disconnected or
+    // while a file stream owns the link.
+    Print *jsonLineStream();
+    // Returns true once per finished stream and fills `out`.
+    bool takeFinishedStream(StreamStats &out);
     void loop();
 
 private:
+    static const size_t BLOCK_COUNT = 2;
+
+    enum JobOp : uint8_t {
+        JOB_SEND,
+        JOB_END,
+    };
+
+    struct Job {
+        uint8_t op;
+        uint8_t block;
+        uint16_t start;    // first byte of the block to send
+        uint32_t len;      // bytes to send
+        uint32_t payload;  // file bytes included in len
+    };
+
+    // Owned by the reader task between start and done_.
     struct BtStreamState {
         bool active = false;
-        File file;
-        size_t offset = 0;
-        size_t size = 0;
-        String sessionId;
+        bool framed = false;
+        bool batch = false;
+        StreamFile files[BT_STREAM_MAX_FILES];
+        size_t fileCount = 0;
+        size_t start = 0;   // single-file range
+        size_t length = 0;  // 0 = to end of file
+        char sessionId[STREAM_NAME_BYTES] = {};
+        uint32_t startMs = 0;
+    };
+
+    // Per-file outcome reported by the reader.
+    struct FileResult {
+        uint32_t size = 0;
+        uint32_t start = 0;
+        uint32_t length = 0;
+        uint32_t fileCrc = 0;
+        uint32_t rangeCrc = 0;
+        uint32_t frames = 0;
+        uint8_t status = BT_STREAM_STATUS_OK;
     };
 
+    // Blocks keep room for a frame header in front of the payload so a
+    // framed chunk goes to SPP in a single write.
+    static const size_t FRAME_PREFIX = sizeof(BtStreamFrameHeader);
+
+    bool startPipeline();
+    void resetStream();
+    bool beginStream();
+    static void readerEntry(void *arg);
+    static void senderEntry(void *arg);
+    void readerLoop();
+    void senderLoop();
+    bool takeBlock(uint8_t &idx);
+    void streamFile(size_t index, FileResult &result);
+    bool hashFileSpan(File &file, size_t from, size_t to, uint32_t &crc);
+    bool queueFrame(uint8_t type, uint32_t offset, const void *payload, size_t len);
+    bool sendBlock(const uint8_t *data, size_t len);
+    void finishStream();
+
     void sendEventLine(const char *eventName,
                        const String &sessionId,
                        size_t size);
@@ -37,6 +146,30 @@ private:
     fs::SDFS &sd_;
     bool bt_ready_;
     BtStreamState stream_;
+
+    // Reader/sender pipeline: the reader fills free blocks from SD while the
+    // sender pushes the previous block into SPP.
+    uint8_t *blocks_[BLOCK_COUNT];
+    QueueHandle_t free_q_;
+    QueueHandle_t full_q_;
+    TaskHandle_t reader_task_;
+    TaskHandle_t sender_task_;
+    volatile bool abort_;
+    volatile bool done_;
+    volatile uint32_t bytes_sent_;
+    volatile uint32_t sd_stall_ms_;
+    volatile uint32_t link_stall_ms_;
+    volatile uint32_t read_errors_;
+    uint32_t seq_;
+    uint32_t files_ok_;
+    FileResult last_file_;
+
+    bool has_finished_;
+    StreamStats finished_;
+
+    static const uint32_t TASK_STACK_BYTES = 4096;
+    static const UBaseType_t TASK_PRIORITY = 2;
+    static const BaseType_t TASK_CORE = 0;
 };
 
 } // namespace comm
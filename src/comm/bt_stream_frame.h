@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace liftrr {
+namespace comm {
+
+// Framed Classic transfer (little-endian), used by session.stream with
+// "framing":"framed" and always by sessions.streamMany. Every frame is a
+// BtStreamFrameHeader followed by `length` payload bytes whose CRC-32 is
+// `crc32`; `seq` counts frames from 0 across the whole transfer.
+//   FILE      - BtStreamFileHeader, opens the next file (streamMany only)
+//   DATA      - file bytes starting at file offset `offset`
+//   END       - BtStreamTrailer, closes the current file
+//   BATCH_END - BtStreamBatchTrailer, last frame of a streamMany transfer
+// A receiver that loses the link resumes a file with offset = last good
+// DATA offset + length.
+static const uint32_t BT_STREAM_FRAME_MAGIC = 0x4653524CUL;  // "LRSF"
+static const uint8_t BT_STREAM_FRAME_VERSION = 1;
+
+enum BtStreamFrameType : uint8_t {
+    BT_FRAME_DATA      = 1,
+    BT_FRAME_END       = 2,
+    BT_FRAME_FILE      = 3,
+    BT_FRAME_BATCH_END = 4,
+};
+
+enum BtStreamStatus : uint8_t {
+    BT_STREAM_STATUS_OK         = 0,
+    BT_STREAM_STATUS_READ_ERROR = 1,
+    BT_STREAM_STATUS_OPEN_ERROR = 2,
+};
+
+struct __attribute__((packed)) BtStreamFrameHeader {
+    uint32_t magic;
+    uint8_t  version;
+    uint8_t  type;
+    uint16_t headerSize;
+    uint32_t seq;
+    uint32_t offset;
+    uint32_t length;
+    uint32_t crc32;  // CRC-32 of the payload
+};
+
+struct __attribute__((packed)) BtStreamFileHeader {
+    uint16_t fileIndex;
+    uint16_t fileCount;
+    uint32_t fileSize;
+    char     name[64];  // file name under /sessions, NUL-padded
+};
+
+struct __attribute__((packed)) BtStreamTrailer {
+    uint32_t fileSize;
+    uint32_t fileCrc32;    // CRC-32 of the whole file, not just this range
+    uint32_t rangeOffset;
+    uint32_t rangeLength;  // bytes sent for this file
+    uint32_t rangeCrc32;   // CRC-32 of the bytes sent
+    uint32_t frameCount;   // DATA frames sent for this file
+    uint8_t  status;       // BtStreamStatus
+    uint8_t  reserved[3];
+};
+
+struct __attribute__((packed)) BtStreamBatchTrailer {
+    uint16_t fileCount;
+    uint16_t filesOk;
+    uint32_t totalBytes;   // DATA payload bytes across all files
+};
+
+static_assert(sizeof(BtStreamFrameHeader) == 24, "frame header must stay 24 bytes");
+static_assert(sizeof(BtStreamFileHeader) == 72, "file header must stay 72 bytes");
+static_assert(sizeof(BtStreamTrailer) == 28, "stream trailer must stay 28 bytes");
+static_assert(sizeof(BtStreamBatchTrailer) == 8, "batch trailer must stay 8 bytes");
+
+} // namespace comm
+} // namespace liftrr
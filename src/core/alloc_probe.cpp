@@ -0,0 +1,72 @@
+#include "core/alloc_probe.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+namespace {
+
+volatile TaskHandle_t gProbeTask = nullptr;
+volatile uint32_t gProbeCount = 0;
+volatile uint32_t gProbePaused = 0;
+
+inline void noteAlloc() {
+    TaskHandle_t task = gProbeTask;
+    if (task && gProbePaused == 0 && xTaskGetCurrentTaskHandle() == task) {
+        gProbeCount++;
+    }
+}
+
+} // namespace
+
+#ifdef LIFTRR_ALLOC_PROBE
+extern "C" {
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    noteAlloc();
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    noteAlloc();
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    noteAlloc();
+    return __real_realloc(ptr, size);
+}
+
+} // extern "C"
+#endif
+
+namespace liftrr {
+namespace core {
+
+AllocScope::AllocScope() {
+    gProbeCount = 0;
+    gProbePaused = 0;
+    gProbeTask = xTaskGetCurrentTaskHandle();
+}
+
+AllocScope::~AllocScope() {
+    gProbeTask = nullptr;
+}
+
+uint32_t AllocScope::count() const {
+    return gProbeCount;
+}
+
+AllocPause::AllocPause() {
+    gProbePaused++;
+}
+
+AllocPause::~AllocPause() {
+    gProbePaused--;
+}
+
+} // namespace core
+} // namespace liftrr
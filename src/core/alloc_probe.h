@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Arduino.h>
+
+namespace liftrr {
+namespace core {
+
+// Allocation counting needs -DLIFTRR_ALLOC_PROBE and the -Wl,--wrap=...
+// allocator flags, which only the esp32dev-allocprobe env sets. Other
+// builds keep the scopes but every count stays 0.
+#ifdef LIFTRR_ALLOC_PROBE
+static const bool kAllocProbeEnabled = true;
+#else
+static const bool kAllocProbeEnabled = false;
+#endif
+
+// Counts heap allocations (malloc/calloc/realloc) made by the calling task
+// while the scope is alive. Fed by the linker-wrapped allocator entry
+// points. One scope at a time.
+class AllocScope {
+public:
+    AllocScope();
+    ~AllocScope();
+
+    uint32_t count() const;
+
+private:
+    AllocScope(const AllocScope &) = delete;
+    AllocScope &operator=(const AllocScope &) = delete;
+};
+
+// Excludes a region from the active AllocScope, for allocations owned by
+// a third-party stack rather than the code being measured.
+class AllocPause {
+public:
+    AllocPause();
+    ~AllocPause();
+
+private:
+    AllocPause(const AllocPause &) = delete;
+    AllocPause &operator=(const AllocPause &) = delete;
+};
+
+// Per-transport allocation counters for the command path.
+struct CommandAllocStats {
+    uint32_t lastCommand = 0;  // allocations made by the previous command
+    uint32_t total = 0;
+    uint32_t allocatingCommands = 0;
+
+    void record(uint32_t allocs) {
+        lastCommand = allocs;
+        total += allocs;
+        if (allocs) allocatingCommands++;
+    }
+};
+
+} // namespace core
+} // namespace liftrr
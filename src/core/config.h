@@ -14,12 +14,106 @@
 #define FLASH_MOSI   23
 #define SD_CS 13
 #define LED_SD     2
+// VL53L1X GPIO1 (data ready), wired to GPIO34 on the esp32dev build. Boards
+// without the line build with -DLASER_INT_PIN=-1 to poll over I2C instead.
+#ifndef LASER_INT_PIN
+#define LASER_INT_PIN 34
+#endif
 
 // Timing.
-const long SCREEN_INTERVAL = 100;    // 10Hz Screen Update
 const long LOG_INTERVAL = 50;        // 20Hz Data Logging
 const long AUTO_DUMP_INTERVAL = 100000; // 100s Auto-Dump Timer
 
+// VL53L1X ranging: timestamped results queued between ISR-driven reads
+// and SensorManager::read().
+const uint16_t LASER_TIMING_BUDGET_MS = 50;
+const size_t LASER_SAMPLE_RING = 8;  // power of two
+
+// I2C bus. BNO055, VL53L1X and SSD1306 all support fast mode; build with
+// -DI2C_CLOCK_HZ=100000 if a board's pull-ups or wiring need standard mode.
+#ifndef I2C_CLOCK_HZ
+#define I2C_CLOCK_HZ 400000UL
+#endif
+
+// Display frame-rate governor (DisplayManager::frameDue).
+const uint32_t DISPLAY_ACTIVE_INTERVAL_MS = 50;    // 20 Hz while the distance moves
+const uint32_t DISPLAY_STATIC_INTERVAL_MS = 250;   // 4 Hz when nothing moves
+const uint32_t DISPLAY_IDLE_INTERVAL_MS = 2000;    // IDLE/DUMP screens and Classic transfers
+const uint32_t DISPLAY_ACTIVE_HOLD_MS = 1000;      // stay fast this long after the last move
+const int16_t DISPLAY_MOTION_MM = 3;               // relDist change that counts as a move
+const uint32_t DISPLAY_LOOP_BUDGET_US = 5000;      // loop pass this late: skip the frame...
+const uint8_t DISPLAY_MAX_BUDGET_SKIPS = 3;        // ...but never more than this many in a row
+
+// I2C scheduler (core/i2c_bus.h): tolerated queueing latency per request
+// class, reported as deadline misses.
+const uint32_t I2C_SENSOR_DEADLINE_US = 2000;
+const uint32_t I2C_DISPLAY_DEADLINE_US = 20000;
+
+// BNO055 burst reads include CALIB_STAT once every N sensor cycles.
+const uint8_t IMU_CALIB_POLL_DIVIDER = 10;  // 10 Hz at SENSOR_TASK_PERIOD_MS
+
+// BNO055 fusion output period (100 Hz in NDOF). A successful burst read at
+// least 3/4 of a period after the last fresh one carries a new fusion result.
+const uint32_t IMU_FUSION_PERIOD_US = 10000;
+
+// Sensor acquisition task (sensors/sensor_task.h).
+const uint32_t SENSOR_TASK_PERIOD_MS = 10;  // 100 Hz, the BNO055 fusion rate
+const size_t SENSOR_LOG_RING_DEPTH = 32;    // records buffered for the logger; power of two
+
+// Bar displacement/velocity estimator (sensors/bar_estimator.h): laser
+// distance fused with IMU vertical acceleration.
+const float BAR_EST_ACCEL_NOISE_MMS2 = 400.0f;  // process noise, 1 sigma of the BNO055 linear accel
+const float BAR_EST_LASER_NOISE_MM = 6.0f;      // VL53L1X ranging noise, 1 sigma
+const float BAR_EST_GATE_SIGMA = 5.0f;          // laser innovations beyond this are rejected...
+const uint8_t BAR_EST_MAX_REJECTS = 3;          // ...until this many in a row force a reset
+const uint32_t BAR_EST_MAX_GAP_US = 100000;     // longer prediction gaps restart the filter
+
+// Rep detection (app/rep_detector.h) on the fused displacement. A rep is a
+// down and an up phase, in either order, of matching range.
+const float REP_HYSTERESIS_MM = 40.0f;     // travel back from an extreme that ends a phase
+const float REP_MIN_ROM_MM = 150.0f;       // shorter phases are not part of a rep
+const float REP_ROM_MATCH = 0.5f;          // min shorter/longer phase ratio within a rep
+const float REP_REST_VEL_MMS = 60.0f;      // slower than this counts as still...
+const uint32_t REP_REST_MS = 400;          // ...and this long still ends a phase
+const uint32_t REP_MAX_PAUSE_MS = 10000;   // longest pause between the two phases of a rep
+
+// SD write-behind logging (block size is a multiple of the 512-byte sector).
+const size_t SD_LOG_BLOCK_SIZE = 4096;
+const size_t SD_LOG_BLOCK_COUNT = 3;
+const size_t SD_REP_BLOCK_SIZE = 512;  // rep table: sparse rows, own small writer
+const size_t SD_REP_BLOCK_COUNT = 2;
+const uint16_t CHANGE_LOG_HEARTBEAT_MS = 1000;  // change-driven logging: max gap between rows
+
+// Bluetooth Classic file streaming (SD reads overlap SPP writes).
+const size_t BT_STREAM_CHUNK_SIZE = 4096;
+const uint32_t BT_STREAM_BLOCKED_US = 2000;        // write slower than this = back-pressure
+const uint32_t BT_STREAM_STALL_TIMEOUT_MS = 5000;  // abort when SPP accepts nothing
+const size_t BT_STREAM_MAX_FILES = 64;            // sessions.streamMany batch cap
+
+// Session id -> index.bin record lookups; a bigger index is scanned instead.
+const size_t SESSION_INDEX_CACHE_SLOTS = 1024;  // power of two; holds up to half as many records
+
+// BLE commands are queued by the GATT callback and run from the main loop.
+const size_t BLE_COMMAND_QUEUE_DEPTH = 4;  // power of two
+
+// BLE STATUS notifications are queued and paced by GATT confirm/congestion.
+const size_t BLE_TX_RESPONSE_QUEUE_BYTES = 3072;
+const size_t BLE_TX_EVENT_QUEUE_BYTES = 1536;
+const size_t BLE_TX_COALESCE_SLOTS = 4;      // latest-only state events
+const size_t BLE_TX_COALESCE_BYTES = 256;
+const uint32_t BLE_TX_MAX_IN_FLIGHT = 4;     // notifications awaiting CONF_EVT
+const uint32_t BLE_TX_CONF_TIMEOUT_MS = 200; // reclaim credits after this
+
+// JSON command/response documents live in static arenas, not the heap.
+const size_t JSON_REQUEST_ARENA_BYTES = 6144;
+const size_t JSON_MESSAGE_ARENA_BYTES = 6144;
+const size_t SERIAL_LINE_MAX_BYTES = 2048;
+
+// Async log ring (core/log.h); lines longer than LOG_LINE_BYTES are cut.
+const size_t LOG_RING_SLOTS = 32;  // power of two
+const size_t LOG_LINE_BYTES = 160;
+const uint32_t LOG_DRAIN_INTERVAL_MS = 20;
+
 namespace liftrr {
 namespace core {
 
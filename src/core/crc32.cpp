@@ -0,0 +1,41 @@
+#include "core/crc32.h"
+
+namespace liftrr {
+namespace core {
+
+namespace {
+
+struct CrcTable {
+    uint32_t entries[256];
+
+    CrcTable() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? (0xEDB88320UL ^ (c >> 1)) : (c >> 1);
+            }
+            entries[i] = c;
+        }
+    }
+};
+
+const uint32_t *crcTable() {
+    // Function-local static: built once, safe across tasks.
+    static const CrcTable table;
+    return table.entries;
+}
+
+} // namespace
+
+uint32_t crc32Update(uint32_t crc, const void *data, size_t len) {
+    const uint32_t *table = crcTable();
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    crc = ~crc;
+    while (len--) {
+        crc = table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+} // namespace core
+} // namespace liftrr
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <Arduino.h>
+
+namespace liftrr {
+namespace core {
+
+// CRC-32 (IEEE 802.3 / zlib). Start with crc = 0 and feed the previous
+// result back in to hash data in pieces.
+uint32_t crc32Update(uint32_t crc, const void *data, size_t len);
+
+} // namespace core
+} // namespace liftrr
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include <type_traits>
+#include <utility>
+
+namespace liftrr {
+namespace core {
+
+template <typename Fn>
+class FunctionRef;
+
+// Non-owning reference to a callable. Unlike std::function it never
+// allocates, so it may only be used while the callable is alive (e.g. a
+// lambda passed straight into the call that invokes it).
+template <typename R, typename... Args>
+class FunctionRef<R(Args...)> {
+public:
+    FunctionRef(std::nullptr_t) : obj_(nullptr), call_(nullptr) {}
+
+    template <typename F,
+              typename = typename std::enable_if<
+                  !std::is_same<typename std::decay<F>::type, FunctionRef>::value>::type>
+    FunctionRef(F &&f)
+        : obj_(const_cast<void *>(static_cast<const void *>(&f))),
+          call_(&invoke<typename std::remove_reference<F>::type>) {}
+
+    R operator()(Args... args) const {
+        return call_(obj_, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const { return call_ != nullptr; }
+
+private:
+    template <typename F>
+    static R invoke(void *obj, Args... args) {
+        return (*static_cast<F *>(obj))(std::forward<Args>(args)...);
+    }
+
+    void *obj_;
+    R (*call_)(void *, Args...);
+};
+
+} // namespace core
+} // namespace liftrr
@@ -0,0 +1,105 @@
+#include "core/i2c_bus.h"
+
+#include <string.h>
+
+#include <freertos/task.h>
+
+namespace liftrr {
+namespace core {
+
+I2cBus::I2cBus()
+    : mutex_(nullptr),
+      sensor_waiting_(0),
+      held_since_us_(0),
+      window_start_ms_(0) {
+    memset(stats_, 0, sizeof(stats_));
+}
+
+void I2cBus::begin() {
+    if (!mutex_) mutex_ = xSemaphoreCreateMutex();
+    resetStats();
+}
+
+bool I2cBus::acquire(I2cDevice device, I2cPriority priority, uint32_t deadlineUs, uint32_t timeoutMs) {
+    size_t idx = (size_t)device;
+    if (idx >= kDeviceCount) return false;
+    I2cDeviceStats &s = stats_[idx];
+
+    uint32_t startUs = micros();
+    if (mutex_) {
+        bool sensor = (priority == I2cPriority::SENSOR);
+        if (sensor) __atomic_add_fetch(&sensor_waiting_, 1, __ATOMIC_RELAXED);
+
+        bool granted = false;
+        TickType_t startTick = xTaskGetTickCount();
+        TickType_t timeoutTicks = pdMS_TO_TICKS(timeoutMs);
+        for (;;) {
+            TickType_t elapsed = xTaskGetTickCount() - startTick;
+            if (elapsed > timeoutTicks) break;
+            if (xSemaphoreTake(mutex_, timeoutTicks - elapsed) != pdTRUE) break;
+            if (sensor || __atomic_load_n(&sensor_waiting_, __ATOMIC_RELAXED) == 0) {
+                granted = true;
+                break;
+            }
+            // A sensor read is queued (typically from the other core): hand
+            // it the bus and queue again behind it.
+            xSemaphoreGive(mutex_);
+            taskYIELD();
+        }
+
+        if (sensor) __atomic_sub_fetch(&sensor_waiting_, 1, __ATOMIC_RELAXED);
+        if (!granted) {
+            s.timeouts++;
+            return false;
+        }
+    }
+
+    // Stats are only written while holding the bus.
+    uint32_t nowUs = micros();
+    uint32_t waitUs = nowUs - startUs;
+    s.leases++;
+    s.waitUs += waitUs;
+    if (waitUs > s.maxWaitUs) s.maxWaitUs = waitUs;
+    if (deadlineUs > 0 && waitUs > deadlineUs) s.deadlineMisses++;
+    held_since_us_ = nowUs;
+    return true;
+}
+
+void I2cBus::release(I2cDevice device) {
+    size_t idx = (size_t)device;
+    if (idx >= kDeviceCount) return;
+    stats_[idx].busyUs += micros() - held_since_us_;
+    if (mutex_) xSemaphoreGive(mutex_);
+}
+
+I2cDeviceStats I2cBus::stats(I2cDevice device) const {
+    size_t idx = (size_t)device;
+    if (idx >= kDeviceCount) return I2cDeviceStats();
+    return stats_[idx];
+}
+
+uint32_t I2cBus::statsWindowMs() const {
+    return millis() - window_start_ms_;
+}
+
+void I2cBus::resetStats() {
+    memset(stats_, 0, sizeof(stats_));
+    window_start_ms_ = millis();
+}
+
+const char *i2cDeviceName(I2cDevice device) {
+    switch (device) {
+        case I2cDevice::IMU:   return "imu";
+        case I2cDevice::LASER: return "laser";
+        case I2cDevice::OLED:  return "oled";
+        default:               return "?";
+    }
+}
+
+I2cBus &i2cBus() {
+    static I2cBus bus;
+    return bus;
+}
+
+} // namespace core
+} // namespace liftrr
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+namespace liftrr {
+namespace core {
+
+// Devices sharing the Wire bus, for accounting.
+enum class I2cDevice : uint8_t {
+    IMU = 0,
+    LASER,
+    OLED,
+    COUNT
+};
+
+// Lower value wins. A DISPLAY request backs off while a SENSOR request
+// is waiting, so sensors get the bus at the next transaction boundary.
+enum class I2cPriority : uint8_t {
+    SENSOR = 0,
+    DISPLAY
+};
+
+struct I2cDeviceStats {
+    uint32_t leases;          // bus grants
+    uint64_t busyUs;          // time holding the bus
+    uint64_t waitUs;          // time queued for the bus
+    uint32_t maxWaitUs;
+    uint32_t deadlineMisses;  // granted later than the request's deadline
+    uint32_t timeouts;        // gave up waiting
+};
+
+// Arbitrates the shared I2C bus between the sensor task and the display
+// flush on the loop task. Callers hold a lease for one device operation
+// (one or a few Wire transactions) and release it between operations;
+// the mutex's priority inheritance keeps a low-priority holder from being
+// starved while a sensor read waits on it.
+class I2cBus {
+public:
+    I2cBus();
+
+    // Creates the mutex; until then acquire() always succeeds (setup).
+    void begin();
+
+    // deadlineUs: queueing latency the caller can tolerate (stats only).
+    bool acquire(I2cDevice device, I2cPriority priority, uint32_t deadlineUs, uint32_t timeoutMs);
+    void release(I2cDevice device);
+
+    I2cDeviceStats stats(I2cDevice device) const;
+    uint32_t statsWindowMs() const;  // utilisation = busyUs / (statsWindowMs * 1000)
+    void resetStats();
+
+    // RAII lease; ok() is false when the wait timed out.
+    class Lease {
+    public:
+        Lease(I2cBus &bus, I2cDevice device, I2cPriority priority,
+              uint32_t deadlineUs, uint32_t timeoutMs = 100)
+            : bus_(bus), device_(device),
+              ok_(bus.acquire(device, priority, deadlineUs, timeoutMs)) {}
+        ~Lease() { if (ok_) bus_.release(device_); }
+        bool ok() const { return ok_; }
+
+    private:
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+
+        I2cBus &bus_;
+        I2cDevice device_;
+        bool ok_;
+    };
+
+private:
+    static const size_t kDeviceCount = (size_t)I2cDevice::COUNT;
+
+    SemaphoreHandle_t mutex_;
+    volatile uint32_t sensor_waiting_;
+    uint32_t held_since_us_;
+    uint32_t window_start_ms_;
+    I2cDeviceStats stats_[kDeviceCount];
+};
+
+const char *i2cDeviceName(I2cDevice device);
+
+// The Wire bus shared by the BNO055, VL53L1X and SSD1306.
+I2cBus &i2cBus();
+
+} // namespace core
+} // namespace liftrr
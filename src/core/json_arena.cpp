@@ -0,0 +1,105 @@
+#include "core/json_arena.h"
+
+#include "core/config.h"
+
+namespace liftrr {
+namespace core {
+
+// Set in BlockHeader::size once a block is freed; it is reclaimed when
+// everything above it has been freed too.
+static const uint32_t kFreedBit = 0x80000000UL;
+
+JsonArena::JsonArena(uint8_t *buffer, size_t size)
+    : buf_(buffer),
+      size_(size),
+      used_(0),
+      last_(0),
+      high_water_(0),
+      failures_(0) {}
+
+size_t JsonArena::blockBytes(size_t size) {
+    return sizeof(BlockHeader) + ((size + 7) & ~(size_t)7);
+}
+
+JsonArena::BlockHeader *JsonArena::headerOf(void *ptr) const {
+    return reinterpret_cast<BlockHeader *>(static_cast<uint8_t *>(ptr) - sizeof(BlockHeader));
+}
+
+void *JsonArena::allocate(size_t size) {
+    size_t need = blockBytes(size);
+    if (need > size_ - used_) {
+        failures_++;
+        return nullptr;
+    }
+    BlockHeader *header = reinterpret_cast<BlockHeader *>(buf_ + used_);
+    header->size = (uint32_t)size;
+    header->prev = (uint32_t)last_;
+    last_ = used_;
+    used_ += need;
+    if (used_ > high_water_) high_water_ = used_;
+    return header + 1;
+}
+
+void JsonArena::deallocate(void *ptr) {
+    if (!ptr) return;
+    headerOf(ptr)->size |= kFreedBit;
+
+    // Pop freed blocks off the top.
+    while (used_ > 0) {
+        BlockHeader *top = reinterpret_cast<BlockHeader *>(buf_ + last_);
+        if (!(top->size & kFreedBit)) break;
+        used_ = last_;
+        last_ = top->prev;
+    }
+}
+
+void *JsonArena::reallocate(void *ptr, size_t newSize) {
+    if (!ptr) return allocate(newSize);
+
+    BlockHeader *header = headerOf(ptr);
+    size_t offset = reinterpret_cast<uint8_t *>(header) - buf_;
+
+    // Newest block: grow or shrink in place.
+    if (offset == last_ && used_ > last_) {
+        size_t need = blockBytes(newSize);
+        if (need > size_ - last_) {
+            failures_++;
+            return nullptr;
+        }
+        header->size = (uint32_t)newSize;
+        used_ = last_ + need;
+        if (used_ > high_water_) high_water_ = used_;
+        return ptr;
+    }
+
+    if (newSize <= header->size) {
+        header->size = (uint32_t)newSize;
+        return ptr;
+    }
+
+    void *moved = allocate(newSize);
+    if (!moved) return nullptr;
+    memcpy(moved, ptr, header->size);
+    deallocate(ptr);
+    return moved;
+}
+
+namespace {
+
+alignas(8) uint8_t gRequestArenaBuf[JSON_REQUEST_ARENA_BYTES];
+alignas(8) uint8_t gMessageArenaBuf[JSON_MESSAGE_ARENA_BYTES];
+
+} // namespace
+
+JsonArena &requestArena() {
+    static JsonArena arena(gRequestArenaBuf, sizeof(gRequestArenaBuf));
+    return arena;
+}
+
+JsonArena &messageArena() {
+    static JsonArena arena(gMessageArenaBuf, sizeof(gMessageArenaBuf));
+    return arena;
+}
+
+} // namespace core
+} // namespace liftrr
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+namespace liftrr {
+namespace core {
+
+// ArduinoJson allocator over a fixed buffer. Allocation bumps a pointer;
+// freed blocks at the top are popped, so documents that are destroyed in
+// reverse order of creation (nested scopes) hand all their space back.
+// Running out returns nullptr (ArduinoJson reports NoMemory) rather than
+// falling back to the heap. Not thread-safe.
+class JsonArena : public ArduinoJson::Allocator {
+public:
+    JsonArena(uint8_t *buffer, size_t size);
+
+    void *allocate(size_t size) override;
+    void deallocate(void *ptr) override;
+    void *reallocate(void *ptr, size_t newSize) override;
+
+    size_t capacity() const { return size_; }
+    size_t used() const { return used_; }
+    size_t highWater() const { return high_water_; }
+    uint32_t failures() const { return failures_; }
+
+private:
+    // Keeps payloads 8-byte aligned for int64/double slots.
+    struct BlockHeader {
+        uint32_t size;
+        uint32_t prev;  // offset of the block below
+    };
+
+    BlockHeader *headerOf(void *ptr) const;
+    static size_t blockBytes(size_t size);
+
+    uint8_t *buf_;
+    size_t size_;
+    size_t used_;
+    size_t last_;  // offset of the newest block's header
+    size_t high_water_;
+    uint32_t failures_;
+};
+
+// Shared by the BLE and serial command paths, which both run on the loop
+// task: one for the parsed request, one for responses/events.
+JsonArena &requestArena();
+JsonArena &messageArena();
+
+} // namespace core
+} // namespace liftrr
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+
+namespace liftrr {
+namespace core {
+
+// Single-writer latest-value slot (seqlock). The writer never waits;
+// readers copy the value and retry if a write overlapped the copy. T must
+// be trivially copyable.
+template <typename T>
+class LatestValue {
+public:
+    LatestValue() : seq_(0) {}
+
+    void publish(const T &value) {
+        uint32_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);  // odd: write in progress
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&value_, &value, sizeof(T));
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    // False until the first publish().
+    bool read(T &out) const {
+        for (;;) {
+            uint32_t before = seq_.load(std::memory_order_acquire);
+            if (before == 0) return false;
+            if (before & 1) continue;
+            memcpy(&out, &value_, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == before) return true;
+        }
+    }
+
+    // Number of publishes so far.
+    uint32_t version() const { return seq_.load(std::memory_order_acquire) / 2; }
+
+private:
+    T value_;
+    std::atomic<uint32_t> seq_;
+};
+
+} // namespace core
+} // namespace liftrr
@@ -0,0 +1,246 @@
+#include "core/log.h"
+
+#include <atomic>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include "core/config.h"
+
+namespace liftrr {
+namespace core {
+
+namespace {
+
+static_assert(LOG_RING_SLOTS >= 2 && (LOG_RING_SLOTS & (LOG_RING_SLOTS - 1)) == 0,
+              "LOG_RING_SLOTS must be a power of two");
+
+const uint32_t kDrainStackBytes = 3072;
+const UBaseType_t kDrainPriority = 1;
+const BaseType_t kDrainCore = 0;
+
+const size_t kModuleCount = (size_t)LogModule::COUNT;
+
+// Bounded multi-producer/single-consumer ring of fixed-size lines. Each
+// slot carries a sequence number: a producer claims a slot with one CAS on
+// enqueue_pos, formats into it, then publishes by advancing seq. Producers
+// never block; a full ring fails the claim.
+struct LogSlot {
+    std::atomic<uint32_t> seq;
+    uint32_t ms;
+    uint8_t module;
+    uint8_t level;
+    char text[LOG_LINE_BYTES];
+};
+
+struct LogState {
+    LogSlot slots[LOG_RING_SLOTS];
+    std::atomic<uint32_t> enqueue_pos;
+    uint32_t dequeue_pos;  // drain task only
+    std::atomic<uint32_t> dropped;
+    std::atomic<uint32_t> written;
+    std::atomic<uint8_t> levels[kModuleCount];
+    SemaphoreHandle_t console;
+    TaskHandle_t task;
+
+    LogState() : enqueue_pos(0), dequeue_pos(0), dropped(0), written(0),
+                 console(nullptr), task(nullptr) {
+        for (size_t i = 0; i < LOG_RING_SLOTS; i++) {
+            slots[i].seq.store((uint32_t)i, std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < kModuleCount; i++) {
+            levels[i].store(LIFTRR_LOG_INFO, std::memory_order_relaxed);
+        }
+    }
+};
+
+LogState &state() {
+    static LogState s;
+    return s;
+}
+
+const char *const kModuleNames[kModuleCount] = {"core", "ble", "storage", "comm", "sensors"};
+const char *const kLevelNames[] = {"none", "error", "warn", "info", "debug"};
+const char kLevelTags[] = {'-', 'E', 'W', 'I', 'D'};
+
+LogSlot *claimSlot(LogState &s) {
+    uint32_t pos = s.enqueue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        LogSlot &slot = s.slots[pos & (LOG_RING_SLOTS - 1)];
+        int32_t diff = (int32_t)(slot.seq.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (s.enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                return &slot;
+            }
+        } else if (diff < 0) {
+            return nullptr;  // full
+        } else {
+            pos = s.enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void writeLine(const LogSlot &slot) {
+    char line[LOG_LINE_BYTES + 32];
+    int n = snprintf(line, sizeof(line), "[%lu][%c][%s] %s\r\n",
+                     (unsigned long)slot.ms, kLevelTags[slot.level],
+                     kModuleNames[slot.module], slot.text);
+    if (n <= 0) return;
+    if ((size_t)n >= sizeof(line)) n = sizeof(line) - 1;
+    LogConsoleGuard guard;
+    Serial.write((const uint8_t *)line, (size_t)n);
+}
+
+// Drains every published slot; returns how many were written.
+uint32_t drain(LogState &s) {
+    uint32_t count = 0;
+    for (;;) {
+        LogSlot &slot = s.slots[s.dequeue_pos & (LOG_RING_SLOTS - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != s.dequeue_pos + 1) break;
+        writeLine(slot);
+        slot.seq.store(s.dequeue_pos + LOG_RING_SLOTS, std::memory_order_release);
+        s.dequeue_pos++;
+        count++;
+    }
+    return count;
+}
+
+void drainTask(void *) {
+    LogState &s = state();
+    uint32_t droppedReported = 0;
+    for (;;) {
+        s.written.fetch_add(drain(s), std::memory_order_relaxed);
+
+        uint32_t dropped = s.dropped.load(std::memory_order_relaxed);
+        if (dropped != droppedReported) {
+            char line[48];
+            int n = snprintf(line, sizeof(line), "[%lu][W][log] dropped %lu lines\r\n",
+                             (unsigned long)millis(),
+                             (unsigned long)(dropped - droppedReported));
+            if (n > 0) {
+                LogConsoleGuard guard;
+                Serial.write((const uint8_t *)line, (size_t)n);
+            }
+            droppedReported = dropped;
+        }
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+    }
+}
+
+} // namespace
+
+void logBegin() {
+    LogState &s = state();
+    if (s.task) return;
+    if (!s.console) s.console = xSemaphoreCreateRecursiveMutex();
+    if (xTaskCreatePinnedToCore(drainTask, "logDrain", kDrainStackBytes, nullptr,
+                                kDrainPriority, &s.task, kDrainCore) != pdPASS) {
+        // Nothing will drain the ring; logStats().draining reports it.
+        s.task = nullptr;
+        LogConsoleGuard guard;
+        Serial.println("log: drain task create failed.");
+    }
+}
+
+bool logEnabled(LogModule module, uint8_t level) {
+    size_t idx = (size_t)module;
+    if (idx >= kModuleCount) return false;
+    return level != LIFTRR_LOG_NONE &&
+           level <= state().levels[idx].load(std::memory_order_relaxed);
+}
+
+void logSetLevel(LogModule module, uint8_t level) {
+    size_t idx = (size_t)module;
+    if (idx >= kModuleCount) return;
+    if (level > LIFTRR_LOG_DEBUG) level = LIFTRR_LOG_DEBUG;
+    state().levels[idx].store(level, std::memory_order_relaxed);
+}
+
+uint8_t logLevel(LogModule module) {
+    size_t idx = (size_t)module;
+    if (idx >= kModuleCount) return LIFTRR_LOG_NONE;
+    return state().levels[idx].load(std::memory_order_relaxed);
+}
+
+void logWrite(LogModule module, uint8_t level, const char *fmt, ...) {
+    LogState &s = state();
+    LogSlot *slot = claimSlot(s);
+    if (!slot) {
+        s.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    slot->ms = millis();
+    slot->module = (uint8_t)module < kModuleCount ? (uint8_t)module : 0;
+    slot->level = level <= LIFTRR_LOG_DEBUG ? level : LIFTRR_LOG_DEBUG;
+
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(slot->text, sizeof(slot->text), fmt, args);
+    va_end(args);
+    if (n < 0) slot->text[0] = '\0';
+
+    // Publish: the drain task sees seq == pos + 1.
+    uint32_t pos = slot->seq.load(std::memory_order_relaxed);
+    slot->seq.store(pos + 1, std::memory_order_release);
+}
+
+LogStats logStats() {
+    LogState &s = state();
+    LogStats out;
+    out.written = s.written.load(std::memory_order_relaxed);
+    out.dropped = s.dropped.load(std::memory_order_relaxed);
+    uint32_t enq = s.enqueue_pos.load(std::memory_order_relaxed);
+    uint32_t done = out.written;
+    out.pending = enq - done;
+    out.draining = s.task != nullptr;
+    return out;
+}
+
+const char *logModuleName(LogModule module) {
+    size_t idx = (size_t)module;
+    return idx < kModuleCount ? kModuleNames[idx] : "?";
+}
+
+const char *logLevelName(uint8_t level) {
+    return level <= LIFTRR_LOG_DEBUG ? kLevelNames[level] : "?";
+}
+
+bool parseLogModule(const char *name, LogModule *out) {
+    if (!name) return false;
+    for (size_t i = 0; i < kModuleCount; i++) {
+        if (strcasecmp(name, kModuleNames[i]) == 0) {
+            *out = (LogModule)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseLogLevel(const char *name, uint8_t *out) {
+    if (!name) return false;
+    for (uint8_t i = 0; i <= LIFTRR_LOG_DEBUG; i++) {
+        if (strcasecmp(name, kLevelNames[i]) == 0) {
+            *out = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+LogConsoleGuard::LogConsoleGuard() {
+    SemaphoreHandle_t console = state().console;
+    if (console) xSemaphoreTakeRecursive(console, portMAX_DELAY);
+}
+
+LogConsoleGuard::~LogConsoleGuard() {
+    SemaphoreHandle_t console = state().console;
+    if (console) xSemaphoreGiveRecursive(console);
+}
+
+} // namespace core
+} // namespace liftrr
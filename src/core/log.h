@@ -0,0 +1,102 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Leveled, asynchronous logging. LIFTRR_LOG* macros format into a
+// lock-free ring of fixed-size lines; a low-priority task drains it to
+// Serial, so callers never wait on the UART. A full ring drops the line
+// and counts it.
+//
+// Compile-time ceilings drop calls entirely: LIFTRR_LOG_LEVEL for every
+// module, or LIFTRR_LOG_LEVEL_<MODULE> (e.g. -DLIFTRR_LOG_LEVEL_BLE=4) for
+// one. Runtime levels (logSetLevel, log.config) filter below that.
+
+#define LIFTRR_LOG_NONE  0
+#define LIFTRR_LOG_ERROR 1
+#define LIFTRR_LOG_WARN  2
+#define LIFTRR_LOG_INFO  3
+#define LIFTRR_LOG_DEBUG 4
+
+#ifndef LIFTRR_LOG_LEVEL
+#define LIFTRR_LOG_LEVEL LIFTRR_LOG_DEBUG
+#endif
+#ifndef LIFTRR_LOG_LEVEL_CORE
+#define LIFTRR_LOG_LEVEL_CORE LIFTRR_LOG_LEVEL
+#endif
+#ifndef LIFTRR_LOG_LEVEL_BLE
+#define LIFTRR_LOG_LEVEL_BLE LIFTRR_LOG_LEVEL
+#endif
+#ifndef LIFTRR_LOG_LEVEL_STORAGE
+#define LIFTRR_LOG_LEVEL_STORAGE LIFTRR_LOG_LEVEL
+#endif
+#ifndef LIFTRR_LOG_LEVEL_COMM
+#define LIFTRR_LOG_LEVEL_COMM LIFTRR_LOG_LEVEL
+#endif
+#ifndef LIFTRR_LOG_LEVEL_SENSORS
+#define LIFTRR_LOG_LEVEL_SENSORS LIFTRR_LOG_LEVEL
+#endif
+
+namespace liftrr {
+namespace core {
+
+enum class LogModule : uint8_t {
+    CORE = 0,
+    BLE,
+    STORAGE,
+    COMM,
+    SENSORS,
+    COUNT
+};
+
+struct LogStats {
+    uint32_t written;  // lines drained to Serial
+    uint32_t dropped;  // lines lost to a full ring
+    uint32_t pending;  // lines waiting in the ring
+    bool draining;     // false if the drain task never started
+};
+
+// Starts the drain task. Lines logged earlier are buffered until then.
+void logBegin();
+
+bool logEnabled(LogModule module, uint8_t level);
+void logSetLevel(LogModule module, uint8_t level);
+uint8_t logLevel(LogModule module);
+
+void logWrite(LogModule module, uint8_t level, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+LogStats logStats();
+
+// Module/level names as used by log.config ("ble", "debug", ...).
+const char *logModuleName(LogModule module);
+const char *logLevelName(uint8_t level);
+bool parseLogModule(const char *name, LogModule *out);
+bool parseLogLevel(const char *name, uint8_t *out);
+
+// Held while writing to Serial so protocol lines and drained log lines
+// never interleave. No-op before logBegin().
+class LogConsoleGuard {
+public:
+    LogConsoleGuard();
+    ~LogConsoleGuard();
+
+private:
+    LogConsoleGuard(const LogConsoleGuard &) = delete;
+    LogConsoleGuard &operator=(const LogConsoleGuard &) = delete;
+};
+
+} // namespace core
+} // namespace liftrr
+
+#define LIFTRR_LOG(mod, lvl, ...)                                                        \
+    do {                                                                                 \
+        if (LIFTRR_LOG_LEVEL_##mod >= (lvl) &&                                           \
+            liftrr::core::logEnabled(liftrr::core::LogModule::mod, (lvl))) {             \
+            liftrr::core::logWrite(liftrr::core::LogModule::mod, (lvl), __VA_ARGS__);    \
+        }                                                                                \
+    } while (0)
+
+#define LIFTRR_LOGE(mod, ...) LIFTRR_LOG(mod, LIFTRR_LOG_ERROR, __VA_ARGS__)
+#define LIFTRR_LOGW(mod, ...) LIFTRR_LOG(mod, LIFTRR_LOG_WARN, __VA_ARGS__)
+#define LIFTRR_LOGI(mod, ...) LIFTRR_LOG(mod, LIFTRR_LOG_INFO, __VA_ARGS__)
+#define LIFTRR_LOGD(mod, ...) LIFTRR_LOG(mod, LIFTRR_LOG_DEBUG, __VA_ARGS__)
@@ -1,10 +1,15 @@
 #include "app/app_display.h"
 #include "app/app_motion.h"
+#include "app/rep_detector.h"
+#include "app/sample_clock.h"
 #include "app/serial_commands.h"
 #include "ble/ble_app.h"
 #include "comm/bt_classic.h"
 #include "core/globals.h"
+#include "core/i2c_bus.h"
+#include "core/log.h"
 #include "core/rtc.h"
+#include "sensors/sensor_task.h"
 #include "sensors/sensors.h"
 #include "storage/storage.h"
 #include "storage/storage_indicators.h"
@@ -24,18 +29,20 @@ static bool gDisplayOk = false;
 
 // Adapters + managers.
 static liftrr::sensors::Bno055Sensor gImuAdapter(gBno);
-static liftrr::sensors::Vl53l1xSensor gLaserAdapter(gLaser, 0x29, &Wire, true);
+static liftrr::sensors::Vl53l1xSensor gLaserAdapter(gLaser, 0x29, &Wire, true, LASER_INT_PIN);
 static liftrr::sensors::SensorManager gSensorManager(gImuAdapter, gLaserAdapter);
 static liftrr::storage::StorageManager gStorageManager(SD, liftrr::storage::pulseSDCardLED);
 static liftrr::core::RuntimeState gRuntimeState;
+static liftrr::sensors::SensorTask gSensorTask(gSensorManager, gRuntimeState);
 static liftrr::comm::BtClassicManager gBtClassic(SD);
 static liftrr::ble::BleManager gBleManager;
 static liftrr::ble::BleApp gBleApp(gBleManager, gRuntimeState, gSensorManager, gStorageManager, gBtClassic);
 static liftrr::ui::UiRenderer gUi(gDisplay, gSensorManager);
+static liftrr::ui::OledFlusher gOledFlusher(gDisplay, Wire, SCREEN_ADDRESS);
 static liftrr::app::DisplayManager gDisplayManager(
-    gDisplay, gUi, gStorageManager, gBleManager, gSensorManager, gRuntimeState);
+    gDisplay, gOledFlusher, gUi, gStorageManager, gBleManager, gBtClassic, gSensorManager, gRuntimeState);
 static liftrr::app::SerialCommandHandler gSerialHandler(
-    gRuntimeState, gStorageManager, gSensorManager, gBtClassic);
+    gRuntimeState, gStorageManager, gSensorManager, gSensorTask, gDisplayManager, gBtClassic);
 
 struct ModeApplier : liftrr::ble::IModeApplier {
   ModeApplier(liftrr::core::RuntimeState &runtime, liftrr::app::MotionState *state)
@@ -65,30 +72,30 @@ static ModeApplier gModeApplier(gRuntimeState, &gMotionState);
 static void initDisplay() {
   gDisplayOk = gDisplay.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS);
   if (!gDisplayOk) {
-    Serial.println("Display Init Failed");
+    LIFTRR_LOGE(CORE, "Display Init Failed");
   } else {
     gDisplay.clearDisplay();
     gDisplay.setTextSize(1);
     gDisplay.setTextColor(SSD1306_WHITE);
     gDisplay.setCursor(0, 0);
     gDisplay.println("BOOT SEQUENCE...");
-    gDisplay.display();
+    gOledFlusher.flush();
   }
 }
 
 void setup() {
   Serial.begin(115200);
-  Serial.println("--- SYSTEM START ---");
-  Serial.print("Flash size bytes: ");
-  Serial.println(ESP.getFlashChipSize());
-  Serial.print("Flash free bytes: ");
-  Serial.println(ESP.getFreeSketchSpace());
+  liftrr::core::logBegin();
+  LIFTRR_LOGI(CORE, "--- SYSTEM START ---");
+  LIFTRR_LOGI(CORE, "Flash size bytes: %lu", (unsigned long)ESP.getFlashChipSize());
+  LIFTRR_LOGI(CORE, "Flash free bytes: %lu", (unsigned long)ESP.getFreeSketchSpace());
 
   // 1. Init I2C Bus
   Wire.begin(21, 22);
-  Wire.setClock(100000);
+  Wire.setClock(I2C_CLOCK_HZ);
   Wire.setTimeout(50);
-  Serial.println("I2C Bus Initialized");
+  liftrr::core::i2cBus().begin();
+  LIFTRR_LOGI(CORE, "I2C Bus Initialized (%lu Hz)", (unsigned long)I2C_CLOCK_HZ);
   delay(100);
 
   //2 Sensors
@@ -96,10 +103,7 @@ void setup() {
  
   // 3. Display
   initDisplay();
-  Serial.println("Sensor health: IMU=OK");
-  Serial.println("Sensor health: LASER=OK");
-  Serial.print("Sensor health: DISPLAY=");
-  Serial.println(gDisplayOk ? "OK" : "FAIL");
+  LIFTRR_LOGI(CORE, "Sensor health: IMU=OK LASER=OK DISPLAY=%s", gDisplayOk ? "OK" : "FAIL");
 
   // 4. SD card
   gStorageManager.initSd();
@@ -116,69 +120,118 @@ void setup() {
 
   // 9. Classic Bluetooth
   gBtClassic.init("LIFTRR");
+
+  // 10. Sensor acquisition task (owns SensorManager::read from here on)
+  gSensorTask.begin();
+}
+
+// Hands sensor records to the SD logger on the session's fixed-rate grid.
+// Records carry their own sample time, so a slow loop pass delays the write
+// but not the data.
+static liftrr::app::SampleClock gSampleClock;
+static uint32_t gSampleClockSession = 0;
+static liftrr::app::RepDetector gRepDetector;
+static uint32_t gRepSession = 0;
+
+static void drainSensorLog() {
+  if (!gStorageManager.isSessionActive()) {
+    gSampleClock.stop();
+  } else if (!gSampleClock.running() ||
+             gSampleClockSession != gStorageManager.sessionSerial()) {
+    gSampleClockSession = gStorageManager.sessionSerial();
+    gSampleClock.start(gStorageManager.sessionSampleRateHz());
+  }
+  // Reps are counted per session only; movement outside one (setting up,
+  // re-racking) must not advance the numbering.
+  bool sessionActive = gStorageManager.isSessionActive();
+  if (sessionActive && gRepSession != gStorageManager.sessionSerial()) {
+    gRepSession = gStorageManager.sessionSerial();
+    // Rep numbers count from 1 in each session.
+    gRepDetector.restart(liftrr::app::repOrderForExercise(gStorageManager.sessionExercise().c_str()));
+  }
+
+  liftrr::sensors::SensorRecord rec;
+  bool pushed = false;
+  while (gSensorTask.popLogged(rec)) {
+    bool usable = gRuntimeState.deviceMode() == liftrr::core::MODE_RUN &&
+                  rec.calibrated &&
+                  rec.laserValid;
+    if (usable && sessionActive) {
+      gRepDetector.push(rec, [](const liftrr::storage::SessionRep &rep) {
+        bool logged = gStorageManager.logRep(rep);
+        gBleApp.notifyRep(rep, logged);
+      });
+    } else {
+      gRepDetector.gap();
+    }
+
+    if (!gSampleClock.running()) continue;
+    if (!usable) {
+      gSampleClock.gap();
+      continue;
+    }
+    gSampleClock.push(rec, [](const liftrr::app::GridRow &row) {
+      gStorageManager.logSample(row.timestampMs,
+                                row.rawDist,
+                                row.pose.relDist,
+                                row.pose.relRoll,
+                                row.pose.relPitch,
+                                row.pose.relYaw,
+                                row.flags);
+    });
+    pushed = true;
+  }
+  if (pushed) gStorageManager.setSampleStats(gSampleClock.stats());
 }
 
 void loop() {
+  uint32_t loopStartUs = micros();
   gSerialHandler.handleSerialCommands(gMotionState);
   gBleApp.loop(); // BLE periodic work
   gBtClassic.loop();
 
   unsigned long currentMillis = millis();
-  int64_t sessionTimestampMs = liftrr::core::currentEpochMs();
-  if (sessionTimestampMs <= 0) {
-    sessionTimestampMs = (int64_t)currentMillis;
-  }
+
+  // --- SD logging and rep detection: every record from the sensor task ---
+  drainSensorLog();
 
   // --- liftrr::core::MODE_DUMP: dedicated screen, no sensing/logging ---
   if (gRuntimeState.deviceMode() == liftrr::core::MODE_DUMP) {
-    if (currentMillis - gRuntimeState.lastScreenUpdate() >= SCREEN_INTERVAL) {
+    if (gDisplayManager.frameDue(currentMillis, loopStartUs)) {
       gRuntimeState.setLastScreenUpdate(currentMillis);
       gDisplayManager.renderDumpScreen();
     }
     return;
   }
 
-  //--- 1. Read sensors ---
-  liftrr::sensors::SensorSample sample;
-  gSensorManager.read(sample);
+  //--- 1. Latest sample from the sensor task ---
+  liftrr::sensors::SensorRecord latest;
+  if (!gSensorTask.latest(latest)) return;
+  const liftrr::sensors::SensorSample &sample = latest.sample;
+  const liftrr::sensors::RelativePose &pose = latest.pose;
+  liftrr::sensors::DeviceFacing facing = latest.facing;
 
-  // --- 2. Update calibration readiness flags ---
-  gMotionController.updateCalibrationStatus(sample, gSensorManager);
-  gBleApp.notifyCalibration(gSensorManager.isCalibrated(), gSensorManager.laserValid());
-  gMotionController.enforceCalibrationModeGuard(gSensorManager, gRuntimeState);
+  // --- 2. Calibration readiness ---
+  gBleApp.notifyCalibration(latest.calibrated, latest.laserValid);
+  gMotionController.enforceCalibrationModeGuard(latest.calibrated, latest.laserValid, gRuntimeState);
 
-  // --- 3. Compute relative pose ---
-  liftrr::sensors::RelativePose pose;
-  gSensorManager.computePose(sample, pose);
-  liftrr::sensors::DeviceFacing facing = gSensorManager.facingDirection(pose);
+  // --- 3. Orientation ---
   gBleApp.notifyFacing(facing);
 
-  //-- 4. SD logging: only in RUN mode with an active session ---
-    if (gRuntimeState.deviceMode() == liftrr::core::MODE_RUN &&
-        gStorageManager.isSessionActive() &&
-        gSensorManager.isCalibrated() &&
-        gSensorManager.laserValid()) {
-        gStorageManager.logSample(sessionTimestampMs,
-                                  sample.rawDist,
-                                  pose.relDist,
-                                  pose.relRoll,
-                                  pose.relPitch,
-                                  pose.relYaw);
-  }
-
-  // --- 5. Motion detection and auto mode transitions ---
+  // --- 4. Motion detection and auto mode transitions ---
     gMotionController.updateMotionAndMode(pose, currentMillis, gMotionState, gRuntimeState);
 
-  // --- 6. Display update (10 Hz) ---
-  if (currentMillis - gRuntimeState.lastScreenUpdate() >= SCREEN_INTERVAL) {
+  // --- 5. Display update (rate chosen by the governor) ---
+  gDisplayManager.noteDistance(pose.relDist, currentMillis);
+  if (gDisplayManager.frameDue(currentMillis, loopStartUs)) {
     gRuntimeState.setLastScreenUpdate(currentMillis);
-    gDisplay.clearDisplay();
 
+    // Screens clear the buffer themselves; the tracking screen is retained.
     if (gRuntimeState.deviceMode() == liftrr::core::MODE_IDLE) {
       gDisplayManager.renderIdleScreen();
     } else {
       // liftrr::core::MODE_RUN or liftrr::core::MODE_CALIBRATE
-      if (gRuntimeState.deviceMode() == liftrr::core::MODE_CALIBRATE || !gSensorManager.laserValid()) {
+      if (gRuntimeState.deviceMode() == liftrr::core::MODE_CALIBRATE || !latest.laserValid) {
         gDisplayManager.renderCalibrationOrWarmupScreen(sample);
       } else {
         if (facing == liftrr::sensors::FACING_LEFT || facing == liftrr::sensors::FACING_RIGHT) {
@@ -187,7 +240,7 @@ void loop() {
           gDisplayManager.renderTrackingScreen(pose);
         }
       }
-      gDisplay.display();
+      gOledFlusher.flush();  // changed column runs only; sensor reads run between chunks
     }
   }
 }
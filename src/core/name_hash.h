@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace liftrr {
+namespace core {
+
+constexpr char asciiLower(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+// Case-insensitive FNV-1a. constexpr so name tables can be hashed at
+// compile time; the same function hashes incoming names at run time.
+constexpr uint32_t nameHash(const char *s, uint32_t h = 2166136261UL) {
+    return *s ? nameHash(s + 1, (h ^ (uint8_t)asciiLower(*s)) * 16777619UL) : h;
+}
+
+} // namespace core
+} // namespace liftrr
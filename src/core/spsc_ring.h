@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+namespace liftrr {
+namespace core {
+
+// Bounded single-producer/single-consumer ring. Lock-free: the producer
+// only writes head_, the consumer only writes tail_. Slots are used in
+// place (prepare/commit, front/pop) so large payloads are copied once.
+// N must be a power of two.
+template <typename T, size_t N>
+class SpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+    SpscRing() : head_(0), tail_(0) {}
+
+    // Producer: slot to fill, or nullptr when full.
+    T *prepare() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= N) return nullptr;
+        return &slots_[head & (N - 1)];
+    }
+
+    // Producer: publishes the slot returned by prepare().
+    void commit() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool push(const T &value) {
+        T *slot = prepare();
+        if (!slot) return false;
+        *slot = value;
+        commit();
+        return true;
+    }
+
+    // Consumer: oldest slot, or nullptr when empty.
+    T *front() {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) return nullptr;
+        return &slots_[tail & (N - 1)];
+    }
+
+    // Consumer: releases the slot returned by front().
+    void pop() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool pop(T &out) {
+        T *slot = front();
+        if (!slot) return false;
+        out = *slot;
+        pop();
+        return true;
+    }
+
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    static size_t capacity() { return N; }
+
+private:
+    T slots_[N];
+    std::atomic<size_t> head_;
+    std::atomic<size_t> tail_;
+};
+
+} // namespace core
+} // namespace liftrr
@@ -0,0 +1,144 @@
+#include "sensors/bar_estimator.h"
+
+#include <math.h>
+
+namespace liftrr {
+namespace sensors {
+
+namespace {
+
+// Velocity uncertainty when the filter (re)starts from a laser reading.
+const float kInitialVelSigmaMmS = 500.0f;
+
+} // namespace
+
+BarEstimator::BarEstimator()
+    : running_(false),
+      last_us_(0),
+      pos_(0.0f),
+      vel_(0.0f),
+      p00_(0.0f),
+      p01_(0.0f),
+      p11_(0.0f),
+      rejects_in_row_(0),
+      corrections_(0),
+      rejects_(0),
+      resets_(0) {}
+
+float BarEstimator::verticalAccelMmS2(const SensorSample &sample) {
+    // Third row of the rotation matrix of q = (w, x, y, z): the earth-frame
+    // z (up) component of a sensor-frame vector.
+    float w = sample.quat[0];
+    float x = sample.quat[1];
+    float y = sample.quat[2];
+    float z = sample.quat[3];
+    float up = 2.0f * (x * z - w * y) * sample.linAccel.x +
+               2.0f * (y * z + w * x) * sample.linAccel.y +
+               (1.0f - 2.0f * (x * x + y * y)) * sample.linAccel.z;
+    return up * 1000.0f;
+}
+
+void BarEstimator::step(const SensorSample &sample, uint32_t sampleUs, bool laserValid,
+                        RelativePose &pose) {
+    float accel = verticalAccelMmS2(sample);
+
+    if (running_) {
+        uint32_t dtUs = sampleUs - last_us_;
+        if (dtUs > BAR_EST_MAX_GAP_US || !laserValid) {
+            running_ = false;
+            resets_++;
+        } else {
+            predict(dtUs * 1e-6f, accel);
+        }
+    }
+    last_us_ = sampleUs;
+
+    if (laserValid && sample.distFresh) {
+        if (!running_) {
+            restart(pose.relDist);
+        } else {
+            // The reading is older than this cycle; compare it with where
+            // the filter places the bar now.
+            uint32_t lagUs = sampleUs - sample.distUs;
+            float lag = (lagUs < BAR_EST_MAX_GAP_US) ? lagUs * 1e-6f : 0.0f;
+            if (!correct(pose.relDist + vel_ * lag)) {
+                if (++rejects_in_row_ >= BAR_EST_MAX_REJECTS) {
+                    // Not noise: the offset was re-zeroed or the laser
+                    // jumped to another target.
+                    restart(pose.relDist);
+                    resets_++;
+                }
+            }
+        }
+    }
+
+    pose.accelMmS2 = accel;
+    if (running_) {
+        pose.dispMm = pos_;
+        pose.velMmS = vel_;
+    } else {
+        pose.dispMm = pose.relDist;
+        pose.velMmS = 0.0f;
+    }
+}
+
+BarEstimatorStats BarEstimator::stats() const {
+    BarEstimatorStats out;
+    out.corrections = corrections_;
+    out.rejects = rejects_;
+    out.resets = resets_;
+    out.posSigmaMm = running_ ? sqrtf(p00_) : 0.0f;
+    out.velSigmaMmS = running_ ? sqrtf(p11_) : 0.0f;
+    return out;
+}
+
+void BarEstimator::restart(float distMm) {
+    const float r = BAR_EST_LASER_NOISE_MM * BAR_EST_LASER_NOISE_MM;
+    running_ = true;
+    pos_ = distMm;
+    vel_ = 0.0f;
+    p00_ = r;
+    p01_ = 0.0f;
+    p11_ = kInitialVelSigmaMmS * kInitialVelSigmaMmS;
+    rejects_in_row_ = 0;
+}
+
+void BarEstimator::predict(float dt, float accel) {
+    // x' = F x + B a with F = [1 dt; 0 1], B = [dt^2/2; dt]; the
+    // acceleration noise enters through B, so Q = q * B * B^T.
+    const float q = BAR_EST_ACCEL_NOISE_MMS2 * BAR_EST_ACCEL_NOISE_MMS2;
+    float dt2 = dt * dt;
+
+    pos_ += vel_ * dt + 0.5f * accel * dt2;
+    vel_ += accel * dt;
+
+    p00_ += 2.0f * dt * p01_ + dt2 * p11_ + q * dt2 * dt2 * 0.25f;
+    p01_ += dt * p11_ + q * dt2 * dt * 0.5f;
+    p11_ += q * dt2;
+}
+
+bool BarEstimator::correct(float distMm) {
+    const float r = BAR_EST_LASER_NOISE_MM * BAR_EST_LASER_NOISE_MM;
+    float innovation = distMm - pos_;
+    float s = p00_ + r;
+    if (innovation * innovation > BAR_EST_GATE_SIGMA * BAR_EST_GATE_SIGMA * s) {
+        rejects_++;
+        return false;
+    }
+
+    // H = [1 0]: K = P H^T / S, P' = (I - K H) P.
+    float k0 = p00_ / s;
+    float k1 = p01_ / s;
+    pos_ += k0 * innovation;
+    vel_ += k1 * innovation;
+    p11_ -= k1 * p01_;
+    p00_ -= k0 * p00_;
+    p01_ -= k0 * p01_;
+
+    rejects_in_row_ = 0;
+    corrections_++;
+    return true;
+}
+
+} // namespace sensors
+} // namespace liftrr
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "core/config.h"
+#include "sensors/sensors.h"
+
+namespace liftrr {
+namespace sensors {
+
+struct BarEstimatorStats {
+    uint32_t corrections;  // laser readings folded in
+    uint32_t rejects;      // laser readings outside the innovation gate
+    uint32_t resets;       // restarts from the laser (gap, lost lock, gate)
+    float posSigmaMm;      // current 1-sigma uncertainty
+    float velSigmaMmS;
+};
+
+// Two-state [displacement, velocity] Kalman filter along the earth vertical.
+// Every sensor cycle predicts with the BNO055 linear acceleration rotated by
+// its quaternion; each new laser reading corrects the drift. Constant time
+// per step, no allocation. Sensor task only, apart from stats().
+class BarEstimator {
+public:
+    BarEstimator();
+
+    // Advances to sampleUs and fills pose.dispMm/velMmS/accelMmS2; call
+    // after SensorManager::computePose() so pose.relDist is current.
+    void step(const SensorSample &sample, uint32_t sampleUs, bool laserValid,
+              RelativePose &pose);
+
+    BarEstimatorStats stats() const;
+
+    // Earth-frame vertical component of sample.linAccel, mm/s^2, positive up.
+    static float verticalAccelMmS2(const SensorSample &sample);
+
+private:
+    void restart(float distMm);
+    void predict(float dt, float accel);
+    bool correct(float distMm);
+
+    bool running_;
+    uint32_t last_us_;
+    float pos_;  // mm
+    float vel_;  // mm/s
+    float p00_, p01_, p11_;  // symmetric covariance
+    uint8_t rejects_in_row_;
+
+    volatile uint32_t corrections_;
+    volatile uint32_t rejects_;
+    volatile uint32_t resets_;
+};
+
+} // namespace sensors
+} // namespace liftrr
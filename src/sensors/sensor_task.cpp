@@ -0,0 +1,94 @@
+#include "sensors/sensor_task.h"
+
+#include "core/log.h"
+
+namespace liftrr {
+namespace sensors {
+
+SensorTask::SensorTask(SensorManager &sensors, liftrr::core::RuntimeState &runtime)
+    : sensors_(sensors),
+      runtime_(runtime),
+      task_(nullptr),
+      cycles_(0),
+      late_cycles_(0),
+      log_overruns_(0),
+      max_cycle_us_(0) {}
+
+bool SensorTask::begin() {
+    if (task_) return true;
+    if (xTaskCreatePinnedToCore(taskEntry, "sensors", TASK_STACK_BYTES, this,
+                                TASK_PRIORITY, &task_, TASK_CORE) != pdPASS) {
+        task_ = nullptr;
+        LIFTRR_LOGE(SENSORS, "Sensor task create failed");
+        return false;
+    }
+    LIFTRR_LOGI(SENSORS, "Sensor task started: period=%lu ms",
+                (unsigned long)SENSOR_TASK_PERIOD_MS);
+    return true;
+}
+
+bool SensorTask::latest(SensorRecord &out) const {
+    return latest_.read(out);
+}
+
+bool SensorTask::popLogged(SensorRecord &out) {
+    return log_ring_.pop(out);
+}
+
+SensorTaskStats SensorTask::stats() const {
+    SensorTaskStats out;
+    out.cycles = cycles_;
+    out.lateCycles = late_cycles_;
+    out.logOverruns = log_overruns_;
+    out.maxCycleUs = max_cycle_us_;
+    return out;
+}
+
+BarEstimatorStats SensorTask::estimatorStats() const {
+    return estimator_.stats();
+}
+
+void SensorTask::taskEntry(void *arg) {
+    static_cast<SensorTask *>(arg)->taskLoop();
+}
+
+void SensorTask::taskLoop() {
+    const TickType_t period = pdMS_TO_TICKS(SENSOR_TASK_PERIOD_MS);
+    TickType_t wake = xTaskGetTickCount();
+    uint32_t seq = 0;
+    for (;;) {
+        if (runtime_.deviceMode() != liftrr::core::MODE_DUMP) {
+            sampleOnce(seq++);
+        }
+        // pdFALSE: the cycle overran and the next one starts immediately.
+        if (xTaskDelayUntil(&wake, period) == pdFALSE) {
+            late_cycles_++;
+        }
+    }
+}
+
+void SensorTask::sampleOnce(uint32_t seq) {
+    uint32_t startUs = micros();
+
+    SensorRecord rec;
+    rec.seq = seq;
+    rec.sampleMs = millis();
+    rec.sampleUs = startUs;
+    sensors_.read(rec.sample);
+    sensors_.updateCalibrationStatus(rec.sample);
+    sensors_.computePose(rec.sample, rec.pose);
+    estimator_.step(rec.sample, rec.sampleUs, sensors_.laserValid(), rec.pose);
+    rec.facing = sensors_.facingDirection(rec.pose);
+    rec.calibrated = sensors_.isCalibrated();
+    rec.laserValid = sensors_.laserValid();
+
+    uint32_t cycleUs = micros() - startUs;
+    if (cycleUs > max_cycle_us_) max_cycle_us_ = cycleUs;
+    cycles_++;
+
+    latest_.publish(rec);
+    if (!log_ring_.push(rec)) log_overruns_++;
+}
+
+} // namespace sensors
+} // namespace liftrr
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "core/config.h"
+#include "core/globals.h"
+#include "core/latest_value.h"
+#include "core/spsc_ring.h"
+#include "sensors/bar_estimator.h"
+#include "sensors/sensors.h"
+
+namespace liftrr {
+namespace sensors {
+
+// One acquisition cycle: raw sample, derived pose and readiness flags.
+struct SensorRecord {
+    uint32_t seq;        // cycle number since the task started
+    uint32_t sampleMs;   // millis() at the start of the cycle
+    uint32_t sampleUs;   // micros() at the start of the cycle
+    SensorSample sample;
+    RelativePose pose;
+    DeviceFacing facing;
+    bool calibrated;
+    bool laserValid;
+};
+
+struct SensorTaskStats {
+    uint32_t cycles;
+    uint32_t lateCycles;    // cycle overran its period
+    uint32_t logOverruns;   // records dropped, logger ring full
+    uint32_t maxCycleUs;    // read + pose + estimator time
+};
+
+// Samples the sensors at SENSOR_TASK_PERIOD_MS on a dedicated high-priority
+// task, so the cadence does not depend on display, SD or radio work in
+// loop(). Every record goes to an SPSC ring for the logger (one consumer);
+// the most recent one is also kept in a latest-value slot for UI and BLE.
+// Sampling pauses in MODE_DUMP.
+class SensorTask {
+public:
+    SensorTask(SensorManager &sensors, liftrr::core::RuntimeState &runtime);
+
+    // Starts the task; call after SensorManager::init().
+    bool begin();
+
+    // UI/BLE: most recent record. False until the first cycle completes.
+    bool latest(SensorRecord &out) const;
+
+    // Logger (single consumer): oldest record not yet consumed.
+    bool popLogged(SensorRecord &out);
+
+    SensorTaskStats stats() const;
+    BarEstimatorStats estimatorStats() const;
+
+private:
+    static void taskEntry(void *arg);
+    void taskLoop();
+    void sampleOnce(uint32_t seq);
+
+    SensorManager &sensors_;
+    liftrr::core::RuntimeState &runtime_;
+    TaskHandle_t task_;
+    BarEstimator estimator_;
+
+    liftrr::core::SpscRing<SensorRecord, SENSOR_LOG_RING_DEPTH> log_ring_;
+    liftrr::core::LatestValue<SensorRecord> latest_;
+
+    volatile uint32_t cycles_;
+    volatile uint32_t late_cycles_;
+    volatile uint32_t log_overruns_;
+    volatile uint32_t max_cycle_us_;
+
+    static const uint32_t TASK_STACK_BYTES = 4096;
+    static const UBaseType_t TASK_PRIORITY = 5;  // above loop() (1)
+    static const BaseType_t TASK_CORE = 1;
+};
+
+} // namespace sensors
+} // namespace liftrr
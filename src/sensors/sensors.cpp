@@ -1,14 +1,20 @@
 #include <Arduino.h>
 #include <math.h>
+#include <stddef.h>
+#include <string.h>
 
+#include "core/i2c_bus.h"
+#include "core/log.h"
 #include "sensors/sensors.h"
 
 namespace liftrr {
 namespace sensors {
 
 Bno055Sensor::Bno055Sensor(Adafruit_BNO055 &imu,
-                           adafruit_bno055_opmode_t mode)
-    : imu_(imu), mode_(mode) {}
+                           adafruit_bno055_opmode_t mode,
+                           uint8_t address,
+                           TwoWire *wire)
+    : imu_(imu), mode_(mode), address_(address), wire_(wire) {}
 
 bool Bno055Sensor::begin() {
     return imu_.begin(mode_);
@@ -26,14 +32,46 @@ void Bno055Sensor::getCalibration(uint8_t *s, uint8_t *g, uint8_t *a, uint8_t *m
     imu_.getCalibration(s, g, a, m);
 }
 
+bool Bno055Sensor::readBurst(ImuBurst &out, bool withCalibration) {
+    size_t len = withCalibration ? sizeof(ImuBurst) : offsetof(ImuBurst, temp);
+
+    wire_->beginTransmission(address_);
+    wire_->write(BURST_START_REG);
+    if (wire_->endTransmission(false) != 0) return false;  // repeated start
+    if (wire_->requestFrom(address_, (uint8_t)len) != len) return false;
+    return wire_->readBytes(reinterpret_cast<uint8_t *>(&out), len) == len;
+}
+
 Vl53l1xSensor::Vl53l1xSensor(Adafruit_VL53L1X &laser,
                              uint8_t address,
                              TwoWire *wire,
-                             bool debug)
-    : laser_(laser), address_(address), wire_(wire), debug_(debug) {}
+                             bool debug,
+                             int8_t intPin)
+    : laser_(laser),
+      address_(address),
+      wire_(wire),
+      debug_(debug),
+      int_pin_(intPin),
+      irq_attached_(false),
+      budget_ms_(LASER_TIMING_BUDGET_MS),
+      irq_pending_(false),
+      irq_us_(0),
+      last_read_us_(0),
+      sample_count_(0),
+      overruns_(0),
+      missed_edges_(0) {}
 
 bool Vl53l1xSensor::begin() {
-    return laser_.begin(address_, wire_, debug_);
+    if (!laser_.begin(address_, wire_, debug_)) return false;
+    if (int_pin_ >= 0 && !irq_attached_) {
+        // GPIO1 is open-drain; the breakout pulls it up. Trigger on the edge
+        // into the active level the sensor is configured for.
+        pinMode(int_pin_, INPUT);
+        int edge = laser_.getIntPolarity() ? RISING : FALLING;
+        attachInterruptArg(digitalPinToInterrupt(int_pin_), onDataReady, this, edge);
+        irq_attached_ = true;
+    }
+    return true;
 }
 
 void Vl53l1xSensor::startRanging() {
@@ -42,6 +80,7 @@ void Vl53l1xSensor::startRanging() {
 
 void Vl53l1xSensor::setTimingBudget(uint16_t budgetMs) {
     laser_.setTimingBudget(budgetMs);
+    budget_ms_ = budgetMs;
 }
 
 bool Vl53l1xSensor::dataReady() {
@@ -56,64 +95,183 @@ void Vl53l1xSensor::clearInterrupt() {
     laser_.clearInterrupt();
 }
 
+void IRAM_ATTR Vl53l1xSensor::onDataReady(void *arg) {
+    Vl53l1xSensor *self = static_cast<Vl53l1xSensor *>(arg);
+    self->irq_us_ = micros();
+    self->irq_pending_ = true;
+}
+
+bool Vl53l1xSensor::service() {
+    uint32_t stampUs;
+    if (irq_attached_) {
+        if (irq_pending_) {
+            stampUs = irq_us_;
+            irq_pending_ = false;  // GPIO1 cannot fire again before clearInterrupt()
+        } else {
+            // An edge can be lost (e.g. GPIO1 already asserted when the ISR
+            // was attached); after three budgets without one, poll once.
+            uint32_t nowUs = micros();
+            if (nowUs - last_read_us_ < (uint32_t)budget_ms_ * 3000UL) return false;
+            last_read_us_ = nowUs;
+            if (!laser_.dataReady()) return false;
+            stampUs = nowUs;
+            missed_edges_++;
+        }
+    } else {
+        if (!laser_.dataReady()) return false;
+        stampUs = micros();
+    }
+
+    DistanceSample sample;
+    sample.timestampUs = stampUs;
+    sample.distanceMm = laser_.distance();
+    laser_.clearInterrupt();
+    last_read_us_ = micros();
+
+    if (samples_.push(sample)) {
+        sample_count_++;
+    } else {
+        overruns_++;
+    }
+    return true;
+}
+
+bool Vl53l1xSensor::popSample(DistanceSample &out) {
+    return samples_.pop(out);
+}
+
+DistanceSensorStats Vl53l1xSensor::stats() const {
+    DistanceSensorStats out;
+    out.interruptDriven = irq_attached_;
+    out.samples = sample_count_;
+    out.overruns = overruns_;
+    out.missedEdges = missed_edges_;
+    return out;
+}
+
 SensorManager::SensorManager(IIMUSensor &imu, IDistanceSensor &laser)
     : imu_(imu),
       laser_(laser),
       last_distance_(0),
+      last_distance_us_(0),
+      last_orientation_(),
+      last_lin_accel_(),
+      last_gyro_(),
+      calib_stat_(0),
+      calib_countdown_(0),
+      imu_fresh_us_(0),
+      has_imu_fresh_(false),
+      imu_errors_(0),
       laser_valid_(false),
       is_calibrated_(false),
-      laser_offset_(0),
-      roll_offset_(0.0f),
-      pitch_offset_(0.0f),
-      yaw_offset_(0.0f) {}
+      offsets_() {
+    // Identity until the first burst lands.
+    last_quat_[0] = 1.0f;
+    last_quat_[1] = last_quat_[2] = last_quat_[3] = 0.0f;
+}
 
 void SensorManager::init() {
     if (!imu_.begin()) {
-        Serial.println("BNO Fail (addr 0x28)");
+        LIFTRR_LOGE(SENSORS, "BNO Fail (addr 0x28)");
         while (1) { delay(1000); }
     }
     imu_.setExtCrystalUse(true);
     delay(100);
-    Serial.println("BNO055 initialized");
+    LIFTRR_LOGI(SENSORS, "BNO055 initialized");
 
     if (!laser_.begin()) {
-        Serial.println("Laser init failed. Halting.");
+        LIFTRR_LOGE(SENSORS, "Laser init failed. Halting.");
         while (1) { delay(1000); }
     }
     laser_.startRanging();
-    laser_.setTimingBudget(50);
-    Serial.println("Laser initialized");
+    laser_.setTimingBudget(LASER_TIMING_BUDGET_MS);
+    LIFTRR_LOGI(SENSORS, "Laser initialized (%s)",
+                laser_.stats().interruptDriven ? "GPIO1 interrupt" : "polled");
 }
 
 void SensorManager::read(SensorSample &sample) {
-    sensors_event_t event;
-    imu_.getEvent(&event);
-
-    uint8_t s = 0, g = 0, a = 0, m = 0;
-    imu_.getCalibration(&s, &g, &a, &m);
-    sample.event = event;
-    sample.s = s;
-    sample.g = g;
-    sample.a = a;
-    sample.m = m;
-
-    if (laser_.dataReady()) {
-        int16_t newDist = laser_.distance();
-        if (newDist != -1) {
-            last_distance_ = newDist;
+    // Calibration moves slowly; CALIB_STAT rides along every
+    // IMU_CALIB_POLL_DIVIDER reads instead of costing its own transaction.
+    bool pollCalib = (calib_countdown_ == 0);
+    ImuBurst burst;
+    bool burstOk;
+    {
+        liftrr::core::I2cBus::Lease lease(liftrr::core::i2cBus(), liftrr::core::I2cDevice::IMU,
+                                          liftrr::core::I2cPriority::SENSOR,
+                                          I2C_SENSOR_DEADLINE_US, SENSOR_TASK_PERIOD_MS);
+        burstOk = lease.ok() && imu_.readBurst(burst, pollCalib);
+    }
+    if (burstOk) {
+        if (pollCalib) {
+            calib_stat_ = burst.calibStat;
+            calib_countdown_ = IMU_CALIB_POLL_DIVIDER - 1;
+        } else {
+            calib_countdown_--;
+        }
+
+        sensors_vec_t orientation = sensors_vec_t();
+        orientation.x = burst.euler[0] / 16.0f;
+        orientation.y = burst.euler[1] / 16.0f;
+        orientation.z = burst.euler[2] / 16.0f;
+
+        // Fusion results land on a fixed cadence, so freshness follows the
+        // read time rather than the values: a still bar repeats the same
+        // angles without its data being stale.
+        uint32_t readUs = micros();
+        sample.imuFresh = !has_imu_fresh_ ||
+                          (readUs - imu_fresh_us_) >= IMU_FUSION_PERIOD_US * 3 / 4;
+        if (sample.imuFresh) {
+            imu_fresh_us_ = readUs;
+            has_imu_fresh_ = true;
+        }
+        last_orientation_ = orientation;
+        for (size_t i = 0; i < 3; i++) {
+            last_lin_accel_.v[i] = burst.linAccel[i] / 100.0f;
+            last_gyro_.v[i] = burst.gyro[i] / 16.0f;
+        }
+        for (size_t i = 0; i < 4; i++) {
+            last_quat_[i] = burst.quat[i] / 16384.0f;
+        }
+    } else {
+        imu_errors_++;
+        sample.imuFresh = false;
+    }
+    sample.orientation = last_orientation_;
+    sample.linAccel = last_lin_accel_;
+    sample.gyro = last_gyro_;
+    memcpy(sample.quat, last_quat_, sizeof(sample.quat));
+    sample.s = (calib_stat_ >> 6) & 0x03;
+    sample.g = (calib_stat_ >> 4) & 0x03;
+    sample.a = (calib_stat_ >> 2) & 0x03;
+    sample.m = calib_stat_ & 0x03;
+
+    {
+        // No bus traffic unless a result is ready, so the lease is cheap.
+        liftrr::core::I2cBus::Lease lease(liftrr::core::i2cBus(), liftrr::core::I2cDevice::LASER,
+                                          liftrr::core::I2cPriority::SENSOR,
+                                          I2C_SENSOR_DEADLINE_US, SENSOR_TASK_PERIOD_MS);
+        if (lease.ok()) laser_.service();
+    }
+    sample.distFresh = false;
+    DistanceSample dist;
+    while (laser_.popSample(dist)) {
+        if (dist.distanceMm != -1) {
+            last_distance_ = dist.distanceMm;
+            last_distance_us_ = dist.timestampUs;
             laser_valid_ = true;
+            sample.distFresh = true;
         }
-        laser_.clearInterrupt();
     }
 
     sample.rawDist = last_distance_;
+    sample.distUs = last_distance_us_;
 }
 
 void SensorManager::computePose(const SensorSample &sample, RelativePose &out) const {
-    out.relDist = sample.rawDist - laser_offset_;
-    out.relRoll = sample.event.orientation.y - roll_offset_;
-    out.relPitch = sample.event.orientation.z - pitch_offset_;
-    out.relYaw = sample.event.orientation.x - yaw_offset_;
+    out.relDist = sample.rawDist - offsets_.laser;
+    out.relRoll = sample.orientation.y - offsets_.roll;
+    out.relPitch = sample.orientation.z - offsets_.pitch;
+    out.relYaw = sample.orientation.x - offsets_.yaw;
 
     if (out.relYaw > 180.0f) out.relYaw -= 360.0f;
     if (out.relYaw < -180.0f) out.relYaw += 360.0f;
@@ -133,51 +291,65 @@ DeviceFacing SensorManager::facingDirection(const RelativePose &pose) const {
 }
 
 void SensorManager::updateCalibrationStatus(const SensorSample &sample) {
+    CalibrationOffsets requested;
+    while (offset_requests_.pop(requested)) offsets_ = requested;
     is_calibrated_ = (sample.s >= 2);
+
+    CalibrationState state;
+    state.calibrated = is_calibrated_;
+    state.laserValid = laser_valid_;
+    state.offsets = offsets_;
+    calibration_.publish(state);
+}
+
+SensorManager::CalibrationState SensorManager::calibration() const {
+    CalibrationState state = CalibrationState();
+    calibration_.read(state);  // all false/zero before the first cycle
+    return state;
 }
 
 bool SensorManager::isCalibrated() const {
-    return is_calibrated_;
+    return calibration().calibrated;
 }
 
 bool SensorManager::laserValid() const {
-    return laser_valid_;
+    return calibration().laserValid;
 }
 
 int16_t SensorManager::lastDistanceMm() const {
     return last_distance_;
 }
 
-int16_t SensorManager::laserOffset() const {
-    return laser_offset_;
+uint32_t SensorManager::lastDistanceUs() const {
+    return last_distance_us_;
 }
 
-float SensorManager::rollOffset() const {
-    return roll_offset_;
+DistanceSensorStats SensorManager::laserStats() const {
+    return laser_.stats();
 }
 
-float SensorManager::pitchOffset() const {
-    return pitch_offset_;
+uint32_t SensorManager::imuErrors() const {
+    return imu_errors_;
 }
 
-float SensorManager::yawOffset() const {
-    return yaw_offset_;
+int16_t SensorManager::laserOffset() const {
+    return calibration().offsets.laser;
 }
 
-void SensorManager::setLaserOffset(int16_t value) {
-    laser_offset_ = value;
+float SensorManager::rollOffset() const {
+    return calibration().offsets.roll;
 }
 
-void SensorManager::setRollOffset(float value) {
-    roll_offset_ = value;
+float SensorManager::pitchOffset() const {
+    return calibration().offsets.pitch;
 }
 
-void SensorManager::setPitchOffset(float value) {
-    pitch_offset_ = value;
+float SensorManager::yawOffset() const {
+    return calibration().offsets.yaw;
 }
 
-void SensorManager::setYawOffset(float value) {
-    yaw_offset_ = value;
+bool SensorManager::requestOffsets(const CalibrationOffsets &offsets) {
+    return offset_requests_.push(offsets);
 }
 
 } // namespace sensors
@@ -6,12 +6,19 @@
 #include <Adafruit_VL53L1X.h>
 #include <Wire.h>
 
+#include "core/config.h"
+#include "core/latest_value.h"
+#include "core/spsc_ring.h"
+
 namespace liftrr {
 namespace sensors {
 
 // Raw IMU + laser sample.
 struct SensorSample {
-    sensors_event_t event;  // orientation etc. from BNO055
+    sensors_vec_t orientation;  // Euler deg: x heading, y roll, z pitch
+    sensors_vec_t linAccel;     // m/s^2, gravity removed, sensor frame
+    sensors_vec_t gyro;         // deg/s
+    float quat[4];              // w, x, y, z; rotates sensor frame into the earth frame
 
     uint8_t s = 0;          // system calibration status
     uint8_t g = 0;          // gyro calibration status
@@ -19,14 +26,60 @@ struct SensorSample {
     uint8_t m = 0;          // mag calibration status
 
     int16_t rawDist = 0;    // latest raw distance reading (mm)
+    uint32_t distUs = 0;    // micros() when rawDist was measured
+
+    // Per-channel freshness: false when read() returned the cached value.
+    bool distFresh = false; // rawDist came from a new laser measurement
+    bool imuFresh = false;  // read landed on a new BNO055 fusion period
+};
+
+// BNO055 page-0 registers GYR_DATA_X_LSB (0x14) .. CALIB_STAT (0x35), read
+// in one I2C transaction. Little-endian, like the ESP32.
+struct __attribute__((packed)) ImuBurst {
+    int16_t gyro[3];      // 1/16 deg/s
+    int16_t euler[3];     // heading, roll, pitch; 1/16 deg
+    int16_t quat[4];      // w, x, y, z; 1/2^14
+    int16_t linAccel[3];  // 1/100 m/s^2
+    int16_t gravity[3];   // 1/100 m/s^2
+    int8_t  temp;         // deg C
+    uint8_t calibStat;    // sys[7:6] gyro[5:4] accel[3:2] mag[1:0]
+};
+
+static_assert(sizeof(ImuBurst) == 34, "ImuBurst must mirror BNO055 0x14..0x35");
+
+// One ranging result, stamped when the sensor signalled data-ready.
+struct DistanceSample {
+    uint32_t timestampUs;  // micros()
+    int16_t distanceMm;    // -1 when the sensor reported no target
+};
+
+struct DistanceSensorStats {
+    bool interruptDriven;  // false: data-ready is polled over I2C
+    uint32_t samples;      // results read into the ring
+    uint32_t overruns;     // results dropped, ring full
+    uint32_t missedEdges;  // data-ready found by the stall poll, not the ISR
 };
 
 // Pose relative to calibration offsets.
+// Zero points subtracted from raw readings by computePose().
+struct CalibrationOffsets {
+    int16_t laser = 0;   // mm
+    float roll = 0.0f;   // deg
+    float pitch = 0.0f;  // deg
+    float yaw = 0.0f;    // deg
+};
+
 struct RelativePose {
     int16_t relDist;   // mm
     float   relRoll;   // deg
     float   relPitch;  // deg
     float   relYaw;    // deg (normalized to [-180, 180])
+
+    // Filled by BarEstimator at the sensor task rate; until the laser has
+    // produced a valid reading dispMm follows relDist and velMmS is 0.
+    float   dispMm;    // fused vertical displacement, same zero as relDist
+    float   velMmS;    // vertical velocity, positive up
+    float   accelMmS2; // vertical acceleration, gravity removed, positive up
 };
 
 enum DeviceFacing {
@@ -43,6 +96,10 @@ public:
     virtual void setExtCrystalUse(bool use) = 0;
     virtual void getEvent(sensors_event_t *event) = 0;
     virtual void getCalibration(uint8_t *s, uint8_t *g, uint8_t *a, uint8_t *m) = 0;
+
+    // One transaction for every motion output; withCalibration extends it
+    // over temp/CALIB_STAT, otherwise those two fields are left untouched.
+    virtual bool readBurst(ImuBurst &out, bool withCalibration) = 0;
 };
 
 class IDistanceSensor {
@@ -54,25 +111,42 @@ public:
     virtual bool dataReady() = 0;
     virtual int16_t distance() = 0;
     virtual void clearInterrupt() = 0;
+
+    // Timestamped acquisition. service() reads a finished measurement into
+    // the sample ring (no bus traffic unless one is ready); popSample()
+    // returns the oldest unread sample.
+    virtual bool service() = 0;
+    virtual bool popSample(DistanceSample &out) = 0;
+    virtual DistanceSensorStats stats() const = 0;
 };
 
 class Bno055Sensor : public IIMUSensor {
 public:
     explicit Bno055Sensor(Adafruit_BNO055 &imu,
-                          adafruit_bno055_opmode_t mode = OPERATION_MODE_NDOF);
+                          adafruit_bno055_opmode_t mode = OPERATION_MODE_NDOF,
+                          uint8_t address = 0x28,
+                          TwoWire *wire = &Wire);
     bool begin() override;
     void setExtCrystalUse(bool use) override;
     void getEvent(sensors_event_t *event) override;
     void getCalibration(uint8_t *s, uint8_t *g, uint8_t *a, uint8_t *m) override;
+    bool readBurst(ImuBurst &out, bool withCalibration) override;
 
 private:
+    static const uint8_t BURST_START_REG = 0x14;  // GYR_DATA_X_LSB
+
     Adafruit_BNO055 &imu_;
     adafruit_bno055_opmode_t mode_;
+    uint8_t address_;
+    TwoWire *wire_;
 };
 
 class Vl53l1xSensor : public IDistanceSensor {
 public:
-    Vl53l1xSensor(Adafruit_VL53L1X &laser, uint8_t address, TwoWire *wire, bool debug);
+    // intPin: GPIO wired to the sensor's GPIO1 data-ready output, or -1
+    // to poll dataReady() over I2C.
+    Vl53l1xSensor(Adafruit_VL53L1X &laser, uint8_t address, TwoWire *wire, bool debug,
+                  int8_t intPin = -1);
     bool begin() override;
     void startRanging() override;
     void setTimingBudget(uint16_t budgetMs) override;
@@ -80,11 +154,30 @@ public:
     int16_t distance() override;
     void clearInterrupt() override;
 
+    bool service() override;
+    bool popSample(DistanceSample &out) override;
+    DistanceSensorStats stats() const override;
+
 private:
+    static void IRAM_ATTR onDataReady(void *arg);
+
     Adafruit_VL53L1X &laser_;
     uint8_t address_;
     TwoWire *wire_;
     bool debug_;
+    int8_t int_pin_;
+    bool irq_attached_;
+    uint16_t budget_ms_;
+
+    // Written by the ISR.
+    volatile bool irq_pending_;
+    volatile uint32_t irq_us_;
+
+    uint32_t last_read_us_;
+    liftrr::core::SpscRing<DistanceSample, LASER_SAMPLE_RING> samples_;
+    uint32_t sample_count_;
+    uint32_t overruns_;
+    uint32_t missed_edges_;
 };
 
 class SensorManager {
@@ -96,32 +189,56 @@ public:
     void computePose(const SensorSample &sample, RelativePose &out) const;
     DeviceFacing facingDirection(const RelativePose &pose) const;
 
+    // Sensor task only, once per cycle after read(): applies offsets queued
+    // by requestOffsets() and publishes the calibration state below.
     void updateCalibrationStatus(const SensorSample &sample);
 
+    // Calibration state as last published by the sensor task; safe to call
+    // from any task.
     bool isCalibrated() const;
     bool laserValid() const;
     int16_t lastDistanceMm() const;
+    uint32_t lastDistanceUs() const;
+    DistanceSensorStats laserStats() const;
+    uint32_t imuErrors() const;
 
     int16_t laserOffset() const;
     float rollOffset() const;
     float pitchOffset() const;
     float yawOffset() const;
 
-    void setLaserOffset(int16_t value);
-    void setRollOffset(float value);
-    void setPitchOffset(float value);
-    void setYawOffset(float value);
+    // Loop task only (single producer): hands new offsets to the sensor
+    // task, which applies them before its next pose. False if two requests
+    // are already waiting.
+    bool requestOffsets(const CalibrationOffsets &offsets);
 
 private:
+    struct CalibrationState {
+        bool calibrated;
+        bool laserValid;
+        CalibrationOffsets offsets;
+    };
+    CalibrationState calibration() const;
+
     IIMUSensor &imu_;
     IDistanceSensor &laser_;
     int16_t last_distance_;
+    uint32_t last_distance_us_;
+    sensors_vec_t last_orientation_;
+    sensors_vec_t last_lin_accel_;
+    sensors_vec_t last_gyro_;
+    float last_quat_[4];
+    uint8_t calib_stat_;        // last CALIB_STAT read
+    uint8_t calib_countdown_;   // reads until CALIB_STAT is polled again
+    uint32_t imu_fresh_us_;     // micros() of the last read counted as a new fusion result
+    bool has_imu_fresh_;
+    uint32_t imu_errors_;
+    // Owned by the sensor task; other tasks read calibration_.
     bool laser_valid_;
     bool is_calibrated_;
-    int16_t laser_offset_;
-    float roll_offset_;
-    float pitch_offset_;
-    float yaw_offset_;
+    CalibrationOffsets offsets_;
+    liftrr::core::SpscRing<CalibrationOffsets, 2> offset_requests_;
+    liftrr::core::LatestValue<CalibrationState> calibration_;
 };
 
 } // namespace sensors
@@ -0,0 +1,102 @@
+#include <Arduino.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "storage/session_format.h"
+
+namespace liftrr {
+namespace storage {
+
+const char *sessionFormatName(SessionFormat format) {
+    return format == SESSION_FORMAT_BINARY ? "binary" : "csv";
+}
+
+const char *sessionFormatExtension(SessionFormat format) {
+    return format == SESSION_FORMAT_BINARY ? ".lrb" : ".csv";
+}
+
+bool parseSessionFormat(const char *name, SessionFormat *out) {
+    if (!name || !out) return false;
+    if (strcasecmp(name, "csv") == 0) {
+        *out = SESSION_FORMAT_CSV;
+        return true;
+    }
+    if (strcasecmp(name, "binary") == 0 || strcasecmp(name, "bin") == 0 ||
+        strcasecmp(name, "lrb") == 0) {
+        *out = SESSION_FORMAT_BINARY;
+        return true;
+    }
+    return false;
+}
+
+bool isSupportedSampleRate(int64_t hz) {
+    return hz == 20 || hz == 50 || hz == 100;
+}
+
+int16_t toFixedAngle(float deg) {
+    float scaled = deg * BINARY_ANGLE_SCALE;
+    if (scaled > 32767.0f) return 32767;
+    if (scaled < -32768.0f) return -32768;
+    return (int16_t)lroundf(scaled);
+}
+
+int32_t storedAngle(float deg, SessionFormat format) {
+    if (format == SESSION_FORMAT_BINARY) return toFixedAngle(deg);
+    return (int32_t)lroundf(deg * 1000.0f);  // CSV keeps three decimals
+}
+
+bool sessionRowChanged(const SessionSampleRow &row,
+                       const SessionSampleRow &last,
+                       const SessionChangeLog &changeLog,
+                       SessionFormat format) {
+    if ((row.flags & RECORD_FLAG_RESYNC) != 0) return true;
+    if (row.timestampMs - last.timestampMs >= (int64_t)changeLog.heartbeatMs) return true;
+
+    if (abs(row.distMm - last.distMm) > changeLog.deadbandMm) return true;
+    if (abs(row.relDistMm - last.relDistMm) > changeLog.deadbandMm) return true;
+
+    int32_t band = storedAngle(changeLog.deadbandDeg, format);
+    int32_t fullTurn = storedAngle(360.0f, format);
+    const float now[3] = {row.rollDeg, row.pitchDeg, row.yawDeg};
+    const float prev[3] = {last.rollDeg, last.pitchDeg, last.yawDeg};
+    for (size_t i = 0; i < 3; i++) {
+        int32_t diff = abs(storedAngle(now[i], format) - storedAngle(prev[i], format));
+        if (diff > fullTurn / 2) diff = fullTurn - diff;  // yaw wraps at +/-180
+        if (diff > band) return true;
+    }
+    return false;
+}
+
+size_t encodeBinarySample(const SessionSampleRow &row,
+                          bool hasLast,
+                          int64_t lastTimestampMs,
+                          uint8_t *out) {
+    size_t len = 0;
+    int64_t delta = row.timestampMs - lastTimestampMs;
+    if (!hasLast || delta < 0 || delta > 0xFFFF) {
+        BinaryTimestampRecord ts;
+        ts.dtMs = 0;
+        ts.flags = RECORD_FLAG_TIMESTAMP;
+        ts.timestampMs = row.timestampMs;
+        ts.reserved = 0;
+        memcpy(out, &ts, sizeof(ts));
+        len += sizeof(ts);
+        delta = 0;
+    }
+
+    BinarySampleRecord rec;
+    rec.dtMs = (uint16_t)delta;
+    rec.flags = row.flags & (uint16_t)~RECORD_FLAG_TIMESTAMP;
+    rec.distMm = row.distMm;
+    rec.relDistMm = row.relDistMm;
+    rec.roll = toFixedAngle(row.rollDeg);
+    rec.pitch = toFixedAngle(row.pitchDeg);
+    rec.yaw = toFixedAngle(row.yawDeg);
+    memcpy(out + len, &rec, sizeof(rec));
+    len += sizeof(rec);
+    return len;
+}
+
+} // namespace storage
+} // namespace liftrr
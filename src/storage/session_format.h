@@ -0,0 +1,187 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace liftrr {
+namespace storage {
+
+// On-disk session encodings. CSV stays the default for existing readers.
+enum SessionFormat : uint8_t {
+    SESSION_FORMAT_CSV = 0,
+    SESSION_FORMAT_BINARY = 1,
+};
+
+const char *sessionFormatName(SessionFormat format);
+const char *sessionFormatExtension(SessionFormat format);
+bool parseSessionFormat(const char *name, SessionFormat *out);
+
+// Fixed logging grid rates accepted by session.start "rateHz".
+bool isSupportedSampleRate(int64_t hz);
+
+// Logging grid statistics, written into the session header at session end.
+struct SessionSampleStats {
+    uint16_t rateHz;
+    uint32_t rows;          // grid rows emitted
+    uint32_t heldRows;      // angles held across a source gap, not interpolated
+    uint32_t resyncs;       // grid restarted after a pause in logging
+    uint32_t jitterMeanUs;  // mean |sensor interval - SENSOR_TASK_PERIOD_MS|
+    uint32_t jitterMaxUs;
+};
+
+// Change-driven logging: a grid row is written only when its values differ
+// from the last written row by more than the dead-band, or heartbeatMs has
+// passed. Flags do not force a write; the next written row carries the OR of
+// the skipped rows' flags, so DIST_FRESH / IMU_HELD mean "at some tick since
+// the previous written row". Readers rebuild the dense series by repeating
+// the last written row on each missing grid tick, except across a row flagged
+// RECORD_FLAG_RESYNC (the row before it and the final row are always
+// written). With zero dead-bands the values are lossless at the file's
+// resolution; per-tick flags are not.
+struct SessionChangeLog {
+    bool enabled = false;
+    uint16_t deadbandMm = 0;    // dist_mm / relDist_mm
+    float deadbandDeg = 0.0f;   // roll / pitch / yaw
+    uint16_t heartbeatMs = 0;
+};
+
+// One completed rep from the on-device rep detector, appended to the
+// session's rep table: <sessionId>.rep next to the session file, CSV with
+// the columns of SESSION_REP_COLUMNS.
+struct SessionRep {
+    uint16_t index;          // 1-based within the session
+    int64_t startMs;         // same time base as the session rows
+    int64_t endMs;
+    uint16_t romMm;          // concentric range of motion
+    uint16_t meanVelMmS;     // mean concentric velocity
+    uint16_t peakVelMmS;     // peak concentric velocity
+    uint32_t concentricMs;
+    uint32_t tutMs;          // time under tension, both phases
+    float rollMinDeg;
+    float rollMaxDeg;
+    float pitchMinDeg;
+    float pitchMaxDeg;
+};
+
+static const char *const SESSION_REP_EXTENSION = ".rep";
+static const char *const SESSION_REP_COLUMNS =
+    "rep,start_ms,end_ms,rom_mm,mean_vel_mm_s,peak_vel_mm_s,concentric_ms,tut_ms,"
+    "roll_min,roll_max,pitch_min,pitch_max";
+
+// Binary session file (.lrb), little-endian:
+//   BinarySessionHeader (headerSize bytes)
+//   N x 14-byte records, either BinarySampleRecord or BinaryTimestampRecord.
+// A timestamp record (flags & RECORD_FLAG_TIMESTAMP) sets the absolute time;
+// each following sample adds its dtMs to the running timestamp. Writers emit
+// a timestamp record first and whenever the delta does not fit in uint16.
+static const uint32_t BINARY_SESSION_MAGIC = 0x4252524CUL;  // "LRRB"
+static const uint16_t BINARY_SESSION_VERSION = 3;  // 2: sample grid + stats, 3: change-driven rows
+static const int16_t BINARY_ANGLE_SCALE = 64;  // 1/64 deg per LSB
+
+static const uint16_t RECORD_FLAG_TIMESTAMP = 0x0001;
+// Sample records (CSV "flags" column, same bits):
+static const uint16_t RECORD_FLAG_DIST_FRESH = 0x0002;  // dist is a new laser measurement
+static const uint16_t RECORD_FLAG_IMU_HELD = 0x0004;    // angles held, not interpolated
+static const uint16_t RECORD_FLAG_RESYNC = 0x0008;      // first row after a logging gap
+
+static const char *const BINARY_SESSION_SCHEMA =
+    "dt_ms:u16,flags:u16,dist_mm:i16,relDist_mm:i16,"
+    "roll_deg:i16/64,pitch_deg:i16/64,yaw_deg:i16/64";
+
+// Filled in at session end; zero in a file that was never closed.
+struct __attribute__((packed)) BinarySampleStats {
+    uint32_t rows;
+    uint32_t heldRows;
+    uint32_t resyncs;
+    uint32_t jitterMeanUs;
+    uint32_t jitterMaxUs;
+};
+
+struct __attribute__((packed)) BinarySessionHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint16_t recordSize;
+    int16_t  angleScale;
+    int16_t  calibLaserOffset;  // mm
+    uint16_t reserved0;
+    float    calibRollOffset;   // deg
+    float    calibPitchOffset;  // deg
+    float    calibYawOffset;    // deg
+    char     sessionId[64];
+    char     exercise[32];
+    char     schema[104];
+    uint16_t sampleRateHz;      // fixed grid; records are 1000/rate ms apart
+    uint16_t changeHeartbeatMs; // 0: every grid row is written
+    BinarySampleStats sampleStats;
+    uint16_t changeDeadbandMm;
+    int16_t  changeDeadbandAngle;  // 1/angleScale deg
+};
+
+struct __attribute__((packed)) BinarySampleRecord {
+    uint16_t dtMs;
+    uint16_t flags;
+    int16_t  distMm;
+    int16_t  relDistMm;
+    int16_t  roll;
+    int16_t  pitch;
+    int16_t  yaw;
+};
+
+struct __attribute__((packed)) BinaryTimestampRecord {
+    uint16_t dtMs;      // always 0
+    uint16_t flags;     // RECORD_FLAG_TIMESTAMP
+    int64_t  timestampMs;
+    uint16_t reserved;
+};
+
+static_assert(sizeof(BinarySessionHeader) == 256, "binary header must stay 256 bytes");
+static_assert(sizeof(BinarySampleRecord) == 14, "binary record must stay 14 bytes");
+static_assert(sizeof(BinaryTimestampRecord) == sizeof(BinarySampleRecord),
+              "all binary records share one size");
+
+// Room for a session.start "lift" name and its NUL; longer names are cut.
+static const size_t SESSION_LIFT_BYTES = sizeof(BinarySessionHeader::exercise);
+
+// One grid row as handed to the session writer, before encoding.
+struct SessionSampleRow {
+    int64_t timestampMs;
+    int16_t distMm;
+    int16_t relDistMm;
+    float rollDeg;
+    float pitchDeg;
+    float yawDeg;
+    uint16_t flags;  // RECORD_FLAG_* sample bits
+};
+
+// Degrees to 1/BINARY_ANGLE_SCALE units, saturating at the int16 range.
+int16_t toFixedAngle(float deg);
+
+// An angle in the units `format` stores: binary units, or CSV's three
+// decimals as thousandths of a degree.
+int32_t storedAngle(float deg, SessionFormat format);
+
+// Change-driven logging: whether `row` must be written given the last
+// written row (see SessionChangeLog). Compares in the units the file
+// stores, so a zero dead-band only skips rows that would be written
+// identically. Flag bits are not compared.
+bool sessionRowChanged(const SessionSampleRow &row,
+                       const SessionSampleRow &last,
+                       const SessionChangeLog &changeLog,
+                       SessionFormat format);
+
+// Largest encodeBinarySample() output.
+static const size_t BINARY_SAMPLE_MAX_BYTES =
+    sizeof(BinaryTimestampRecord) + sizeof(BinarySampleRecord);
+
+// Encodes `row` for a .lrb file whose previous sample was at
+// lastTimestampMs (hasLast false for the first sample): a timestamp record
+// when there is no usable uint16 delta, then the sample record. Writes at
+// most BINARY_SAMPLE_MAX_BYTES to out and returns the byte count.
+size_t encodeBinarySample(const SessionSampleRow &row,
+                          bool hasLast,
+                          int64_t lastTimestampMs,
+                          uint8_t *out);
+
+} // namespace storage
+} // namespace liftrr
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace liftrr {
+namespace storage {
+
+// Binary session index (/sessions/index.bin), little-endian:
+//   SessionIndexHeader, then fixed-size SessionIndexRecord entries in
+//   append order. Entry i lives at headerSize + i * recordSize, so cursor
+//   pagination is one seek; the count is derived from the file size.
+static const uint32_t SESSION_INDEX_MAGIC = 0x58444952UL;  // "RIDX"
+static const uint16_t SESSION_INDEX_VERSION = 1;
+
+static const uint32_t INDEX_FLAG_FINAL  = 0x0001;  // finalized .csv/.lrb
+static const uint32_t INDEX_FLAG_TMP    = 0x0002;  // unfinished .tmp
+static const uint32_t INDEX_FLAG_BINARY = 0x0004;  // .lrb session format
+static const uint32_t INDEX_FLAG_REPS   = 0x0008;  // <id>.rep rep table next to it
+
+struct __attribute__((packed)) SessionIndexHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint16_t recordSize;
+    uint16_t reserved0;
+    uint32_t reserved1;
+};
+
+struct __attribute__((packed)) SessionIndexRecord {
+    char     name[64];
+    uint32_t size;
+    uint32_t sampleCount;
+    uint64_t mtimeMs;
+    uint32_t flags;
+    uint32_t idHash;  // sessionIdHash() of the name without extension
+    uint8_t  reserved[8];
+};
+
+static_assert(sizeof(SessionIndexHeader) == 16, "index header must stay 16 bytes");
+static_assert(sizeof(SessionIndexRecord) == 96, "index record must stay 96 bytes");
+
+// Room for a session file name (id plus extension) and its NUL.
+static const size_t SESSION_NAME_BYTES = sizeof(SessionIndexRecord::name);
+
+// Entry handed to readSessionIndex() callbacks.
+struct SessionIndexEntry {
+    const char *name;
+    uint32_t size;
+    uint64_t mtimeMs;
+    uint32_t sampleCount;
+    uint32_t flags;
+    size_t position;  // record number, usable as a cursor
+};
+
+// FNV-1a over the session id, stopping at the extension dot.
+inline uint32_t sessionIdHash(const char *name) {
+    uint32_t h = 2166136261UL;
+    for (const char *p = name; p && *p && *p != '.'; ++p) {
+        h ^= (uint8_t)*p;
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+} // namespace storage
+} // namespace liftrr
@@ -1,22 +1,56 @@
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include <ctype.h>
+#include <stddef.h>
+#include <unistd.h>
 
 #include "core/config.h"
+#include "core/log.h"
 #include "storage/storage.h"
 
 namespace liftrr {
 namespace storage {
 
-const char *const StorageManager::SESSION_INDEX_PATH = "/sessions/index.ndjson";
+const char *const StorageManager::SESSION_INDEX_PATH = "/sessions/index.bin";
+const char *const StorageManager::SESSION_INDEX_NDJSON_PATH = "/sessions/index.ndjson";
 const char *const StorageManager::SESSIONS_DIR_PATH = "/sessions";
+constexpr const char *StorageManager::DEFAULT_SD_MOUNT_POINT;
 
-StorageManager::StorageManager(fs::SDFS &sd, void (*pulseFn)())
+StorageManager::StorageManager(fs::SDFS &sd, void (*pulseFn)(), const char *mountPoint)
     : sd_(sd),
       pulse_fn_(pulseFn),
+      mount_point_(mountPoint),
       sd_ready_(false),
       session_active_(false),
-      last_sd_flush_ms_(0) {}
+      session_format_(SESSION_FORMAT_CSV),
+      has_last_sample_ts_(false),
+      last_sample_ts_ms_(0),
+      log_writer_(SD_LOG_BLOCK_COUNT, SD_LOG_BLOCK_SIZE, SD_FLUSH_INTERVAL_MS, pulseFn),
+      prealloc_bytes_(0),
+      session_sample_count_(0),
+      session_serial_(0),
+      sample_stats_(),
+      csv_stats_offset_(0),
+      change_log_(),
+      has_last_row_(false),
+      last_row_(),
+      has_held_row_(false),
+      held_row_(),
+      skipped_rows_(0),
+      skipped_flags_(0),
+      rep_writer_(SD_REP_BLOCK_COUNT, SD_REP_BLOCK_SIZE, SD_FLUSH_INTERVAL_MS, pulseFn, "repWriter"),
+      session_rep_count_(0),
+      index_ready_(false),
+      index_cache_loaded_(false),
+      index_slots_(),
+      index_slot_used_(0),
+      index_cache_full_(false) {}
+
+static void copyField(char *dst, size_t dstLen, const char *src) {
+    if (dstLen == 0) return;
+    strncpy(dst, src ? src : "", dstLen - 1);
+    dst[dstLen - 1] = '\0';
+}
 
 static bool isLeapYear(int year) {
     if ((year % 4) != 0) return false;
@@ -68,13 +102,13 @@ static void formatEpochMs(int64_t epochMs, char *out, size_t outLen) {
              day, month, year, hour, minute, second);
 }
 
-static void sanitizeLiftName(const String &in, char *out, size_t outLen) {
+static void sanitizeLiftName(const char *in, char *out, size_t outLen) {
     if (outLen == 0) return;
     size_t j = 0;
     bool lastDash = false;
 
-    for (size_t i = 0; i < in.length() && j + 1 < outLen; i++) {
-        char c = in.charAt(i);
+    for (size_t i = 0; in && in[i] != '\0' && j + 1 < outLen; i++) {
+        char c = in[i];
         if (isalnum(static_cast<unsigned char>(c))) {
             out[j++] = c;
             lastDash = false;
@@ -101,24 +135,16 @@ static void sanitizeLiftName(const String &in, char *out, size_t outLen) {
     out[j] = '\0';
 }
 
-String StorageManager::buildSessionId(const String &exercise, int64_t epochMs) const {
+void StorageManager::buildSessionId(const char *exercise, int64_t epochMs, char *out, size_t outSize) const {
     char timestamp[32];
     char lift[32];
     formatEpochMs(epochMs, timestamp, sizeof(timestamp));
     sanitizeLiftName(exercise, lift, sizeof(lift));
-    String out = String(timestamp);
-    out += "-";
-    out += lift;
-    out += "-LIFTRR";
-    return out;
+    snprintf(out, outSize, "%s-%s-LIFTRR", timestamp, lift);
 }
 
 File StorageManager::openForAppend(const char *path) {
-    File f = sd_.open(path, FILE_WRITE);
-    if (f) {
-        f.seek(f.size());
-    }
-    return f;
+    return sd_.open(path, FILE_APPEND);
 }
 
 String StorageManager::basenameFromPath(const String &path) {
@@ -138,8 +164,8 @@ void StorageManager::pulseIndicator() const {
 bool StorageManager::initSd() {
     if (sd_ready_) return true;
 
-    if (!sd_.begin(SD_CS)) {
-        Serial.println("SD init failed");
+    if (!sd_.begin(SD_CS, SPI, SD_SPI_FREQUENCY_HZ, mount_point_)) {
+        LIFTRR_LOGE(STORAGE, "SD init failed");
         sd_ready_ = false;
         return false;
     }
@@ -147,7 +173,7 @@ bool StorageManager::initSd() {
     sd_.mkdir(SESSIONS_DIR_PATH);
 
     sd_ready_ = true;
-    Serial.println("SD init OK");
+    LIFTRR_LOGI(STORAGE, "SD init OK");
     return true;
 }
 
@@ -160,10 +186,11 @@ bool StorageManager::startSession(const String &sessionId,
                                   int16_t calibLaserOffset,
                                   float calibRollOffset,
                                   float calibPitchOffset,
-                                  float calibYawOffset) {
+                                  float calibYawOffset,
+                                  const SessionOptions &options) {
     pulseIndicator();
     if (session_active_) {
-        Serial.println("storageStartSession: session already active.");
+        LIFTRR_LOGW(STORAGE, "storageStartSession: session already active.");
         return false;
     }
 
@@ -176,75 +203,389 @@ bool StorageManager::startSession(const String &sessionId,
     String dir = SESSIONS_DIR_PATH;
     sd_.mkdir(dir);
 
-    if (!sd_.exists(SESSION_INDEX_PATH)) {
-        File idx = sd_.open(SESSION_INDEX_PATH, FILE_WRITE);
-        if (idx) idx.close();
+    if (!ensureSessionIndex()) {
+        LIFTRR_LOGW(STORAGE, "storageStartSession: session index unavailable.");
     }
 
     String tmpPath = dir + "/" + sessionId + ".tmp";
 
     session_file_ = sd_.open(tmpPath, FILE_WRITE);
     if (!session_file_) {
-        Serial.print("storageStartSession: failed to open ");
-        Serial.println(tmpPath);
+        LIFTRR_LOGE(STORAGE, "storageStartSession: failed to open %s", tmpPath.c_str());
+        current_session_id_ = "";
+        return false;
+    }
+
+    if (!log_writer_.begin()) {
+        LIFTRR_LOGE(STORAGE, "storageStartSession: write-behind logger unavailable.");
+        session_file_.close();
+        sd_.remove(tmpPath);
         current_session_id_ = "";
         return false;
     }
+    log_writer_.attach(session_file_);
 
-    session_file_.println("# liftrr session");
-    session_file_.print("# session_id="); session_file_.println(sessionId);
-    session_file_.print("# exercise=");   session_file_.println(exercise);
-    session_file_.print("# calib_laserOffset="); session_file_.println(calibLaserOffset);
-    session_file_.print("# calib_rollOffset=");  session_file_.println(calibRollOffset);
-    session_file_.print("# calib_pitchOffset="); session_file_.println(calibPitchOffset);
-    session_file_.print("# calib_yawOffset=");   session_file_.println(calibYawOffset);
+    // Queued ahead of the header: the writer task extends the file first.
+    prealloc_bytes_ = preallocBytesFor(options);
+    if (prealloc_bytes_ > 0 && !log_writer_.reserve(prealloc_bytes_)) {
+        LIFTRR_LOGW(STORAGE, "storageStartSession: pre-allocation not queued, growing on demand.");
+        prealloc_bytes_ = 0;
+    }
 
-    session_file_.println("timestamp_ms,dist_mm,relDist_mm,roll_deg,pitch_deg,yaw_deg");
-    session_file_.flush();
+    SessionFormat format = options.format;
+    session_format_ = format;
+    session_sample_count_ = 0;
+    session_serial_++;
+    memset(&sample_stats_, 0, sizeof(sample_stats_));
+    sample_stats_.rateHz = options.sampleRateHz;
+    session_exercise_ = exercise;
+    csv_stats_offset_ = 0;
+    change_log_ = options.changeLog;
+    has_last_row_ = false;
+    has_held_row_ = false;
+    skipped_rows_ = 0;
+    skipped_flags_ = 0;
+    has_last_sample_ts_ = false;
+    last_sample_ts_ms_ = 0;
+    session_rep_count_ = 0;
+
+    bool headerOk = (format == SESSION_FORMAT_BINARY)
+        ? writeBinaryHeader(sessionId, exercise, calibLaserOffset,
+                            calibRollOffset, calibPitchOffset, calibYawOffset)
+        : writeCsvHeader(sessionId, exercise, calibLaserOffset,
+                         calibRollOffset, calibPitchOffset, calibYawOffset);
+    if (!headerOk) {
+        LIFTRR_LOGE(STORAGE, "storageStartSession: failed to write header.");
+        log_writer_.detach();
+        session_file_.close();
+        sd_.remove(tmpPath);
+        current_session_id_ = "";
+        return false;
+    }
+
+    openRepTable(sessionId);
     session_active_ = true;
-    last_sd_flush_ms_ = millis();
 
-    Serial.print("Session started: ");
-    Serial.println(tmpPath);
+    LIFTRR_LOGI(STORAGE, "Session started: %s format=%s rate=%u Hz changeLog=%s prealloc=%lu",
+                tmpPath.c_str(), sessionFormatName(format), (unsigned)options.sampleRateHz,
+                change_log_.enabled ? "on" : "off", (unsigned long)prealloc_bytes_);
     pulseIndicator();
     return true;
 }
 
+uint32_t StorageManager::preallocBytesFor(const SessionOptions &options) const {
+    if (options.expectedDurationS == 0) return 0;
+
+    uint32_t bytesPerSample = (options.format == SESSION_FORMAT_BINARY)
+        ? (uint32_t)sizeof(BinarySampleRecord)
+        : CSV_BYTES_PER_SAMPLE;
+    uint32_t samplesPerSecond = options.sampleRateHz;
+    uint64_t bytes = (uint64_t)options.expectedDurationS * samplesPerSecond * bytesPerSample;
+    if (options.format == SESSION_FORMAT_BINARY) bytes += sizeof(BinarySessionHeader);
+
+    bytes = ((bytes + PREALLOC_CLUSTER_BYTES - 1) / PREALLOC_CLUSTER_BYTES) * PREALLOC_CLUSTER_BYTES;
+    if (bytes > PREALLOC_MAX_BYTES) bytes = PREALLOC_MAX_BYTES;
+    return (uint32_t)bytes;
+}
+
+void StorageManager::truncateSessionFile(const String &path, uint32_t length) {
+    String vfsPath = String(mount_point_) + path;
+    if (truncate(vfsPath.c_str(), (off_t)length) != 0) {
+        LIFTRR_LOGE(STORAGE, "storageEndSession: truncate failed for %s", path.c_str());
+    }
+}
+
+bool StorageManager::writeCsvHeader(const String &sessionId,
+                                    const String &exercise,
+                                    int16_t calibLaserOffset,
+                                    float calibRollOffset,
+                                    float calibPitchOffset,
+                                    float calibYawOffset) {
+    char header[640];
+    int n = snprintf(header, sizeof(header),
+                     "# liftrr session\r\n"
+                     "# session_id=%s\r\n"
+                     "# exercise=%s\r\n"
+                     "# calib_laserOffset=%d\r\n"
+                     "# calib_rollOffset=%.2f\r\n"
+                     "# calib_pitchOffset=%.2f\r\n"
+                     "# calib_yawOffset=%.2f\r\n"
+                     "# sample_rate_hz=%u\r\n"
+                     "# change_log=heartbeat_ms=%u,deadband_mm=%u,deadband_deg=%.3f\r\n"
+                     "# sample_stats=",
+                     sessionId.c_str(),
+                     exercise.c_str(),
+                     calibLaserOffset,
+                     calibRollOffset,
+                     calibPitchOffset,
+                     calibYawOffset,
+                     (unsigned)sample_stats_.rateHz,
+                     change_log_.enabled ? (unsigned)change_log_.heartbeatMs : 0U,
+                     (unsigned)change_log_.deadbandMm,
+                     change_log_.deadbandDeg);
+    if (n <= 0 || (size_t)n + CSV_STATS_WIDTH >= sizeof(header)) return false;
+
+    // Blank value of fixed width; patchSampleStats() overwrites it in place.
+    csv_stats_offset_ = (uint32_t)n;
+    memset(header + n, ' ', CSV_STATS_WIDTH);
+    size_t len = (size_t)n + CSV_STATS_WIDTH;
+    int m = snprintf(header + len, sizeof(header) - len,
+                     "\r\ntimestamp_ms,dist_mm,relDist_mm,roll_deg,pitch_deg,yaw_deg,flags\r\n");
+    if (m <= 0 || len + (size_t)m >= sizeof(header)) return false;
+    len += (size_t)m;
+    return log_writer_.append(header, len);
+}
+
+bool StorageManager::writeBinaryHeader(const String &sessionId,
+                                       const String &exercise,
+                                       int16_t calibLaserOffset,
+                                       float calibRollOffset,
+                                       float calibPitchOffset,
+                                       float calibYawOffset) {
+    BinarySessionHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = BINARY_SESSION_MAGIC;
+    header.version = BINARY_SESSION_VERSION;
+    header.headerSize = sizeof(BinarySessionHeader);
+    header.recordSize = sizeof(BinarySampleRecord);
+    header.angleScale = BINARY_ANGLE_SCALE;
+    header.calibLaserOffset = calibLaserOffset;
+    header.calibRollOffset = calibRollOffset;
+    header.calibPitchOffset = calibPitchOffset;
+    header.calibYawOffset = calibYawOffset;
+    copyField(header.sessionId, sizeof(header.sessionId), sessionId.c_str());
+    copyField(header.exercise, sizeof(header.exercise), exercise.c_str());
+    copyField(header.schema, sizeof(header.schema), BINARY_SESSION_SCHEMA);
+    header.sampleRateHz = sample_stats_.rateHz;
+    if (change_log_.enabled) {
+        header.changeHeartbeatMs = change_log_.heartbeatMs;
+        header.changeDeadbandMm = change_log_.deadbandMm;
+        header.changeDeadbandAngle = toFixedAngle(change_log_.deadbandDeg);
+    }
+
+    return log_writer_.append(&header, sizeof(header));
+}
+
 bool StorageManager::logSample(int64_t timestampMs,
                                int16_t distMm,
                                int16_t relDistMm,
                                float rollDeg,
                                float pitchDeg,
-                               float yawDeg) {
+                               float yawDeg,
+                               uint16_t flags) {
     if (!session_active_ || !session_file_) return false;
     if (!sd_ready_) return false;
-    pulseIndicator();
-    session_file_.print((long long)timestampMs);
-    session_file_.print(",");
-    session_file_.print(distMm);
-    session_file_.print(",");
-    session_file_.print(relDistMm);
-    session_file_.print(",");
-    session_file_.print(rollDeg, 3);
-    session_file_.print(",");
-    session_file_.print(pitchDeg, 3);
-    session_file_.print(",");
-    session_file_.println(yawDeg, 3);
-
-    unsigned long now = millis();
-    if (now - last_sd_flush_ms_ > SD_FLUSH_INTERVAL_MS) {
-        session_file_.flush();
-        last_sd_flush_ms_ = now;
+
+    SessionSampleRow row;
+    row.timestampMs = timestampMs;
+    row.distMm = distMm;
+    row.relDistMm = relDistMm;
+    row.rollDeg = rollDeg;
+    row.pitchDeg = pitchDeg;
+    row.yawDeg = yawDeg;
+    row.flags = flags;
+
+    if (change_log_.enabled) {
+        if (!rowChanged(row)) {
+            held_row_ = row;
+            has_held_row_ = true;
+            skipped_flags_ |= row.flags;
+            skipped_rows_++;
+            return true;
+        }
+        // A gap must not be filled from the previous segment: close it first.
+        if ((row.flags & RECORD_FLAG_RESYNC) != 0) flushHeldRow();
+        has_held_row_ = false;
+        row.flags |= skipped_flags_;
+        skipped_flags_ = 0;
     }
-    pulseIndicator();
+    return writeSample(row);
+}
+
+bool StorageManager::writeSample(const SessionSampleRow &row) {
+    // Only copies into the write-behind blocks; SD I/O happens on the writer task.
+    bool ok = (session_format_ == SESSION_FORMAT_BINARY)
+        ? writeBinarySample(row)
+        : writeCsvSample(row);
+    if (ok) {
+        session_sample_count_++;
+        last_row_ = row;
+        has_last_row_ = true;
+    }
+    return ok;
+}
+
+bool StorageManager::rowChanged(const SessionSampleRow &row) const {
+    return !has_last_row_ || sessionRowChanged(row, last_row_, change_log_, session_format_);
+}
+
+void StorageManager::flushHeldRow() {
+    if (!has_held_row_) return;
+    has_held_row_ = false;
+    held_row_.flags |= skipped_flags_;
+    skipped_flags_ = 0;
+    writeSample(held_row_);
+}
+
+uint16_t StorageManager::sessionSampleRateHz() const {
+    return sample_stats_.rateHz;
+}
+
+const String &StorageManager::sessionExercise() const {
+    return session_exercise_;
+}
+
+uint32_t StorageManager::sessionSerial() const {
+    return session_serial_;
+}
+
+void StorageManager::setSampleStats(const SessionSampleStats &stats) {
+    uint16_t rateHz = sample_stats_.rateHz;
+    sample_stats_ = stats;
+    sample_stats_.rateHz = rateHz;
+}
+
+void StorageManager::patchSampleStats() {
+    if (!session_file_) return;
+    bool ok;
+    if (session_format_ == SESSION_FORMAT_BINARY) {
+        BinarySampleStats block;
+        block.rows = sample_stats_.rows;
+        block.heldRows = sample_stats_.heldRows;
+        block.resyncs = sample_stats_.resyncs;
+        block.jitterMeanUs = sample_stats_.jitterMeanUs;
+        block.jitterMaxUs = sample_stats_.jitterMaxUs;
+        ok = session_file_.seek(offsetof(BinarySessionHeader, sampleStats)) &&
+             session_file_.write(reinterpret_cast<const uint8_t *>(&block), sizeof(block)) == sizeof(block);
+    } else {
+        char value[CSV_STATS_WIDTH + 1];
+        int n = snprintf(value, sizeof(value),
+                         "rows=%lu,held=%lu,resyncs=%lu,jitter_mean_us=%lu,jitter_max_us=%lu",
+                         (unsigned long)sample_stats_.rows,
+                         (unsigned long)sample_stats_.heldRows,
+                         (unsigned long)sample_stats_.resyncs,
+                         (unsigned long)sample_stats_.jitterMeanUs,
+                         (unsigned long)sample_stats_.jitterMaxUs);
+        if (n <= 0) return;
+        if ((size_t)n > CSV_STATS_WIDTH) n = CSV_STATS_WIDTH;
+        memset(value + n, ' ', CSV_STATS_WIDTH - (size_t)n);
+        ok = session_file_.seek(csv_stats_offset_) &&
+             session_file_.write(reinterpret_cast<const uint8_t *>(value), CSV_STATS_WIDTH) == CSV_STATS_WIDTH;
+    }
+    session_file_.flush();
+    if (!ok) LIFTRR_LOGW(STORAGE, "storageEndSession: unable to write sample stats.");
+}
 
+bool StorageManager::writeCsvSample(const SessionSampleRow &row) {
+    char line[96];
+    int n = snprintf(line, sizeof(line), "%lld,%d,%d,%.3f,%.3f,%.3f,%u\r\n",
+                     (long long)row.timestampMs,
+                     row.distMm,
+                     row.relDistMm,
+                     row.rollDeg,
+                     row.pitchDeg,
+                     row.yawDeg,
+                     (unsigned)row.flags);
+    if (n <= 0 || (size_t)n >= sizeof(line)) return false;
+    return log_writer_.append(line, (size_t)n);
+}
+
+// Opened up front so logRep() never touches SD on the loop task. A session
+// whose rep table cannot be opened still logs samples; logRep() then fails.
+void StorageManager::openRepTable(const String &sessionId) {
+    String path = String(SESSIONS_DIR_PATH) + "/" + sessionId + SESSION_REP_EXTENSION;
+    rep_file_ = sd_.open(path, FILE_WRITE);
+    if (!rep_file_) {
+        LIFTRR_LOGW(STORAGE, "storageStartSession: failed to open %s", path.c_str());
+        return;
+    }
+    if (!rep_writer_.begin()) {
+        LIFTRR_LOGW(STORAGE, "storageStartSession: rep writer unavailable.");
+        rep_file_.close();
+        rep_file_ = File();
+        sd_.remove(path);
+        return;
+    }
+    rep_writer_.attach(rep_file_);
+
+    char header[224];
+    int n = snprintf(header, sizeof(header),
+                     "# liftrr reps\r\n"
+                     "# session_id=%s\r\n"
+                     "%s\r\n",
+                     sessionId.c_str(), SESSION_REP_COLUMNS);
+    if (n <= 0 || (size_t)n >= sizeof(header) || !rep_writer_.append(header, (size_t)n)) {
+        LIFTRR_LOGW(STORAGE, "storageStartSession: failed to write rep table header.");
+        rep_writer_.detach();
+        rep_file_.close();
+        rep_file_ = File();
+        sd_.remove(path);
+        return;
+    }
+    rep_writer_.submit();
+}
+
+void StorageManager::closeRepTable() {
+    if (!rep_file_) return;
+    if (!rep_writer_.drain(SD_DRAIN_TIMEOUT_MS)) {
+        LIFTRR_LOGE(STORAGE, "storageEndSession: rep table drain timed out.");
+    }
+    rep_writer_.detach();
+    rep_file_.close();
+    rep_file_ = File();
+    LIFTRR_LOGI(STORAGE, "Session reps: %u", (unsigned)session_rep_count_);
+}
+
+bool StorageManager::logRep(const SessionRep &rep) {
+    if (!session_active_ || !rep_file_) return false;
+
+    char line[160];
+    int n = snprintf(line, sizeof(line), "%u,%lld,%lld,%u,%u,%u,%lu,%lu,%.2f,%.2f,%.2f,%.2f\r\n",
+                     (unsigned)rep.index,
+                     (long long)rep.startMs,
+                     (long long)rep.endMs,
+                     (unsigned)rep.romMm,
+                     (unsigned)rep.meanVelMmS,
+                     (unsigned)rep.peakVelMmS,
+                     (unsigned long)rep.concentricMs,
+                     (unsigned long)rep.tutMs,
+                     rep.rollMinDeg,
+                     rep.rollMaxDeg,
+                     rep.pitchMinDeg,
+                     rep.pitchMaxDeg);
+    if (n <= 0 || (size_t)n >= sizeof(line)) return false;
+    if (!rep_writer_.append(line, (size_t)n)) {
+        LIFTRR_LOGW(STORAGE, "storageLogRep: rep writer full, rep %u dropped.", (unsigned)rep.index);
+        return false;
+    }
+    // Reps are seconds apart: send each one now rather than when 512 bytes fill.
+    rep_writer_.submit();
+    session_rep_count_++;
     return true;
 }
 
+uint16_t StorageManager::sessionRepCount() const {
+    return session_rep_count_;
+}
+
+bool StorageManager::writeBinarySample(const SessionSampleRow &row) {
+    // Timestamp + sample are appended as one unit so a drop never desyncs the deltas.
+    uint8_t buf[BINARY_SAMPLE_MAX_BYTES];
+    size_t len = encodeBinarySample(row, has_last_sample_ts_, last_sample_ts_ms_, buf);
+    if (!log_writer_.append(buf, len)) return false;
+    has_last_sample_ts_ = true;
+    last_sample_ts_ms_ = row.timestampMs;
+    return true;
+}
+
+WriteBehindLog::Stats StorageManager::logStats() const {
+    return log_writer_.stats();
+}
+
 bool StorageManager::endSession() {
     pulseIndicator();
     if (!session_active_) {
-        Serial.println("storageEndSession: no active session.");
+        LIFTRR_LOGW(STORAGE, "storageEndSession: no active session.");
         return false;
     }
 
@@ -254,21 +595,48 @@ bool StorageManager::endSession() {
         return false;
     }
 
+    flushHeldRow();  // the final grid tick bounds the reconstructed series
+    if (change_log_.enabled) {
+        LIFTRR_LOGI(STORAGE, "Session change log: written=%lu skipped=%lu",
+                    (unsigned long)session_sample_count_, (unsigned long)skipped_rows_);
+    }
+
+    bool drained = log_writer_.drain(SD_DRAIN_TIMEOUT_MS);
+    if (!drained) {
+        LIFTRR_LOGE(STORAGE, "storageEndSession: write-behind drain timed out.");
+    }
+    log_writer_.detach();  // waits out a write in flight before the file is closed
+    if (drained) patchSampleStats();
+    LIFTRR_LOGI(STORAGE, "Session grid: rate=%u Hz rows=%lu held=%lu resyncs=%lu jitterMeanUs=%lu jitterMaxUs=%lu",
+                (unsigned)sample_stats_.rateHz, (unsigned long)sample_stats_.rows,
+                (unsigned long)sample_stats_.heldRows, (unsigned long)sample_stats_.resyncs,
+                (unsigned long)sample_stats_.jitterMeanUs, (unsigned long)sample_stats_.jitterMaxUs);
+
+    WriteBehindLog::Stats stats = log_writer_.stats();
+    LIFTRR_LOGI(STORAGE, "Session log: bytes=%lu blocks=%lu overruns=%lu dropped=%lu maxWriteUs=%lu",
+                (unsigned long)stats.bytesWritten, (unsigned long)stats.blocksWritten,
+                (unsigned long)stats.overruns, (unsigned long)stats.droppedSamples,
+                (unsigned long)stats.maxWriteUs);
+
     if (session_file_) {
-        session_file_.flush();
         session_file_.close();
     }
+    uint32_t indexFlags = rep_file_ ? INDEX_FLAG_REPS : 0;
+    closeRepTable();
 
     String dir = "/sessions";
     String tmpPath   = dir + "/" + current_session_id_ + ".tmp";
-    String finalPath = dir + "/" + current_session_id_ + ".csv";
+    if (prealloc_bytes_ > 0) {
+        truncateSessionFile(tmpPath, stats.bytesWritten);
+        prealloc_bytes_ = 0;
+    }
+    String finalPath = dir + "/" + current_session_id_ + sessionFormatExtension(session_format_);
 
     if (sd_.exists(tmpPath)) {
         if (!sd_.rename(tmpPath, finalPath)) {
-            Serial.println("storageEndSession: rename failed, leaving .tmp file.");
+            LIFTRR_LOGE(STORAGE, "storageEndSession: rename failed, leaving .tmp file.");
         } else {
-            Serial.print("Session finalized: ");
-            Serial.println(finalPath);
+            LIFTRR_LOGI(STORAGE, "Session finalized: %s", finalPath.c_str());
         }
     }
 
@@ -283,18 +651,8 @@ bool StorageManager::endSession() {
             uint64_t mtimeMs = fileMtimeMs(f);
             String name = basenameFromPath(indexPath);
             f.close();
-            File idx = openForAppend(SESSION_INDEX_PATH);
-            if (idx) {
-                idx.print("{\"name\":\"");
-                idx.print(name);
-                idx.print("\",\"size\":");
-                idx.print(size);
-                idx.print(",\"mtime\":");
-                idx.print((unsigned long long)mtimeMs);
-                idx.println("}");
-                idx.close();
-            } else {
-                Serial.println("storageEndSession: unable to append to index.");
+            if (!appendIndexRecord(name, size, mtimeMs, session_sample_count_, indexFlags)) {
+                LIFTRR_LOGE(STORAGE, "storageEndSession: unable to append to index.");
             }
         }
     }
@@ -308,7 +666,7 @@ bool StorageManager::endSession() {
 bool StorageManager::clearSessions() {
     pulseIndicator();
     if (session_active_) {
-        Serial.println("storageClearSessions: session active, aborting.");
+        LIFTRR_LOGW(STORAGE, "storageClearSessions: session active, aborting.");
         return false;
     }
 
@@ -319,6 +677,12 @@ bool StorageManager::clearSessions() {
     if (sd_.exists(SESSION_INDEX_PATH)) {
         sd_.remove(SESSION_INDEX_PATH);
     }
+    if (sd_.exists(SESSION_INDEX_NDJSON_PATH)) {
+        sd_.remove(SESSION_INDEX_NDJSON_PATH);
+    }
+    index_ready_ = false;
+    index_cache_loaded_ = false;
+    clearIndexCache();
 
     File dir = sd_.open(SESSIONS_DIR_PATH);
     if (!dir || !dir.isDirectory()) {
@@ -344,6 +708,230 @@ bool StorageManager::clearSessions() {
     return true;
 }
 
+static uint32_t indexFlagsForName(const String &name) {
+    if (name.endsWith(".tmp")) return INDEX_FLAG_TMP;
+    if (name.endsWith(".lrb")) return INDEX_FLAG_FINAL | INDEX_FLAG_BINARY;
+    return INDEX_FLAG_FINAL;
+}
+
+static bool isSessionFileName(const String &name) {
+    return name.endsWith(".csv") || name.endsWith(".lrb") || name.endsWith(".tmp");
+}
+
+static bool nameMatchesSession(const char *name, const char *sessionId) {
+    size_t idLen = strlen(sessionId);
+    return strncmp(name, sessionId, idLen) == 0 && name[idLen] == '.';
+}
+
+// Older or foreign layouts are rejected so they get rebuilt, not misread.
+static bool readIndexHeaderValid(File &idx) {
+    SessionIndexHeader header;
+    return idx &&
+        idx.seek(0) &&
+        idx.read(reinterpret_cast<uint8_t *>(&header), sizeof(header)) == sizeof(header) &&
+        header.magic == SESSION_INDEX_MAGIC &&
+        header.version == SESSION_INDEX_VERSION &&
+        header.headerSize == sizeof(SessionIndexHeader) &&
+        header.recordSize == sizeof(SessionIndexRecord);
+}
+
+static void writeIndexHeader(File &idx) {
+    SessionIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SESSION_INDEX_MAGIC;
+    header.version = SESSION_INDEX_VERSION;
+    header.headerSize = sizeof(SessionIndexHeader);
+    header.recordSize = sizeof(SessionIndexRecord);
+    idx.write(reinterpret_cast<const uint8_t *>(&header), sizeof(header));
+}
+
+static void fillIndexRecord(SessionIndexRecord &rec,
+                            const String &name,
+                            uint32_t size,
+                            uint64_t mtimeMs,
+                            uint32_t sampleCount,
+                            uint32_t extraFlags = 0) {
+    memset(&rec, 0, sizeof(rec));
+    copyField(rec.name, sizeof(rec.name), name.c_str());
+    rec.size = size;
+    rec.sampleCount = sampleCount;
+    rec.mtimeMs = mtimeMs;
+    rec.flags = indexFlagsForName(name) | extraFlags;
+    rec.idHash = sessionIdHash(rec.name);
+}
+
+static void writeNdjsonIndexLine(Print &out,
+                                 const char *name,
+                                 uint32_t size,
+                                 uint64_t mtimeMs,
+                                 uint32_t sampleCount) {
+    out.print("{\"name\":\"");
+    out.print(name);
+    out.print("\",\"size\":");
+    out.print(size);
+    out.print(",\"mtime\":");
+    out.print((unsigned long long)mtimeMs);
+    out.print(",\"samples\":");
+    out.print(sampleCount);
+    out.println("}");
+}
+
+size_t StorageManager::indexRecordCount(File &idx) const {
+    size_t size = idx.size();
+    if (size < sizeof(SessionIndexHeader)) return 0;
+    return (size - sizeof(SessionIndexHeader)) / sizeof(SessionIndexRecord);
+}
+
+bool StorageManager::readIndexRecord(File &idx, size_t position, SessionIndexRecord &rec) {
+    size_t offset = sizeof(SessionIndexHeader) + position * sizeof(SessionIndexRecord);
+    if (!idx.seek(offset)) return false;
+    if (idx.read(reinterpret_cast<uint8_t *>(&rec), sizeof(rec)) != sizeof(rec)) return false;
+    rec.name[sizeof(rec.name) - 1] = '\0';
+    return true;
+}
+
+bool StorageManager::ensureSessionIndex() {
+    if (index_ready_) return true;
+    if (!initSd()) return false;
+
+    if (sd_.exists(SESSION_INDEX_PATH)) {
+        File idx = sd_.open(SESSION_INDEX_PATH, FILE_READ);
+        bool valid = readIndexHeaderValid(idx);
+        if (idx) idx.close();
+        if (valid) {
+            index_ready_ = true;
+            return true;
+        }
+        LIFTRR_LOGW(STORAGE, "storageIndex: invalid index.bin, rebuilding from directory.");
+        return rebuildSessionIndex(nullptr);
+    }
+
+    File idx = sd_.open(SESSION_INDEX_PATH, FILE_WRITE);
+    if (!idx) return false;
+    writeIndexHeader(idx);
+
+    // One-time migration of the legacy line-based index.
+    size_t imported = 0;
+    File legacy = sd_.open(SESSION_INDEX_NDJSON_PATH, FILE_READ);
+    if (legacy) {
+        while (legacy.available()) {
+            String line = legacy.readStringUntil('\n');
+            line.trim();
+            if (line.length() == 0) continue;
+
+            JsonDocument doc;
+            if (deserializeJson(doc, line)) continue;
+            const char *name = doc["name"] | "";
+            if (name[0] == '\0') continue;
+
+            SessionIndexRecord rec;
+            fillIndexRecord(rec, String(name), doc["size"] | 0,
+                            doc["mtime"] | (uint64_t)0, doc["samples"] | 0);
+            idx.write(reinterpret_cast<const uint8_t *>(&rec), sizeof(rec));
+            imported++;
+        }
+        legacy.close();
+    }
+    idx.close();
+
+    if (imported) {
+        LIFTRR_LOGI(STORAGE, "storageIndex: imported %lu entries from index.ndjson",
+                    (unsigned long)imported);
+    }
+    index_ready_ = true;
+    index_cache_loaded_ = false;
+    return true;
+}
+
+bool StorageManager::loadIndexCache() {
+    if (index_cache_loaded_) return true;
+    if (!ensureSessionIndex()) return false;
+
+    File idx = sd_.open(SESSION_INDEX_PATH, FILE_READ);
+    if (!idx) return false;
+    if (!readIndexHeaderValid(idx)) {
+        // Replaced since ensureSessionIndex() accepted it.
+        idx.close();
+        LIFTRR_LOGW(STORAGE, "storageIndex: invalid index.bin, rebuilding from directory.");
+        if (!rebuildSessionIndex(nullptr)) return false;
+        idx = sd_.open(SESSION_INDEX_PATH, FILE_READ);
+        if (!idx) return false;
+    }
+
+    size_t total = indexRecordCount(idx);
+    clearIndexCache();
+
+    idx.seek(sizeof(SessionIndexHeader));
+    SessionIndexRecord rec;
+    for (size_t i = 0; i < total; i++) {
+        if (idx.read(reinterpret_cast<uint8_t *>(&rec), sizeof(rec)) != sizeof(rec)) break;
+        indexCacheInsert(rec.idHash, i);
+    }
+    idx.close();
+
+    index_cache_loaded_ = true;
+    return true;
+}
+
+void StorageManager::clearIndexCache() {
+    memset(index_slots_, 0, sizeof(index_slots_));
+    index_slot_used_ = 0;
+    index_cache_full_ = false;
+}
+
+void StorageManager::indexCacheInsert(uint32_t idHash, size_t position) {
+    if (index_cache_full_) return;
+    if ((index_slot_used_ + 1) * 2 > SESSION_INDEX_CACHE_SLOTS) {
+        LIFTRR_LOGW(STORAGE, "storageIndex: more than %lu records, lookups scan index.bin",
+                    (unsigned long)(SESSION_INDEX_CACHE_SLOTS / 2));
+        index_cache_full_ = true;
+        return;
+    }
+    const size_t mask = SESSION_INDEX_CACHE_SLOTS - 1;
+    size_t i = idHash & mask;
+    while (index_slots_[i].position) i = (i + 1) & mask;
+    index_slots_[i].idHash = idHash;
+    index_slots_[i].position = (uint32_t)position + 1;
+    index_slot_used_++;
+}
+
+bool StorageManager::appendIndexRecord(const String &name,
+                                       uint32_t size,
+                                       uint64_t mtimeMs,
+                                       uint32_t sampleCount,
+                                       uint32_t extraFlags) {
+    if (!ensureSessionIndex()) return false;
+
+    SessionIndexRecord rec;
+    fillIndexRecord(rec, name, size, mtimeMs, sampleCount, extraFlags);
+
+    File idx = openForAppend(SESSION_INDEX_PATH);
+    if (!idx) return false;
+    size_t position = indexRecordCount(idx);
+    size_t n = idx.write(reinterpret_cast<const uint8_t *>(&rec), sizeof(rec));
+    idx.close();
+    if (n != sizeof(rec)) return false;
+
+    if (index_cache_loaded_) indexCacheInsert(rec.idHash, position);
+
+    // Keep the NDJSON mirror current for existing tooling.
+    File legacy = openForAppend(SESSION_INDEX_NDJSON_PATH);
+    if (legacy) {
+        writeNdjsonIndexLine(legacy, rec.name, size, mtimeMs, sampleCount);
+        legacy.close();
+    }
+    return true;
+}
+
+size_t StorageManager::sessionIndexCount() {
+    if (!ensureSessionIndex()) return 0;
+    File idx = sd_.open(SESSION_INDEX_PATH, FILE_READ);
+    if (!idx) return 0;
+    size_t total = indexRecordCount(idx);
+    idx.close();
+    return total;
+}
+
 bool StorageManager::readSessionIndex(size_t cursor,
                                       size_t maxItems,
                                       size_t *nextCursor,
@@ -353,109 +941,200 @@ bool StorageManager::readSessionIndex(size_t cursor,
     if (nextCursor) *nextCursor = cursor;
     if (hasMore) *hasMore = false;
     if (!cb) return false;
-    if (!initSd()) return false;
-
-    if (!sd_.exists(SESSION_INDEX_PATH)) {
-        return false;
-    }
+    if (!ensureSessionIndex()) return false;
 
     File idx = sd_.open(SESSION_INDEX_PATH, FILE_READ);
     if (!idx) return false;
 
-    size_t lineIndex = 0;
+    size_t total = indexRecordCount(idx);
+    size_t position = cursor;
     size_t count = 0;
-    size_t lastIncludedLine = cursor;
 
-    while (idx.available()) {
-        String line = idx.readStringUntil('\n');
-        line.trim();
-        if (line.length() == 0) {
-            lineIndex++;
-            continue;
-        }
-        if (lineIndex < cursor) {
-            lineIndex++;
-            continue;
-        }
+    if (position < total &&
+        !idx.seek(sizeof(SessionIndexHeader) + position * sizeof(SessionIndexRecord))) {
+        idx.close();
+        return false;
+    }
 
+    SessionIndexRecord rec;
+    while (position < total) {
         if (count >= maxItems) {
             if (hasMore) *hasMore = true;
             break;
         }
 
-        JsonDocument doc;
-        DeserializationError err = deserializeJson(doc, line);
-        if (err) {
-            lastIncludedLine = lineIndex + 1;
-            lineIndex++;
+        if (idx.read(reinterpret_cast<uint8_t *>(&rec), sizeof(rec)) != sizeof(rec)) break;
+        rec.name[sizeof(rec.name) - 1] = '\0';
+
+        if (rec.name[0] == '\0') {
+            position++;
             continue;
         }
 
-        const char *name = doc["name"] | "";
-        uint32_t size = doc["size"] | 0;
-        uint64_t mtimeMs = doc["mtime"] | (uint64_t)0;
+        SessionIndexEntry entry;
+        entry.name = rec.name;
+        entry.size = rec.size;
+        entry.mtimeMs = rec.mtimeMs;
+        entry.sampleCount = rec.sampleCount;
+        entry.flags = rec.flags;
+        entry.position = position;
 
-        if (name[0] != '\0') {
-            bool keepGoing = cb(name, size, mtimeMs, lineIndex, ctx);
-            if (!keepGoing) {
-                if (hasMore) *hasMore = true;
-                break;
-            }
-            lastIncludedLine = lineIndex + 1;
-            count++;
+        if (!cb(entry, ctx)) {
+            if (hasMore) *hasMore = true;
+            break;
         }
-
-        lineIndex++;
+        position++;
+        count++;
     }
 
     idx.close();
-    if (nextCursor) *nextCursor = lastIncludedLine;
+    if (nextCursor) *nextCursor = position;
     return true;
 }
 
-bool StorageManager::findSessionInIndex(const String &sessionId, String &outName) {
-    outName = "";
-    if (!initSd()) return false;
-    if (!sd_.exists(SESSION_INDEX_PATH)) return false;
-
-    File idx = sd_.open(SESSION_INDEX_PATH, FILE_READ);
-    if (!idx) return false;
+// Steps through the records whose idHash is `want`: one probe run of the
+// cache, or a scan of index.bin once the cache has overflowed. Start with
+// cursor = 0.
+bool StorageManager::nextIndexMatch(File &idx, uint32_t want, size_t &cursor,
+                                    SessionIndexRecord &rec, uint32_t &position) {
+    if (!index_cache_full_) {
+        const size_t mask = SESSION_INDEX_CACHE_SLOTS - 1;
+        while (cursor < SESSION_INDEX_CACHE_SLOTS) {
+            const IndexSlot &slot = index_slots_[(want + cursor++) & mask];
+            if (!slot.position) return false;
+            if (slot.idHash != want) continue;
+            position = slot.position - 1;
+            if (readIndexRecord(idx, position, rec)) return true;
+        }
+        return false;
+    }
 
-    String wantCsv = sessionId + ".csv";
-    String wantTmp = sessionId + ".tmp";
-    String foundTmp;
+    size_t total = indexRecordCount(idx);
+    while (cursor < total) {
+        position = (uint32_t)cursor++;
+        if (readIndexRecord(idx, position, rec) && rec.idHash == want) return true;
+    }
+    return false;
+}
 
-    while (idx.available()) {
-        String line = idx.readStringUntil('\n');
-        line.trim();
-        if (line.length() == 0) {
-            continue;
-        }
-        JsonDocument doc;
-        DeserializationError err = deserializeJson(doc, line);
-        if (err) continue;
+bool StorageManager::findSessionInIndex(const char *sessionId, char *outName, size_t outSize) {
+    copyField(outName, outSize, "");
+    if (!sessionId || !loadIndexCache()) return false;
 
-        const char *name = doc["name"] | "";
-        if (name[0] == '\0') continue;
+    File idx = sd_.open(SESSION_INDEX_PATH, FILE_READ);
+    if (!idx) return false;
 
-        if (wantCsv.equals(name)) {
-            outName = name;
-            idx.close();
-            return true;
-        }
-        if (wantTmp.equals(name)) {
-            foundTmp = name;
+    uint32_t want = sessionIdHash(sessionId);
+    SessionIndexRecord rec;
+    bool haveFinal = false;
+    bool haveTmp = false;
+    uint32_t finalPos = 0;
+    uint32_t tmpPos = 0;
+    char finalName[SESSION_NAME_BYTES];
+    char tmpName[SESSION_NAME_BYTES];
+
+    // Newest entries win; a finalized file beats a leftover .tmp.
+    size_t cursor = 0;
+    uint32_t pos = 0;
+    while (nextIndexMatch(idx, want, cursor, rec, pos)) {
+        if (!nameMatchesSession(rec.name, sessionId)) continue;
+
+        if (rec.flags & INDEX_FLAG_FINAL) {
+            if (!haveFinal || pos > finalPos) {
+                haveFinal = true;
+                finalPos = pos;
+                copyField(finalName, sizeof(finalName), rec.name);
+            }
+        } else if (!haveTmp || pos > tmpPos) {
+            haveTmp = true;
+            tmpPos = pos;
+            copyField(tmpName, sizeof(tmpName), rec.name);
         }
     }
 
     idx.close();
-    if (foundTmp.length()) {
-        outName = foundTmp;
+    if (haveFinal) {
+        copyField(outName, outSize, finalName);
+        return true;
+    }
+    if (haveTmp) {
+        copyField(outName, outSize, tmpName);
         return true;
     }
     return false;
 }
 
+bool StorageManager::writeSessionIndexNdjson(Print &out, size_t *outCount) {
+    if (outCount) *outCount = 0;
+    if (!ensureSessionIndex()) return false;
+
+    File idx = sd_.open(SESSION_INDEX_PATH, FILE_READ);
+    if (!idx) return false;
+
+    size_t total = indexRecordCount(idx);
+    size_t count = 0;
+    idx.seek(sizeof(SessionIndexHeader));
+    SessionIndexRecord rec;
+    for (size_t i = 0; i < total; i++) {
+        if (idx.read(reinterpret_cast<uint8_t *>(&rec), sizeof(rec)) != sizeof(rec)) break;
+        rec.name[sizeof(rec.name) - 1] = '\0';
+        if (rec.name[0] == '\0') continue;
+        writeNdjsonIndexLine(out, rec.name, rec.size, rec.mtimeMs, rec.sampleCount);
+        count++;
+    }
+    idx.close();
+
+    if (outCount) *outCount = count;
+    return true;
+}
+
+bool StorageManager::exportSessionIndexNdjson(size_t *outCount) {
+    if (outCount) *outCount = 0;
+    if (!ensureSessionIndex()) return false;
+
+    File out = sd_.open(SESSION_INDEX_NDJSON_PATH, FILE_WRITE);
+    if (!out) return false;
+    bool ok = writeSessionIndexNdjson(out, outCount);
+    out.close();
+    return ok;
+}
+
+// Grid rows from the sample stats patched into the header at session end.
+// They equal the rows written only when the change log was off; otherwise,
+// and for files that were never closed, the count is unknown (0).
+static uint32_t headerSampleCount(File &file, const String &name) {
+    if (!file.seek(0)) return 0;
+    if (name.endsWith(".lrb")) {
+        BinarySessionHeader header;
+        if (file.read(reinterpret_cast<uint8_t *>(&header), sizeof(header)) != sizeof(header)) return 0;
+        if (header.magic != BINARY_SESSION_MAGIC || header.version < 2) return 0;
+        return header.changeHeartbeatMs == 0 ? header.sampleStats.rows : 0;
+    }
+
+    char text[768];
+    size_t n = file.read(reinterpret_cast<uint8_t *>(text), sizeof(text) - 1);
+    text[n] = '\0';
+    const char *changeLog = strstr(text, "# change_log=heartbeat_ms=");
+    if (changeLog && strtoul(changeLog + strlen("# change_log=heartbeat_ms="), nullptr, 10) != 0) {
+        return 0;
+    }
+    const char *stats = strstr(text, "# sample_stats=rows=");
+    if (!stats) return 0;
+    return (uint32_t)strtoul(stats + strlen("# sample_stats=rows="), nullptr, 10);
+}
+
+uint32_t StorageManager::previousSampleCount(File &old, const String &name) {
+    if (!old) return 0;
+    uint32_t want = sessionIdHash(name.c_str());
+    SessionIndexRecord rec;
+    size_t cursor = 0;
+    uint32_t pos = 0;
+    while (nextIndexMatch(old, want, cursor, rec, pos)) {
+        if (name == rec.name) return rec.sampleCount;
+    }
+    return 0;
+}
+
 bool StorageManager::rebuildSessionIndex(size_t *outCount) {
     if (outCount) *outCount = 0;
     if (!initSd()) return false;
@@ -466,32 +1145,45 @@ bool StorageManager::rebuildSessionIndex(size_t *outCount) {
         return false;
     }
 
+    // The directory does not know sample counts. Keep a valid previous
+    // index aside, with its hash cache, to copy them from.
+    String oldPath = String(SESSION_INDEX_PATH) + ".old";
+    sd_.remove(oldPath);
+    File old;
+    File prev = sd_.open(SESSION_INDEX_PATH, FILE_READ);
+    bool prevValid = readIndexHeaderValid(prev);
+    if (prev) prev.close();
+    if (prevValid && loadIndexCache() && sd_.rename(SESSION_INDEX_PATH, oldPath)) {
+        old = sd_.open(oldPath, FILE_READ);
+    }
+
     File idx = sd_.open(SESSION_INDEX_PATH, FILE_WRITE);
     if (!idx) {
+        if (old) {
+            old.close();
+            sd_.rename(oldPath, SESSION_INDEX_PATH);
+        }
         dir.close();
         return false;
     }
+    writeIndexHeader(idx);
 
     size_t count = 0;
     File entry = dir.openNextFile();
     while (entry) {
         if (!entry.isDirectory()) {
-            const char *rawName = entry.name();
-            String baseName = basenameFromPath(String(rawName));
-            if (baseName != "index.ndjson") {
-                bool isSessionFile = baseName.endsWith(".csv") || baseName.endsWith(".tmp");
-                if (isSessionFile) {
-                    uint32_t size = entry.size();
-                    uint64_t mtimeMs = fileMtimeMs(entry);
-                    idx.print("{\"name\":\"");
-                    idx.print(baseName);
-                    idx.print("\",\"size\":");
-                    idx.print(size);
-                    idx.print(",\"mtime\":");
-                    idx.print((unsigned long long)mtimeMs);
-                    idx.println("}");
-                    count++;
-                }
+            String baseName = basenameFromPath(String(entry.name()));
+            if (isSessionFileName(baseName)) {
+                int dot = baseName.lastIndexOf('.');
+                String repPath = String(SESSIONS_DIR_PATH) + "/" + baseName.substring(0, dot) +
+                                 SESSION_REP_EXTENSION;
+                uint32_t samples = previousSampleCount(old, baseName);
+                if (samples == 0) samples = headerSampleCount(entry, baseName);
+                SessionIndexRecord rec;
+                fillIndexRecord(rec, baseName, entry.size(), fileMtimeMs(entry), samples,
+                                sd_.exists(repPath) ? INDEX_FLAG_REPS : 0);
+                idx.write(reinterpret_cast<const uint8_t *>(&rec), sizeof(rec));
+                count++;
             }
         }
         entry.close();
@@ -500,6 +1192,15 @@ bool StorageManager::rebuildSessionIndex(size_t *outCount) {
 
     idx.close();
     dir.close();
+    if (old) {
+        old.close();
+        sd_.remove(oldPath);
+    }
+
+    index_ready_ = true;
+    index_cache_loaded_ = false;
+    exportSessionIndexNdjson(nullptr);
+
     if (outCount) *outCount = count;
     return true;
 }
@@ -4,18 +4,32 @@
 #include <FS.h>
 #include <SD.h>
 
+#include "core/config.h"
+#include "storage/session_format.h"
+#include "storage/session_index.h"
+#include "storage/write_behind.h"
+
 namespace liftrr {
 namespace storage {
 
+// Per-session options chosen by session.start.
+struct SessionOptions {
+    SessionFormat format = SESSION_FORMAT_CSV;
+    uint32_t expectedDurationS = 0;  // pre-allocation hint; 0 = grow on demand
+    uint16_t sampleRateHz = (uint16_t)(1000 / LOG_INTERVAL);  // fixed logging grid
+    SessionChangeLog changeLog;      // skip rows that repeat the last one
+};
+
 class StorageManager {
 public:
-    typedef bool (*SessionIndexCallback)(const char *name,
-                                         uint32_t size,
-                                         uint64_t mtimeMs,
-                                         size_t lineIndex,
-                                         void *ctx);
+    static constexpr const char *DEFAULT_SD_MOUNT_POINT = "/sd";  // SD.begin() default
+
+    typedef bool (*SessionIndexCallback)(const SessionIndexEntry &entry, void *ctx);
 
-    explicit StorageManager(fs::SDFS &sd, void (*pulseFn)() = nullptr);
+    // mountPoint is where initSd() mounts the card in the VFS; truncating a
+    // pre-allocated session file goes through it (fs::FS has no truncate).
+    explicit StorageManager(fs::SDFS &sd, void (*pulseFn)() = nullptr,
+                            const char *mountPoint = DEFAULT_SD_MOUNT_POINT);
 
     bool initSd();
     bool isSessionActive() const;
@@ -25,15 +39,35 @@ public:
                       int16_t calibLaserOffset,
                       float calibRollOffset,
                       float calibPitchOffset,
-                      float calibYawOffset);
-    String buildSessionId(const String &exercise, int64_t epochMs) const;
+                      float calibYawOffset,
+                      const SessionOptions &options = SessionOptions());
+    // Writes "<time>-<lift>-LIFTRR" into out (SESSION_NAME_BYTES is enough).
+    void buildSessionId(const char *exercise, int64_t epochMs, char *out, size_t outSize) const;
 
+    // One grid row; flags are RECORD_FLAG_* freshness bits. In a change-driven
+    // session the row may be held back (see SessionChangeLog); returns true.
     bool logSample(int64_t timestampMs,
                    int16_t distMm,
                    int16_t relDistMm,
                    float rollDeg,
                    float pitchDeg,
-                   float yawDeg);
+                   float yawDeg,
+                   uint16_t flags = 0);
+
+    // Grid of the active session; sessionSerial() changes on every start.
+    uint16_t sessionSampleRateHz() const;
+    const String &sessionExercise() const;
+    uint32_t sessionSerial() const;
+    // Latest grid statistics; patched into the header by endSession().
+    void setSampleStats(const SessionSampleStats &stats);
+
+    // Appends one row to the active session's rep table (<id>.rep, opened by
+    // startSession). Copies into the rep table's own write-behind buffer and
+    // hands it to its writer task; never waits on SD.
+    bool logRep(const SessionRep &rep);
+    uint16_t sessionRepCount() const;
+
+    WriteBehindLog::Stats logStats() const;
 
     bool endSession();
     bool clearSessions();
@@ -45,26 +79,107 @@ public:
                           SessionIndexCallback cb,
                           void *ctx);
 
+    bool ensureSessionIndex();
+    size_t sessionIndexCount();
     bool rebuildSessionIndex(size_t *outCount);
+    bool exportSessionIndexNdjson(size_t *outCount);
+    bool writeSessionIndexNdjson(Print &out, size_t *outCount);
 
-    bool findSessionInIndex(const String &sessionId, String &outName);
+    // Copies the newest indexed file name for sessionId (finalized before
+    // .tmp) into outName; outSize of SESSION_NAME_BYTES always fits.
+    bool findSessionInIndex(const char *sessionId, char *outName, size_t outSize);
 
 private:
     File openForAppend(const char *path);
     String basenameFromPath(const String &path);
     uint64_t fileMtimeMs(File &file);
     void pulseIndicator() const;
+    bool loadIndexCache();
+    uint32_t previousSampleCount(File &old, const String &name);
+    void clearIndexCache();
+    void indexCacheInsert(uint32_t idHash, size_t position);
+    bool nextIndexMatch(File &idx, uint32_t idHash, size_t &cursor,
+                        SessionIndexRecord &rec, uint32_t &position);
+    size_t indexRecordCount(File &idx) const;
+    bool readIndexRecord(File &idx, size_t position, SessionIndexRecord &rec);
+    bool appendIndexRecord(const String &name,
+                           uint32_t size,
+                           uint64_t mtimeMs,
+                           uint32_t sampleCount,
+                           uint32_t extraFlags = 0);
+    uint32_t preallocBytesFor(const SessionOptions &options) const;
+    void truncateSessionFile(const String &path, uint32_t length);
+    void patchSampleStats();
+    void openRepTable(const String &sessionId);
+    void closeRepTable();
+
+    bool writeSample(const SessionSampleRow &row);
+    bool rowChanged(const SessionSampleRow &row) const;
+    void flushHeldRow();
+    bool writeCsvHeader(const String &sessionId,
+                        const String &exercise,
+                        int16_t calibLaserOffset,
+                        float calibRollOffset,
+                        float calibPitchOffset,
+                        float calibYawOffset);
+    bool writeBinaryHeader(const String &sessionId,
+                           const String &exercise,
+                           int16_t calibLaserOffset,
+                           float calibRollOffset,
+                           float calibPitchOffset,
+                           float calibYawOffset);
+    bool writeCsvSample(const SessionSampleRow &row);
+    bool writeBinarySample(const SessionSampleRow &row);
 
     fs::SDFS &sd_;
     void (*pulse_fn_)();
+    const char *mount_point_;
     bool sd_ready_;
     bool session_active_;
     File session_file_;
     String current_session_id_;
-    unsigned long last_sd_flush_ms_;
+    String session_exercise_;
+    SessionFormat session_format_;
+    bool has_last_sample_ts_;
+    int64_t last_sample_ts_ms_;
+    WriteBehindLog log_writer_;
+    uint32_t prealloc_bytes_;
+    uint32_t session_sample_count_;
+    uint32_t session_serial_;
+    SessionSampleStats sample_stats_;
+    uint32_t csv_stats_offset_;  // file offset of the "# sample_stats=" value
+    SessionChangeLog change_log_;
+    bool has_last_row_;
+    SessionSampleRow last_row_;  // last row written
+    bool has_held_row_;
+    SessionSampleRow held_row_;  // newest row skipped since then
+    uint32_t skipped_rows_;
+    uint16_t skipped_flags_;     // OR of the skipped rows' flags, carried by the next written row
+    File rep_file_;              // <id>.rep, open for the whole session
+    WriteBehindLog rep_writer_;
+    uint16_t session_rep_count_;
+    bool index_ready_;
+    bool index_cache_loaded_;
+    // Open-addressed table over the index records keyed by idHash (linear
+    // probing, at most half full), so a lookup reads O(1) records. An index
+    // with more records than it holds is scanned from index.bin instead.
+    struct IndexSlot {
+        uint32_t idHash;
+        uint32_t position;  // record number + 1; 0 = empty
+    };
+    IndexSlot index_slots_[SESSION_INDEX_CACHE_SLOTS];
+    size_t index_slot_used_;
+    bool index_cache_full_;
 
     static const unsigned long SD_FLUSH_INTERVAL_MS = 1000;
+    static const uint32_t SD_SPI_FREQUENCY_HZ = 4000000;  // SD.begin() default
+    static const uint32_t SD_DRAIN_TIMEOUT_MS = 2000;
+    static const uint32_t PREALLOC_CLUSTER_BYTES = 32768;
+    static const uint32_t PREALLOC_MAX_BYTES = 64UL * 1024UL * 1024UL;
+    static const uint32_t CSV_BYTES_PER_SAMPLE = 58;
+    static const size_t CSV_STATS_WIDTH = 96;  // reserved "# sample_stats=" value
     static const char *const SESSION_INDEX_PATH;
+    static const char *const SESSION_INDEX_NDJSON_PATH;
     static const char *const SESSIONS_DIR_PATH;
 };
 
@@ -0,0 +1,301 @@
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+
+#include "core/log.h"
+#include "storage/write_behind.h"
+
+namespace liftrr {
+namespace storage {
+
+WriteBehindLog::WriteBehindLog(size_t blockCount,
+                               size_t blockSize,
+                               unsigned long flushIntervalMs,
+                               void (*pulseFn)(),
+                               const char *taskName)
+    : block_count_(blockCount < 2 ? 2 : blockCount),
+      block_size_(((blockSize + BLOCK_ALIGN - 1) / BLOCK_ALIGN) * BLOCK_ALIGN),
+      flush_interval_ms_(flushIntervalMs),
+      pulse_fn_(pulseFn),
+      task_name_(taskName),
+      blocks_(nullptr),
+      free_q_(nullptr),
+      full_q_(nullptr),
+      sync_done_(nullptr),
+      file_lock_(nullptr),
+      task_(nullptr),
+      file_(nullptr),
+      cur_block_(-1),
+      cur_len_(0),
+      sync_seq_(0),
+      synced_seq_(0),
+      bytes_queued_(0),
+      bytes_written_(0),
+      blocks_written_(0),
+      overruns_(0),
+      dropped_samples_(0),
+      write_errors_(0),
+      max_write_us_(0) {
+    if (block_count_ > 255) block_count_ = 255;
+    if (block_size_ == 0) block_size_ = BLOCK_ALIGN;
+}
+
+bool WriteBehindLog::begin() {
+    if (task_) return true;
+
+    if (!blocks_) {
+        blocks_ = static_cast<uint8_t **>(calloc(block_count_, sizeof(uint8_t *)));
+        if (!blocks_) return false;
+    }
+    for (size_t i = 0; i < block_count_; i++) {
+        if (blocks_[i]) continue;
+        blocks_[i] = static_cast<uint8_t *>(
+            heap_caps_aligned_alloc(BLOCK_ALIGN, block_size_, MALLOC_CAP_DMA | MALLOC_CAP_8BIT));
+        if (!blocks_[i]) {
+            LIFTRR_LOGE(STORAGE, "writeBehind: block allocation failed.");
+            return false;
+        }
+    }
+
+    if (!free_q_) free_q_ = xQueueCreate(block_count_, sizeof(uint8_t));
+    if (!full_q_) full_q_ = xQueueCreate(block_count_ + 2, sizeof(Job));
+    if (!sync_done_) sync_done_ = xSemaphoreCreateBinary();
+    if (!file_lock_) file_lock_ = xSemaphoreCreateMutex();
+    if (!free_q_ || !full_q_ || !sync_done_ || !file_lock_) {
+        LIFTRR_LOGE(STORAGE, "writeBehind: queue allocation failed.");
+        return false;
+    }
+
+    xQueueReset(free_q_);
+    xQueueReset(full_q_);
+    for (size_t i = 0; i < block_count_; i++) {
+        uint8_t idx = (uint8_t)i;
+        xQueueSend(free_q_, &idx, 0);
+    }
+    cur_block_ = -1;
+    cur_len_ = 0;
+
+    if (xTaskCreatePinnedToCore(taskEntry, task_name_, TASK_STACK_BYTES, this,
+                                TASK_PRIORITY, &task_, TASK_CORE) != pdPASS) {
+        task_ = nullptr;
+        LIFTRR_LOGE(STORAGE, "writeBehind: task create failed.");
+        return false;
+    }
+    return true;
+}
+
+void WriteBehindLog::attach(File &file) {
+    bytes_queued_ = 0;
+    bytes_written_ = 0;
+    blocks_written_ = 0;
+    overruns_ = 0;
+    dropped_samples_ = 0;
+    write_errors_ = 0;
+    max_write_us_ = 0;
+    xSemaphoreTake(file_lock_, portMAX_DELAY);
+    file_ = &file;
+    xSemaphoreGive(file_lock_);
+}
+
+bool WriteBehindLog::reserve(uint32_t bytes) {
+    if (!file_ || !task_ || bytes == 0) return false;
+    Job job;
+    job.op = JOB_RESERVE;
+    job.block = 0;
+    job.reserved = 0;
+    job.len = bytes;
+    return xQueueSend(full_q_, &job, 0) == pdTRUE;
+}
+
+bool WriteBehindLog::takeFreeBlock() {
+    uint8_t idx = 0;
+    if (xQueueReceive(free_q_, &idx, 0) != pdTRUE) return false;
+    cur_block_ = idx;
+    cur_len_ = 0;
+    return true;
+}
+
+void WriteBehindLog::submitCurrent() {
+    if (cur_block_ < 0) return;
+    Job job;
+    job.op = JOB_WRITE;
+    job.block = (uint8_t)cur_block_;
+    job.reserved = 0;
+    job.len = (uint32_t)cur_len_;
+    // full_q_ holds every block plus one reserve and one sync job, so this
+    // never waits.
+    xQueueSend(full_q_, &job, 0);
+    cur_block_ = -1;
+    cur_len_ = 0;
+}
+
+bool WriteBehindLog::append(const void *data, size_t len) {
+    if (!file_ || !task_ || !data || len == 0) return false;
+    if (len > block_size_) {
+        dropped_samples_++;
+        return false;
+    }
+
+    if (cur_block_ < 0 && !takeFreeBlock()) {
+        overruns_++;
+        dropped_samples_++;
+        return false;
+    }
+
+    const uint8_t *src = static_cast<const uint8_t *>(data);
+    size_t room = block_size_ - cur_len_;
+
+    if (len <= room) {
+        memcpy(blocks_[cur_block_] + cur_len_, src, len);
+        cur_len_ += len;
+        if (cur_len_ == block_size_) submitCurrent();
+        bytes_queued_ += len;
+        return true;
+    }
+
+    // Reserve the spill block first so a record is never half-written.
+    uint8_t next = 0;
+    if (xQueueReceive(free_q_, &next, 0) != pdTRUE) {
+        overruns_++;
+        dropped_samples_++;
+        return false;
+    }
+
+    memcpy(blocks_[cur_block_] + cur_len_, src, room);
+    cur_len_ = block_size_;
+    submitCurrent();
+
+    cur_block_ = next;
+    memcpy(blocks_[cur_block_], src + room, len - room);
+    cur_len_ = len - room;
+    bytes_queued_ += len;
+    return true;
+}
+
+void WriteBehindLog::submit() {
+    if (cur_block_ >= 0 && cur_len_ > 0) submitCurrent();
+}
+
+bool WriteBehindLog::drain(uint32_t timeoutMs) {
+    if (!task_) return true;
+
+    if (cur_block_ >= 0) {
+        if (cur_len_ > 0) {
+            submitCurrent();
+        } else {
+            uint8_t idx = (uint8_t)cur_block_;
+            xQueueSend(free_q_, &idx, 0);
+            cur_block_ = -1;
+        }
+    }
+
+    Job sync;
+    sync.op = JOB_SYNC;
+    sync.block = 0;
+    sync.reserved = 0;
+    sync.len = ++sync_seq_;
+    // The queue has room for one sync job; a sync left by an earlier drain()
+    // that timed out may still hold it while the writer is stuck on SD.
+    uint32_t startMs = millis();
+    if (xQueueSend(full_q_, &sync, pdMS_TO_TICKS(timeoutMs)) != pdTRUE) return false;
+
+    // That earlier sync may also complete late and leave the semaphore
+    // given; only this sequence number counts.
+    for (;;) {
+        if ((int32_t)(synced_seq_ - sync.len) >= 0) return true;
+        uint32_t elapsedMs = millis() - startMs;
+        if (elapsedMs >= timeoutMs) return false;
+        xSemaphoreTake(sync_done_, pdMS_TO_TICKS(timeoutMs - elapsedMs));
+    }
+}
+
+void WriteBehindLog::detach() {
+    if (!file_lock_) {
+        file_ = nullptr;
+        return;
+    }
+    xSemaphoreTake(file_lock_, portMAX_DELAY);
+    file_ = nullptr;
+    xSemaphoreGive(file_lock_);
+}
+
+WriteBehindLog::Stats WriteBehindLog::stats() const {
+    Stats s;
+    s.bytesQueued = bytes_queued_;
+    s.bytesWritten = bytes_written_;
+    s.blocksWritten = blocks_written_;
+    s.overruns = overruns_;
+    s.droppedSamples = dropped_samples_;
+    s.writeErrors = write_errors_;
+    s.maxWriteUs = max_write_us_;
+    return s;
+}
+
+void WriteBehindLog::taskEntry(void *arg) {
+    static_cast<WriteBehindLog *>(arg)->taskLoop();
+}
+
+void WriteBehindLog::taskLoop() {
+    Job job;
+    unsigned long lastFlushMs = millis();  // writer task only
+    for (;;) {
+        if (xQueueReceive(full_q_, &job, portMAX_DELAY) != pdTRUE) continue;
+
+        xSemaphoreTake(file_lock_, portMAX_DELAY);
+        File *file = file_;
+        if (job.op == JOB_SYNC) {
+            if (file && *file) file->flush();
+            xSemaphoreGive(file_lock_);
+            synced_seq_ = job.len;
+            xSemaphoreGive(sync_done_);
+            lastFlushMs = millis();
+            continue;
+        }
+        if (job.op == JOB_RESERVE) {
+            if (file && *file) reserveFile(*file, job.len);
+            xSemaphoreGive(file_lock_);
+            continue;
+        }
+
+        if (file && *file && job.len > 0) {
+            if (pulse_fn_) pulse_fn_();
+            uint32_t startUs = micros();
+            size_t n = file->write(blocks_[job.block], job.len);
+            if (n != job.len) write_errors_++;
+            bytes_written_ += n;
+            blocks_written_++;
+
+            unsigned long now = millis();
+            if (now - lastFlushMs >= flush_interval_ms_) {
+                file->flush();
+                lastFlushMs = now;
+            }
+
+            uint32_t elapsedUs = micros() - startUs;
+            if (elapsedUs > max_write_us_) max_write_us_ = elapsedUs;
+        }
+        xSemaphoreGive(file_lock_);
+
+        xQueueSend(free_q_, &job.block, portMAX_DELAY);
+    }
+}
+
+// Seeking past EOF and writing one byte through the VFS makes FatFs
+// allocate the cluster chain now, so later writes only follow it instead
+// of searching the FAT at every cluster boundary. This is not SdFat
+// preAllocate(): the chain is contiguous only if free space is.
+void WriteBehindLog::reserveFile(File &file, uint32_t bytes) {
+    uint32_t startMs = millis();
+    uint8_t zero = 0;
+    bool ok = file.seek(bytes - 1) && file.write(&zero, 1) == 1;
+    file.flush();
+    file.seek(0);
+    if (!ok) {
+        LIFTRR_LOGW(STORAGE, "writeBehind: pre-allocation failed, growing on demand.");
+        return;
+    }
+    LIFTRR_LOGI(STORAGE, "writeBehind: pre-allocated %lu bytes in %lu ms",
+                (unsigned long)bytes, (unsigned long)(millis() - startMs));
+}
+
+} // namespace storage
+} // namespace liftrr
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+namespace liftrr {
+namespace storage {
+
+// Write-behind stage for one open session file (samples or the rep table).
+// The producer (loop) copies bytes into fixed-size RAM blocks and a
+// background task commits full blocks to SD. append() never waits on SD I/O:
+// when every block is still in flight the data is dropped and counted.
+// Blocks are whole sectors in size, but the file offsets they land on are
+// not sector-aligned: the file header and submit()/drain() partial blocks
+// shift them.
+class WriteBehindLog {
+public:
+    struct Stats {
+        uint32_t bytesQueued;
+        uint32_t bytesWritten;
+        uint32_t blocksWritten;
+        uint32_t overruns;        // append found no free block
+        uint32_t droppedSamples;  // appends rejected (overrun or oversized)
+        uint32_t writeErrors;
+        uint32_t maxWriteUs;
+    };
+
+    static const size_t BLOCK_ALIGN = 512;  // block size granularity and DMA buffer alignment
+
+    WriteBehindLog(size_t blockCount,
+                   size_t blockSize,
+                   unsigned long flushIntervalMs,
+                   void (*pulseFn)() = nullptr,
+                   const char *taskName = "sdWriter");
+
+    // Allocates blocks and starts the writer task. Safe to call repeatedly.
+    bool begin();
+
+    // Producer side (loop task).
+    void attach(File &file);
+    // Queues pre-allocation of `bytes` on the writer task, ahead of any
+    // data appended after it; call right after attach(). The writer
+    // extends the file to that size and rewinds, so the loop task never
+    // waits on the FAT. False if the job could not be queued.
+    bool reserve(uint32_t bytes);
+    bool append(const void *data, size_t len);
+    // Hands a partial block to the writer without waiting, for sparse
+    // records that should reach SD before the block fills.
+    void submit();
+
+    // Submits the partial block, waits for all pending writes and a flush.
+    // Returns false if that does not finish within timeoutMs, including
+    // when the writer is too far behind to accept the flush request.
+    bool drain(uint32_t timeoutMs);
+    // Waits for a write in progress, then stops the writer touching the
+    // file; blocks still queued are discarded. The file may be closed once
+    // this returns, even after drain() timed out.
+    void detach();
+
+    Stats stats() const;
+
+private:
+    enum JobOp : uint8_t {
+        JOB_WRITE,
+        JOB_SYNC,
+        JOB_RESERVE,
+    };
+
+    struct Job {
+        uint8_t op;
+        uint8_t block;
+        uint16_t reserved;
+        uint32_t len;  // JOB_SYNC: sequence number; JOB_RESERVE: file size
+    };
+
+    static void taskEntry(void *arg);
+    void taskLoop();
+    bool takeFreeBlock();
+    void submitCurrent();
+    void reserveFile(File &file, uint32_t bytes);
+
+    size_t block_count_;
+    size_t block_size_;
+    unsigned long flush_interval_ms_;
+    void (*pulse_fn_)();
+    const char *task_name_;
+
+    uint8_t **blocks_;
+    QueueHandle_t free_q_;
+    QueueHandle_t full_q_;
+    SemaphoreHandle_t sync_done_;
+    SemaphoreHandle_t file_lock_;  // held by the writer while it uses file_
+    TaskHandle_t task_;
+
+    File *volatile file_;
+    int cur_block_;
+    size_t cur_len_;
+    uint32_t sync_seq_;             // last sync requested (producer)
+    volatile uint32_t synced_seq_;  // last sync completed (writer)
+
+    volatile uint32_t bytes_queued_;
+    volatile uint32_t bytes_written_;
+    volatile uint32_t blocks_written_;
+    volatile uint32_t overruns_;
+    volatile uint32_t dropped_samples_;
+    volatile uint32_t write_errors_;
+    volatile uint32_t max_write_us_;
+
+    static const uint32_t TASK_STACK_BYTES = 6144;
+    static const UBaseType_t TASK_PRIORITY = 1;
+    static const BaseType_t TASK_CORE = 0;
+};
+
+} // namespace storage
+} // namespace liftrr
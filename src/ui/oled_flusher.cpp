@@ -0,0 +1,117 @@
+#include "ui/oled_flusher.h"
+
+#include <string.h>
+
+#include "core/i2c_bus.h"
+
+namespace liftrr {
+namespace ui {
+
+namespace {
+
+const uint8_t kControlCommand = 0x00;
+const uint8_t kControlData = 0x40;
+
+} // namespace
+
+OledFlusher::OledFlusher(Adafruit_SSD1306 &display, TwoWire &wire, uint8_t address)
+    : display_(display),
+      wire_(wire),
+      address_(address),
+      shadow_valid_(false),
+      stats_() {
+    memset(shadow_, 0, sizeof(shadow_));
+}
+
+void OledFlusher::invalidate() {
+    shadow_valid_ = false;
+}
+
+bool OledFlusher::flush() {
+    const uint8_t *buf = display_.getBuffer();
+    if (!buf) return false;
+
+    uint32_t startUs = micros();
+    uint32_t bytes = 0;
+    uint16_t runs = 0;
+    uint8_t pages = 0;
+    bool ok = true;
+
+    for (uint8_t page = 0; page < PAGE_COUNT && ok; page++) {
+        const uint8_t *now = buf + (size_t)page * SCREEN_WIDTH;
+        uint8_t *shown = shadow_ + (size_t)page * SCREEN_WIDTH;
+        bool pageTouched = false;
+
+        uint16_t col = 0;
+        while (col < SCREEN_WIDTH && ok) {
+            if (shadow_valid_ && now[col] == shown[col]) {
+                col++;
+                continue;
+            }
+            // Extend the run until RUN_MERGE_GAP unchanged columns in a row.
+            uint16_t first = col;
+            uint16_t last = col;
+            for (uint16_t c = col + 1; c < SCREEN_WIDTH && c - last <= RUN_MERGE_GAP; c++) {
+                if (!shadow_valid_ || now[c] != shown[c]) last = c;
+            }
+            ok = writeRun(page, (uint8_t)first, (uint8_t)last, now + first);
+            if (ok) {
+                size_t len = (size_t)(last - first + 1);
+                memcpy(shown + first, now + first, len);
+                bytes += len;
+                runs++;
+                pageTouched = true;
+            }
+            col = last + 1;
+        }
+        if (pageTouched) pages++;
+    }
+
+    shadow_valid_ = ok;
+    stats_.frames++;
+    stats_.lastBytes = bytes;
+    stats_.lastRuns = runs;
+    stats_.lastPages = pages;
+    stats_.lastFlushUs = micros() - startUs;
+    stats_.totalBytes += bytes;
+    if (bytes > stats_.maxBytes) stats_.maxBytes = bytes;
+    if (!ok) stats_.errors++;
+    return ok;
+}
+
+bool OledFlusher::writeRun(uint8_t page, uint8_t firstCol, uint8_t lastCol, const uint8_t *data) {
+    liftrr::core::I2cBus &bus = liftrr::core::i2cBus();
+    {
+        liftrr::core::I2cBus::Lease lease(bus, liftrr::core::I2cDevice::OLED,
+                                          liftrr::core::I2cPriority::DISPLAY,
+                                          I2C_DISPLAY_DEADLINE_US);
+        if (!lease.ok()) return false;
+        wire_.beginTransmission(address_);
+        wire_.write(kControlCommand);
+        wire_.write(SSD1306_PAGEADDR);
+        wire_.write(page);
+        wire_.write(page);
+        wire_.write(SSD1306_COLUMNADDR);
+        wire_.write(firstCol);
+        wire_.write(lastCol);
+        if (wire_.endTransmission() != 0) return false;
+    }
+
+    size_t len = (size_t)(lastCol - firstCol + 1);
+    for (size_t offset = 0; offset < len; offset += CHUNK_BYTES) {
+        size_t n = len - offset;
+        if (n > CHUNK_BYTES) n = CHUNK_BYTES;
+        liftrr::core::I2cBus::Lease lease(bus, liftrr::core::I2cDevice::OLED,
+                                          liftrr::core::I2cPriority::DISPLAY,
+                                          I2C_DISPLAY_DEADLINE_US);
+        if (!lease.ok()) return false;
+        wire_.beginTransmission(address_);
+        wire_.write(kControlData);
+        wire_.write(data + offset, n);
+        if (wire_.endTransmission() != 0) return false;
+    }
+    return true;
+}
+
+} // namespace ui
+} // namespace liftrr
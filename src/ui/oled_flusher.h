@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Adafruit_SSD1306.h>
+#include <Wire.h>
+
+#include "core/config.h"
+
+namespace liftrr {
+namespace ui {
+
+struct OledFlushStats {
+    uint32_t frames;          // flush() calls
+    uint32_t lastBytes;       // data bytes sent by the last flush
+    uint16_t lastRuns;        // column runs sent by the last flush
+    uint8_t lastPages;        // pages touched by the last flush
+    uint32_t lastFlushUs;
+    uint32_t maxBytes;
+    uint64_t totalBytes;
+    uint32_t errors;          // flushes cut short by a bus error or timeout
+};
+
+// Sends the SSD1306 frame buffer in short I2C transactions, each under its
+// own I2cBus lease, instead of Adafruit_SSD1306::display()'s single
+// back-to-back burst. Sensor reads slot in between chunks.
+//
+// A shadow copy of what the panel shows is kept; each 128x8 page is diffed
+// against it and only the changed column runs are addressed and sent
+// (runs closer than RUN_MERGE_GAP are merged, since a new run costs a
+// command transaction). Loop task only.
+class OledFlusher {
+public:
+    OledFlusher(Adafruit_SSD1306 &display, TwoWire &wire, uint8_t address);
+
+    // Pushes what changed since the last flush. Returns false if a
+    // transaction failed or the bus stayed busy; the next flush resends
+    // the whole frame.
+    bool flush();
+
+    // Forget the shadow (e.g. after the panel was reset or written by
+    // someone else); the next flush sends every page.
+    void invalidate();
+
+    const OledFlushStats &stats() const { return stats_; }
+
+private:
+    static const uint8_t PAGE_COUNT = SCREEN_HEIGHT / 8;
+    static const uint8_t CHUNK_BYTES = 64;   // + control byte, within Wire's 128-byte buffer
+    static const uint8_t RUN_MERGE_GAP = 8;  // ~ one addressing transaction
+
+    bool writeRun(uint8_t page, uint8_t firstCol, uint8_t lastCol, const uint8_t *data);
+
+    Adafruit_SSD1306 &display_;
+    TwoWire &wire_;
+    uint8_t address_;
+    bool shadow_valid_;
+    uint8_t shadow_[SCREEN_WIDTH * PAGE_COUNT];
+    OledFlushStats stats_;
+};
+
+} // namespace ui
+} // namespace liftrr
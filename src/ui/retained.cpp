@@ -0,0 +1,51 @@
+#include "ui/retained.h"
+
+#include <string.h>
+
+namespace liftrr {
+namespace ui {
+
+StaticLayer::StaticLayer(Adafruit_SSD1306 &display)
+    : display_(display), screen_id_(0) {
+    memset(cache_, 0, sizeof(cache_));
+}
+
+void StaticLayer::capture(uint8_t screenId) {
+    const uint8_t *buf = display_.getBuffer();
+    if (!buf) return;
+    memcpy(cache_, buf, sizeof(cache_));
+    screen_id_ = screenId;
+}
+
+void StaticLayer::restoreRect(int16_t x, int16_t y, int16_t w, int16_t h) {
+    uint8_t *buf = display_.getBuffer();
+    if (!buf) return;
+
+    // Clip to the panel.
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > SCREEN_WIDTH) w = SCREEN_WIDTH - x;
+    if (y + h > SCREEN_HEIGHT) h = SCREEN_HEIGHT - y;
+    if (w <= 0 || h <= 0) return;
+
+    // SSD1306 layout: one byte per column per 8-row page, LSB = top row.
+    int16_t yEnd = y + h;  // exclusive
+    for (int16_t page = y / 8; page * 8 < yEnd; page++) {
+        int16_t top = page * 8;
+        uint8_t mask = 0xFF;
+        if (y > top) mask &= (uint8_t)(0xFF << (y - top));
+        if (yEnd < top + 8) mask &= (uint8_t)(0xFF >> (top + 8 - yEnd));
+
+        size_t row = (size_t)page * SCREEN_WIDTH;
+        if (mask == 0xFF) {
+            memcpy(buf + row + x, cache_ + row + x, (size_t)w);
+        } else {
+            for (int16_t col = x; col < x + w; col++) {
+                buf[row + col] = (uint8_t)((buf[row + col] & ~mask) | (cache_[row + col] & mask));
+            }
+        }
+    }
+}
+
+} // namespace ui
+} // namespace liftrr
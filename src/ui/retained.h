@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Adafruit_SSD1306.h>
+
+#include "core/config.h"
+
+namespace liftrr {
+namespace ui {
+
+// Cached render of a screen's static template (frames, axes, labels).
+// capture() snapshots the display buffer after the template was drawn;
+// restoreRect() puts the template back under a widget before it redraws.
+class StaticLayer {
+public:
+    explicit StaticLayer(Adafruit_SSD1306 &display);
+
+    void capture(uint8_t screenId);
+    void invalidate() { screen_id_ = 0; }
+    // True when the cache holds screenId's template (0 = none).
+    bool holds(uint8_t screenId) const { return screen_id_ != 0 && screen_id_ == screenId; }
+
+    void restoreRect(int16_t x, int16_t y, int16_t w, int16_t h);
+
+private:
+    static const size_t BUFFER_BYTES = (size_t)SCREEN_WIDTH * (SCREEN_HEIGHT / 8);
+
+    Adafruit_SSD1306 &display_;
+    uint8_t screen_id_;
+    uint8_t cache_[BUFFER_BYTES];
+};
+
+// A dynamic region bound to one value: redrawn only when the value changes.
+struct Widget {
+    int16_t x, y, w, h;  // bounds restored from the static layer before a redraw
+    int32_t value;
+    bool drawn;
+
+    // True (and the new value is latched) when the widget must be redrawn.
+    bool update(int32_t v) {
+        if (drawn && v == value) return false;
+        value = v;
+        drawn = true;
+        return true;
+    }
+    void invalidate() { drawn = false; }
+};
+
+} // namespace ui
+} // namespace liftrr
@@ -42,71 +42,99 @@ void UiRenderer::drawTiltGauge(float roll) {
 }
 
 void UiRenderer::drawStatusBar(bool recording) {
+    drawStatusBarFrame();
+    drawStatusLabel(recording);
+    drawStatusBlink((millis() / 500) % 2 == 0);
+}
+
+void UiRenderer::drawStatusBarFrame() {
     display_.fillRect(0, 0, SCREEN_WIDTH, 10, SSD1306_WHITE);
     display_.setTextColor(SSD1306_BLACK, SSD1306_WHITE);
     display_.setTextSize(1);
-    
+
+    display_.setCursor(50, 1);
+    display_.print("SD:--");
+
+    display_.setTextColor(SSD1306_WHITE);
+}
+
+void UiRenderer::drawStatusLabel(bool recording) {
+    display_.setTextColor(SSD1306_BLACK, SSD1306_WHITE);
+    display_.setTextSize(1);
+
     display_.setCursor(2, 1);
     if (sensors_.laserOffset() == 0) display_.print("SETUP");
     else display_.print(recording ? "REC" : "LIVE");
 
-    display_.setCursor(50, 1);
-    display_.print("SD:--");
+    display_.setTextColor(SSD1306_WHITE);
+}
 
-    if ((millis() / 500) % 2 == 0) {
+void UiRenderer::drawStatusBlink(bool on) {
+    if (on) {
         display_.fillCircle(122, 4, 2, SSD1306_BLACK);
     }
-    
-    display_.setTextColor(SSD1306_WHITE);
 }
 
-
 void UiRenderer::drawVerticalBar(int16_t currentVal) {
-    int x = 118;
-    int y = 14;
-    int w = 8;
-    int h = 48;
-    int maxRange = 1000; // +/- 1000mm range
+    drawVerticalBarFrame();
+    drawVerticalBarFill(currentVal);
+}
 
+void UiRenderer::drawVerticalBarFrame() {
     // Draw Frame
-    display_.drawRect(x, y, w, h, SSD1306_WHITE);
-    
-    // Calculate Center Y of the bar
-    int centerY = y + (h / 2);
+    display_.drawRect(VBAR_X, VBAR_Y, VBAR_W, VBAR_H, SSD1306_WHITE);
 
     // Draw Center Line (Zero Point)
-    display_.drawFastHLine(x - 2, centerY, w + 4, SSD1306_WHITE);
+    int centerY = VBAR_Y + (VBAR_H / 2);
+    display_.drawFastHLine(VBAR_X - 2, centerY, VBAR_W + 4, SSD1306_WHITE);
+}
+
+int UiRenderer::verticalBarFillPx(int16_t currentVal) {
+    int maxRange = 1000; // +/- 1000mm range
 
     // Constrain input to range
     int16_t val = constrain(currentVal, -maxRange, maxRange);
 
     // Map value to pixel height (half height of bar is max range)
     // Height available in one direction = (h/2) - 2 padding
-    int pixelHeight = map(abs(val), 0, maxRange, 0, (h / 2) - 2);
-
-    if (pixelHeight > 0) {
-        if (val > 0) {
-            // Positive: Fill UP from Center
-            // Top Y = CenterY - pixelHeight
-            display_.fillRect(x + 2, centerY - pixelHeight, w - 4, pixelHeight, SSD1306_WHITE);
-        } else {
-            // Negative: Fill DOWN from Center
-            // Top Y = CenterY + 1 (start below line)
-            display_.fillRect(x + 2, centerY + 1, w - 4, pixelHeight, SSD1306_WHITE);
-        }
+    int pixelHeight = map(abs(val), 0, maxRange, 0, (VBAR_H / 2) - 2);
+    return val > 0 ? pixelHeight : -pixelHeight;
+}
+
+void UiRenderer::drawVerticalBarFill(int16_t currentVal) {
+    int centerY = VBAR_Y + (VBAR_H / 2);
+    int fill = verticalBarFillPx(currentVal);
+
+    if (fill > 0) {
+        // Positive: Fill UP from Center
+        // Top Y = CenterY - pixelHeight
+        display_.fillRect(VBAR_X + 2, centerY - fill, VBAR_W - 4, fill, SSD1306_WHITE);
+    } else if (fill < 0) {
+        // Negative: Fill DOWN from Center
+        // Top Y = CenterY + 1 (start below line)
+        display_.fillRect(VBAR_X + 2, centerY + 1, VBAR_W - 4, -fill, SSD1306_WHITE);
     }
 }
 
 void UiRenderer::drawHorizon(float roll) {
-    int y = 58; int w = 60; int x = (118 - w) / 2; 
-    
-    display_.drawFastHLine(x, y, w, SSD1306_WHITE);
-    display_.drawFastVLine(x + w / 2, y - 2, 5, SSD1306_WHITE); 
-    
-    int indicatorX = map(constrain((int)roll, -20, 20), -20, 20, x, x + w);
-    display_.drawRect(indicatorX - 3, y - 3, 7, 7, SSD1306_WHITE);
+    drawHorizonAxis();
+    drawHorizonMarker(roll);
+}
+
+void UiRenderer::drawHorizonAxis() {
+    display_.drawFastHLine(HORIZON_X, HORIZON_Y, HORIZON_W, SSD1306_WHITE);
+    display_.drawFastVLine(HORIZON_X + HORIZON_W / 2, HORIZON_Y - 2, 5, SSD1306_WHITE);
+}
+
+int UiRenderer::horizonMarkerX(float roll) {
+    return map(constrain((int)roll, -20, 20), -20, 20, HORIZON_X, HORIZON_X + HORIZON_W);
+}
+
+void UiRenderer::drawHorizonMarker(float roll) {
+    int indicatorX = horizonMarkerX(roll);
+    display_.drawRect(indicatorX - 3, HORIZON_Y - 3, 7, 7, SSD1306_WHITE);
     if (abs(roll) < 2) {
-        display_.fillRect(indicatorX - 1, y - 1, 3, 3, SSD1306_WHITE);
+        display_.fillRect(indicatorX - 1, HORIZON_Y - 1, 3, 3, SSD1306_WHITE);
     }
 }
 
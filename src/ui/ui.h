@@ -18,6 +18,29 @@ public:
     void drawVerticalBar(int16_t currentVal);
     void drawHorizon(float roll);
 
+    // Static and dynamic halves of the widgets above, for retained screens
+    // (see DisplayManager::renderTrackingScreen).
+    void drawStatusBarFrame();
+    void drawStatusLabel(bool recording);
+    void drawStatusBlink(bool on);
+    void drawVerticalBarFrame();
+    void drawVerticalBarFill(int16_t currentVal);
+    void drawHorizonAxis();
+    void drawHorizonMarker(float roll);
+
+    // Pixel state the dynamic halves would draw; equal values draw equal pixels.
+    static int verticalBarFillPx(int16_t currentVal);  // signed: + fills up
+    static int horizonMarkerX(float roll);
+
+    // Geometry, so callers can bound the dynamic regions.
+    static const int16_t VBAR_X = 118;
+    static const int16_t VBAR_Y = 14;
+    static const int16_t VBAR_W = 8;
+    static const int16_t VBAR_H = 48;
+    static const int16_t HORIZON_Y = 58;
+    static const int16_t HORIZON_W = 60;
+    static const int16_t HORIZON_X = (VBAR_X - HORIZON_W) / 2;
+
 private:
     Adafruit_SSD1306 &display_;
     liftrr::sensors::SensorManager &sensors_;
@@ -0,0 +1,10 @@
+#pragma once
+
+// Host stand-in: declarations only, the driver is never built on the host.
+
+typedef enum {
+    OPERATION_MODE_CONFIG = 0x00,
+    OPERATION_MODE_NDOF = 0x0C,
+} adafruit_bno055_opmode_t;
+
+class Adafruit_BNO055;
@@ -0,0 +1,32 @@
+#pragma once
+
+// Host stand-in: the Adafruit Unified Sensor types sensors.h uses.
+
+#include <stdint.h>
+
+typedef struct {
+    union {
+        float v[3];
+        struct {
+            float x;
+            float y;
+            float z;
+        };
+        struct {
+            float roll;
+            float pitch;
+            float heading;
+        };
+    };
+    int8_t status;
+    uint8_t reserved[3];
+} sensors_vec_t;
+
+typedef struct {
+    int32_t version;
+    int32_t sensor_id;
+    int32_t type;
+    int32_t reserved0;
+    int32_t timestamp;
+    sensors_vec_t orientation;
+} sensors_event_t;
@@ -0,0 +1,5 @@
+#pragma once
+
+// Host stand-in: declarations only, the driver is never built on the host.
+
+class Adafruit_VL53L1X;
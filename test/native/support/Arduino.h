@@ -0,0 +1,30 @@
+#pragma once
+
+// Host stand-in for the Arduino core: only what the pure-logic units built
+// by [env:native] use. Time does not pass on its own; tests drive it with
+// hostclock::setUs()/advanceUs().
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define IRAM_ATTR
+
+namespace hostclock {
+
+inline uint32_t &nowUs() {
+    static uint32_t us = 0;
+    return us;
+}
+
+inline void setUs(uint32_t us) { nowUs() = us; }
+inline void advanceUs(uint32_t us) { nowUs() += us; }
+
+} // namespace hostclock
+
+inline unsigned long micros() { return hostclock::nowUs(); }
+inline unsigned long millis() { return hostclock::nowUs() / 1000UL; }
@@ -0,0 +1,6 @@
+#pragma once
+
+// Host stand-in: declarations only, no I2C on the host.
+
+class TwoWire;
+extern TwoWire Wire;
@@ -0,0 +1,170 @@
+// Laser + IMU vertical Kalman filter (sensors/bar_estimator.h).
+
+#include <unity.h>
+
+#include "sensors/bar_estimator.h"
+
+using liftrr::sensors::BarEstimator;
+using liftrr::sensors::RelativePose;
+using liftrr::sensors::SensorSample;
+
+namespace {
+
+const uint32_t STEP_US = SENSOR_TASK_PERIOD_MS * 1000UL;
+const uint32_t LASER_EVERY = 2;  // laser at half the sensor task rate
+
+SensorSample level() {
+    SensorSample sample = SensorSample();
+    sample.quat[0] = 1.0f;
+    return sample;
+}
+
+// Drives the filter like SensorTask: one step per cycle, a fresh laser
+// reading every LASER_EVERY cycles.
+struct Harness {
+    BarEstimator est;
+    SensorSample sample;
+    RelativePose pose;
+    uint32_t us;
+    uint32_t cycle;
+
+    Harness() : sample(level()), pose(), us(1000000), cycle(0) {}
+
+    void step(float distMm, bool laserValid = true) {
+        sample.distFresh = (cycle % LASER_EVERY) == 0;
+        if (sample.distFresh) {
+            sample.distUs = us;
+            pose.relDist = (int16_t)lroundf(distMm);
+        }
+        est.step(sample, us, laserValid, pose);
+        us += STEP_US;
+        cycle++;
+    }
+
+    void settle(float distMm, uint32_t cycles) {
+        for (uint32_t i = 0; i < cycles; i++) step(distMm);
+    }
+};
+
+} // namespace
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_follows_laser_until_valid(void) {
+    Harness h;
+    h.step(250.0f, false);
+    h.step(260.0f, false);
+    TEST_ASSERT_EQUAL_FLOAT(250.0f, h.pose.dispMm);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, h.pose.velMmS);
+    TEST_ASSERT_EQUAL_UINT32(0, h.est.stats().corrections);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, h.est.stats().posSigmaMm);
+}
+
+void test_stationary_bar_converges(void) {
+    Harness h;
+    h.settle(300.0f, 200);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 300.0f, h.pose.dispMm);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 0.0f, h.pose.velMmS);
+    TEST_ASSERT_EQUAL_UINT32(99, h.est.stats().corrections);
+    TEST_ASSERT_EQUAL_UINT32(0, h.est.stats().rejects);
+    TEST_ASSERT_TRUE(h.est.stats().posSigmaMm < BAR_EST_LASER_NOISE_MM);
+}
+
+void test_tracks_constant_velocity(void) {
+    Harness h;
+    const float velMmS = 200.0f;
+    float mm = 100.0f;
+    for (uint32_t i = 0; i < 300; i++) {
+        h.step(mm);
+        mm += velMmS * STEP_US * 1e-6f;
+    }
+    TEST_ASSERT_FLOAT_WITHIN(5.0f, velMmS, h.pose.velMmS);
+    TEST_ASSERT_FLOAT_WITHIN(3.0f, mm - velMmS * STEP_US * 1e-6f, h.pose.dispMm);
+    TEST_ASSERT_EQUAL_UINT32(0, h.est.stats().rejects);
+}
+
+void test_acceleration_drives_prediction(void) {
+    Harness h;
+    h.settle(300.0f, 100);
+    // Bar accelerating up at 1 m/s^2 with no laser reading.
+    h.sample.linAccel.z = 1.0f;
+    h.sample.distFresh = false;
+    uint32_t lastUs = h.us - STEP_US;
+    for (uint32_t i = 0; i < 5; i++) {
+        h.est.step(h.sample, lastUs + (i + 1) * STEP_US, true, h.pose);
+    }
+    TEST_ASSERT_EQUAL_FLOAT(1000.0f, h.pose.accelMmS2);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 50.0f, h.pose.velMmS);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 301.25f, h.pose.dispMm);
+}
+
+void test_outlier_is_rejected_then_repeats_reset(void) {
+    Harness h;
+    h.settle(300.0f, 100);
+    uint32_t resets = h.est.stats().resets;
+
+    h.step(450.0f);
+    h.step(450.0f);
+    TEST_ASSERT_EQUAL_UINT32(1, h.est.stats().rejects);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 300.0f, h.pose.dispMm);
+    h.settle(300.0f, 2);
+    TEST_ASSERT_EQUAL_UINT32(resets, h.est.stats().resets);
+
+    // Consistently somewhere else: the target moved, start over there.
+    for (uint32_t i = 0; i < BAR_EST_MAX_REJECTS * LASER_EVERY; i++) h.step(600.0f);
+    TEST_ASSERT_EQUAL_UINT32(1 + BAR_EST_MAX_REJECTS, h.est.stats().rejects);
+    TEST_ASSERT_EQUAL_UINT32(resets + 1, h.est.stats().resets);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 600.0f, h.pose.dispMm);
+}
+
+void test_long_gap_restarts_from_laser(void) {
+    Harness h;
+    h.settle(300.0f, 100);
+    h.us += BAR_EST_MAX_GAP_US;
+    h.cycle = 0;
+    h.step(350.0f);
+    TEST_ASSERT_EQUAL_UINT32(1, h.est.stats().resets);
+    TEST_ASSERT_EQUAL_FLOAT(350.0f, h.pose.dispMm);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, h.pose.velMmS);
+}
+
+void test_lost_laser_stops_filter(void) {
+    Harness h;
+    h.settle(300.0f, 100);
+    h.step(320.0f, false);
+    TEST_ASSERT_EQUAL_UINT32(1, h.est.stats().resets);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, h.pose.velMmS);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, h.est.stats().posSigmaMm);
+}
+
+void test_vertical_accel_rotates_into_earth_frame(void) {
+    SensorSample sample = level();
+    sample.linAccel.x = 0.5f;
+    sample.linAccel.y = 1.5f;
+    sample.linAccel.z = 2.0f;
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 2000.0f, BarEstimator::verticalAccelMmS2(sample));
+
+    // Upside down (180 deg about x): sensor z points at the floor.
+    sample.quat[0] = 0.0f;
+    sample.quat[1] = 1.0f;
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, -2000.0f, BarEstimator::verticalAccelMmS2(sample));
+
+    // 90 deg about x: sensor y points up.
+    sample.quat[0] = sqrtf(0.5f);
+    sample.quat[1] = sqrtf(0.5f);
+    TEST_ASSERT_FLOAT_WITHIN(1e-2f, 1500.0f, BarEstimator::verticalAccelMmS2(sample));
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_follows_laser_until_valid);
+    RUN_TEST(test_stationary_bar_converges);
+    RUN_TEST(test_tracks_constant_velocity);
+    RUN_TEST(test_acceleration_drives_prediction);
+    RUN_TEST(test_outlier_is_rejected_then_repeats_reset);
+    RUN_TEST(test_long_gap_restarts_from_laser);
+    RUN_TEST(test_lost_laser_stops_filter);
+    RUN_TEST(test_vertical_accel_rotates_into_earth_frame);
+    return UNITY_END();
+}
@@ -0,0 +1,61 @@
+// Wire ids for command and event names (ble/ble_protocol_ids.h).
+
+#include <unity.h>
+
+#include "ble/ble_protocol_ids.h"
+
+using namespace liftrr::ble;
+using liftrr::core::nameHash;
+
+static_assert(nameHash("session.start") == nameHash("Session.START"),
+              "name hash must ignore case");
+static_assert(nameHash("ping") != nameHash("pong"), "distinct names, distinct hashes");
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_table_round_trips(void) {
+    for (const MessageId &m : kMessageIds) {
+        TEST_ASSERT_EQUAL_UINT32(nameHash(m.name), m.hash);
+        TEST_ASSERT_EQUAL_UINT8(m.id, messageIdForName(m.name));
+        TEST_ASSERT_EQUAL_STRING(m.name, messageNameForId(m.id));
+    }
+}
+
+void test_lookup_ignores_case(void) {
+    TEST_ASSERT_EQUAL_UINT8(MSG_SESSION_STREAM, messageIdForName("Session.Stream"));
+    TEST_ASSERT_EQUAL_UINT8(MSG_SESSIONS_STREAM_MANY, messageIdForName("SESSIONS.STREAMMANY"));
+}
+
+void test_unknown_names_and_ids(void) {
+    TEST_ASSERT_EQUAL_UINT8(MSG_NONE, messageIdForName("session.pause"));
+    TEST_ASSERT_EQUAL_UINT8(MSG_NONE, messageIdForName(""));
+    TEST_ASSERT_EQUAL_UINT8(MSG_NONE, messageIdForName(nullptr));
+    // A prefix of a known name must not match it.
+    TEST_ASSERT_EQUAL_UINT8(MSG_NONE, messageIdForName("session"));
+    TEST_ASSERT_NULL(messageNameForId(MSG_NONE));
+    TEST_ASSERT_NULL(messageNameForId(MSG_LAST_COMMAND + 1));
+    TEST_ASSERT_NULL(messageNameForId(256 + MSG_PING));
+}
+
+void test_command_ids_are_contiguous(void) {
+    // Commands dispatch on their id, so every id up to the last one is used.
+    for (uint32_t id = 1; id <= MSG_LAST_COMMAND; id++) {
+        TEST_ASSERT_NOT_NULL(messageNameForId(id));
+    }
+    size_t commands = 0;
+    for (const MessageId &m : kMessageIds) {
+        if (m.id <= MSG_LAST_COMMAND) commands++;
+        else TEST_ASSERT_GREATER_OR_EQUAL(MSG_TIME_SYNC_REQUEST, m.id);
+    }
+    TEST_ASSERT_EQUAL_size_t(MSG_LAST_COMMAND, commands);
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_table_round_trips);
+    RUN_TEST(test_lookup_ignores_case);
+    RUN_TEST(test_unknown_names_and_ids);
+    RUN_TEST(test_command_ids_are_contiguous);
+    return UNITY_END();
+}
@@ -0,0 +1,214 @@
+// Streaming rep segmentation (app/rep_detector.h).
+
+#include <unity.h>
+
+#include <vector>
+
+#include "app/rep_detector.h"
+
+using liftrr::app::RepDetector;
+using liftrr::app::RepOrder;
+using liftrr::app::REP_DOWN_UP;
+using liftrr::app::REP_UP_DOWN;
+using liftrr::app::repOrderForExercise;
+using liftrr::sensors::SensorRecord;
+using liftrr::storage::SessionRep;
+
+namespace {
+
+const uint32_t STEP_US = SENSOR_TASK_PERIOD_MS * 1000UL;
+
+// Piecewise-linear bar path sampled at the sensor task rate. Velocity is the
+// backward difference, so the first record of a ramp still reads as at rest.
+class BarPath {
+public:
+    explicit BarPath(uint32_t startUs = 1000000, float startMm = 0.0f)
+        : us_(startUs), mm_(startMm), started_(false) {}
+
+    BarPath &hold(uint32_t ms) { return moveTo(mm_, ms); }
+
+    BarPath &moveTo(float targetMm, uint32_t ms) {
+        uint32_t steps = ms * 1000UL / STEP_US;
+        float from = mm_;
+        if (!started_) {
+            records_.push_back(makeRecord(mm_, 0.0f));
+            started_ = true;
+        }
+        for (uint32_t i = 1; i <= steps; i++) {
+            float prev = mm_;
+            mm_ = from + (targetMm - from) * (float)i / (float)steps;
+            us_ += STEP_US;
+            records_.push_back(makeRecord(mm_, (mm_ - prev) * 1e6f / (float)STEP_US));
+        }
+        return *this;
+    }
+
+    const std::vector<SensorRecord> &records() const { return records_; }
+    uint32_t nowUs() const { return us_; }
+
+private:
+    SensorRecord makeRecord(float mm, float vel) {
+        SensorRecord rec = SensorRecord();
+        rec.sampleUs = us_;
+        rec.sampleMs = us_ / 1000UL;
+        rec.pose.dispMm = mm;
+        rec.pose.velMmS = vel;
+        rec.pose.relRoll = mm / 100.0f;
+        return rec;
+    }
+
+    uint32_t us_;
+    float mm_;
+    bool started_;
+    std::vector<SensorRecord> records_;
+};
+
+struct Harness {
+    RepDetector detector;
+    std::vector<SessionRep> reps;
+
+    void push(const SensorRecord &rec) {
+        detector.push(rec, [this](const SessionRep &rep) { reps.push_back(rep); });
+    }
+
+    void run(const BarPath &path) {
+        for (const SensorRecord &rec : path.records()) push(rec);
+    }
+};
+
+BarPath &squat(BarPath &path) {
+    return path.moveTo(-400.0f, 1000).moveTo(0.0f, 1000);
+}
+
+} // namespace
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_squat_makes_one_rep(void) {
+    BarPath path;
+    path.hold(600);
+    uint32_t startMs = path.nowUs() / 1000UL;
+    squat(path).hold(600);
+
+    Harness h;
+    h.detector.restart(REP_DOWN_UP);
+    h.run(path);
+    TEST_ASSERT_EQUAL_size_t(1, h.reps.size());
+    const SessionRep &rep = h.reps[0];
+    TEST_ASSERT_EQUAL_UINT16(1, rep.index);
+    TEST_ASSERT_EQUAL_UINT16(400, rep.romMm);
+    TEST_ASSERT_EQUAL_UINT16(400, rep.meanVelMmS);
+    TEST_ASSERT_EQUAL_UINT16(400, rep.peakVelMmS);
+    TEST_ASSERT_EQUAL_UINT32(1000, rep.concentricMs);
+    TEST_ASSERT_EQUAL_UINT32(2000, rep.tutMs);
+    TEST_ASSERT_EQUAL_INT64(startMs, rep.startMs);
+    TEST_ASSERT_EQUAL_INT64(startMs + 2000, rep.endMs);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, -4.0f, rep.rollMinDeg);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.0f, rep.rollMaxDeg);
+    TEST_ASSERT_EQUAL_UINT16(1, h.detector.repCount());
+}
+
+void test_squat_in_floor_order_makes_no_rep(void) {
+    BarPath path;
+    squat(path.hold(600)).hold(600);
+
+    Harness h;
+    h.detector.restart(REP_UP_DOWN);
+    h.run(path);
+    TEST_ASSERT_EQUAL_size_t(0, h.reps.size());
+}
+
+void test_deadlift_pairs_up_then_down(void) {
+    BarPath path;
+    path.hold(600).moveTo(500.0f, 800).hold(300).moveTo(0.0f, 1000).hold(600);
+
+    Harness h;
+    h.detector.restart(REP_UP_DOWN);
+    h.run(path);
+    TEST_ASSERT_EQUAL_size_t(1, h.reps.size());
+    TEST_ASSERT_EQUAL_UINT16(500, h.reps[0].romMm);
+    TEST_ASSERT_EQUAL_UINT32(800, h.reps[0].concentricMs);
+    TEST_ASSERT_EQUAL_UINT32(2100, h.reps[0].tutMs);
+}
+
+void test_stray_phase_does_not_shift_pairing(void) {
+    // Unrack: a short lift and a rest before the first descent.
+    BarPath path;
+    path.hold(600).moveTo(200.0f, 500).hold(600);
+    squat(path).hold(600);
+
+    Harness h;
+    h.detector.restart(REP_DOWN_UP);
+    h.run(path);
+    TEST_ASSERT_EQUAL_size_t(1, h.reps.size());
+    TEST_ASSERT_EQUAL_UINT16(400, h.reps[0].romMm);
+}
+
+void test_short_phases_are_ignored(void) {
+    BarPath path;
+    path.hold(600).moveTo(-100.0f, 500).moveTo(0.0f, 500).hold(600);
+
+    Harness h;
+    h.run(path);
+    TEST_ASSERT_EQUAL_size_t(0, h.reps.size());
+}
+
+void test_gap_drops_rep_in_progress(void) {
+    BarPath down;
+    down.hold(600).moveTo(-400.0f, 1000);
+    // Same bar, picked up again at the bottom after the gap.
+    BarPath up(down.nowUs() + STEP_US, -400.0f);
+    up.moveTo(0.0f, 1000).hold(600);
+
+    Harness h;
+    h.run(down);
+    h.detector.gap();
+    h.run(up);
+    TEST_ASSERT_EQUAL_size_t(0, h.reps.size());
+}
+
+void test_restart_resets_numbering(void) {
+    BarPath path;
+    path.hold(600);
+    squat(path).hold(600);
+    squat(path).hold(600);
+
+    Harness h;
+    h.detector.restart();
+    h.run(path);
+    TEST_ASSERT_EQUAL_size_t(2, h.reps.size());
+    TEST_ASSERT_EQUAL_UINT16(2, h.reps[1].index);
+
+    BarPath next(path.nowUs() + 5000000);
+    squat(next.hold(600)).hold(600);
+    h.detector.restart();
+    h.run(next);
+    TEST_ASSERT_EQUAL_size_t(3, h.reps.size());
+    TEST_ASSERT_EQUAL_UINT16(1, h.reps[2].index);
+}
+
+void test_rep_order_for_exercise(void) {
+    TEST_ASSERT_EQUAL(REP_UP_DOWN, repOrderForExercise("deadlift"));
+    TEST_ASSERT_EQUAL(REP_UP_DOWN, repOrderForExercise("Sumo Deadlift"));
+    TEST_ASSERT_EQUAL(REP_UP_DOWN, repOrderForExercise("power clean"));
+    TEST_ASSERT_EQUAL(REP_UP_DOWN, repOrderForExercise("SNATCH"));
+    TEST_ASSERT_EQUAL(REP_DOWN_UP, repOrderForExercise("Romanian Deadlift"));
+    TEST_ASSERT_EQUAL(REP_DOWN_UP, repOrderForExercise("stiff-leg deadlift"));
+    TEST_ASSERT_EQUAL(REP_DOWN_UP, repOrderForExercise("squat"));
+    TEST_ASSERT_EQUAL(REP_DOWN_UP, repOrderForExercise(""));
+    TEST_ASSERT_EQUAL(REP_DOWN_UP, repOrderForExercise(nullptr));
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_squat_makes_one_rep);
+    RUN_TEST(test_squat_in_floor_order_makes_no_rep);
+    RUN_TEST(test_deadlift_pairs_up_then_down);
+    RUN_TEST(test_stray_phase_does_not_shift_pairing);
+    RUN_TEST(test_short_phases_are_ignored);
+    RUN_TEST(test_gap_drops_rep_in_progress);
+    RUN_TEST(test_restart_resets_numbering);
+    RUN_TEST(test_rep_order_for_exercise);
+    return UNITY_END();
+}
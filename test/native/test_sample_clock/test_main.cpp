@@ -0,0 +1,185 @@
+// Fixed-rate resampling of sensor-task records (app/sample_clock.h).
+
+#include <unity.h>
+
+#include <vector>
+
+#include "app/sample_clock.h"
+
+using liftrr::app::GridRow;
+using liftrr::app::SampleClock;
+using liftrr::sensors::SensorRecord;
+using namespace liftrr::storage;
+
+namespace {
+
+const uint32_t T0_US = 1000000;  // first record; grid and time base anchor here
+
+SensorRecord makeRecord(uint32_t sampleUs, float roll = 0.0f, uint32_t distUs = T0_US) {
+    SensorRecord rec = SensorRecord();
+    rec.sampleUs = sampleUs;
+    rec.sampleMs = sampleUs / 1000UL;
+    rec.sample.rawDist = 600;
+    rec.sample.distUs = distUs;
+    rec.sample.imuFresh = true;
+    rec.pose.relDist = 100;
+    rec.pose.relRoll = roll;
+    return rec;
+}
+
+struct Harness {
+    SampleClock clock;
+    std::vector<GridRow> rows;
+
+    void push(const SensorRecord &rec) {
+        clock.push(rec, [this](const GridRow &row) { rows.push_back(row); });
+    }
+};
+
+} // namespace
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_rows_fall_on_exact_grid(void) {
+    Harness h;
+    h.clock.start(50);
+    for (uint32_t i = 0; i <= 10; i++) {
+        // Sensor cycles jitter by a few hundred us; the grid must not.
+        uint32_t jitterUs = (i % 3) * 300;
+        h.push(makeRecord(T0_US + i * 10000 + jitterUs));
+    }
+    TEST_ASSERT_EQUAL_size_t(6, h.rows.size());
+    for (size_t i = 0; i < h.rows.size(); i++) {
+        TEST_ASSERT_EQUAL_INT64(1000 + (int64_t)i * 20, h.rows[i].timestampMs);
+    }
+    TEST_ASSERT_EQUAL_UINT16(RECORD_FLAG_RESYNC, h.rows[0].flags & RECORD_FLAG_RESYNC);
+    TEST_ASSERT_EQUAL_UINT16(0, h.rows[1].flags & RECORD_FLAG_RESYNC);
+    TEST_ASSERT_EQUAL_UINT32(6, h.clock.stats().rows);
+    TEST_ASSERT_EQUAL_UINT16(50, h.clock.stats().rateHz);
+}
+
+void test_unsupported_rate_falls_back_to_log_interval(void) {
+    Harness h;
+    h.clock.start(33);
+    TEST_ASSERT_EQUAL_UINT16(1000 / LOG_INTERVAL, h.clock.stats().rateHz);
+}
+
+void test_angles_interpolate_between_records(void) {
+    Harness h;
+    h.clock.start(100);
+    h.push(makeRecord(T0_US, 0.0f));
+    h.push(makeRecord(T0_US + 15000, 15.0f));
+    h.push(makeRecord(T0_US + 20000, 20.0f));
+    TEST_ASSERT_EQUAL_size_t(3, h.rows.size());
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.0f, h.rows[0].pose.relRoll);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 10.0f, h.rows[1].pose.relRoll);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 20.0f, h.rows[2].pose.relRoll);
+    TEST_ASSERT_EQUAL_UINT32(0, h.clock.stats().heldRows);
+}
+
+void test_yaw_interpolates_across_180(void) {
+    Harness h;
+    h.clock.start(100);
+    SensorRecord a = makeRecord(T0_US);
+    SensorRecord b = makeRecord(T0_US + 20000);
+    a.pose.relYaw = 170.0f;
+    b.pose.relYaw = -160.0f;
+    h.push(a);
+    h.push(b);
+    TEST_ASSERT_EQUAL_size_t(3, h.rows.size());
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, -175.0f, h.rows[1].pose.relYaw);
+}
+
+void test_dist_fresh_marks_first_row_of_a_measurement(void) {
+    Harness h;
+    h.clock.start(100);
+    h.push(makeRecord(T0_US, 0.0f, T0_US - 2000));
+    h.push(makeRecord(T0_US + 10000, 0.0f, T0_US - 2000));
+    h.push(makeRecord(T0_US + 20000, 0.0f, T0_US + 18000));
+    h.push(makeRecord(T0_US + 30000, 0.0f, T0_US + 18000));
+    TEST_ASSERT_EQUAL_size_t(4, h.rows.size());
+    TEST_ASSERT_TRUE(h.rows[0].flags & RECORD_FLAG_DIST_FRESH);
+    TEST_ASSERT_FALSE(h.rows[1].flags & RECORD_FLAG_DIST_FRESH);
+    TEST_ASSERT_TRUE(h.rows[2].flags & RECORD_FLAG_DIST_FRESH);
+    TEST_ASSERT_FALSE(h.rows[3].flags & RECORD_FLAG_DIST_FRESH);
+}
+
+void test_sparse_records_hold_angles(void) {
+    Harness h;
+    h.clock.start(100);
+    h.push(makeRecord(T0_US, 0.0f));
+    h.push(makeRecord(T0_US + 40000, 40.0f));  // too far apart to interpolate
+    TEST_ASSERT_EQUAL_size_t(5, h.rows.size());
+    for (size_t i = 1; i < 4; i++) {
+        TEST_ASSERT_TRUE(h.rows[i].flags & RECORD_FLAG_IMU_HELD);
+        TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.0f, h.rows[i].pose.relRoll);
+    }
+    TEST_ASSERT_FALSE(h.rows[4].flags & RECORD_FLAG_IMU_HELD);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 40.0f, h.rows[4].pose.relRoll);
+    TEST_ASSERT_EQUAL_UINT32(3, h.clock.stats().heldRows);
+}
+
+void test_stale_imu_holds_angles(void) {
+    Harness h;
+    h.clock.start(100);
+    for (uint32_t i = 0; i <= 5; i++) {
+        SensorRecord rec = makeRecord(T0_US + i * 10000, (float)i);
+        rec.sample.imuFresh = (i == 0);
+        h.push(rec);
+    }
+    TEST_ASSERT_EQUAL_size_t(6, h.rows.size());
+    for (size_t i = 0; i < 4; i++) {
+        TEST_ASSERT_FALSE(h.rows[i].flags & RECORD_FLAG_IMU_HELD);
+    }
+    TEST_ASSERT_TRUE(h.rows[4].flags & RECORD_FLAG_IMU_HELD);
+    TEST_ASSERT_TRUE(h.rows[5].flags & RECORD_FLAG_IMU_HELD);
+    TEST_ASSERT_EQUAL_UINT32(2, h.clock.stats().heldRows);
+}
+
+void test_gap_restarts_grid(void) {
+    Harness h;
+    h.clock.start(100);
+    h.push(makeRecord(T0_US));
+    h.push(makeRecord(T0_US + 10000));
+    h.clock.gap();
+    h.push(makeRecord(T0_US + 53000));
+    TEST_ASSERT_EQUAL_size_t(3, h.rows.size());
+    TEST_ASSERT_TRUE(h.rows[2].flags & RECORD_FLAG_RESYNC);
+    TEST_ASSERT_EQUAL_INT64(1053, h.rows[2].timestampMs);
+    TEST_ASSERT_EQUAL_UINT32(1, h.clock.stats().resyncs);
+}
+
+void test_long_pause_resyncs_without_backfill(void) {
+    Harness h;
+    h.clock.start(100);
+    h.push(makeRecord(T0_US));
+    h.push(makeRecord(T0_US + 2000000));
+    TEST_ASSERT_EQUAL_size_t(2, h.rows.size());
+    TEST_ASSERT_TRUE(h.rows[1].flags & RECORD_FLAG_RESYNC);
+    TEST_ASSERT_EQUAL_UINT32(1, h.clock.stats().resyncs);
+}
+
+void test_stopped_clock_emits_nothing(void) {
+    Harness h;
+    h.push(makeRecord(T0_US));
+    h.clock.start(100);
+    h.clock.stop();
+    h.push(makeRecord(T0_US + 10000));
+    TEST_ASSERT_EQUAL_size_t(0, h.rows.size());
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_rows_fall_on_exact_grid);
+    RUN_TEST(test_unsupported_rate_falls_back_to_log_interval);
+    RUN_TEST(test_angles_interpolate_between_records);
+    RUN_TEST(test_yaw_interpolates_across_180);
+    RUN_TEST(test_dist_fresh_marks_first_row_of_a_measurement);
+    RUN_TEST(test_sparse_records_hold_angles);
+    RUN_TEST(test_stale_imu_holds_angles);
+    RUN_TEST(test_gap_restarts_grid);
+    RUN_TEST(test_long_pause_resyncs_without_backfill);
+    RUN_TEST(test_stopped_clock_emits_nothing);
+    return UNITY_END();
+}
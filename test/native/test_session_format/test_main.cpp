@@ -0,0 +1,223 @@
+// Binary .lrb record codec and the change-driven logging filter
+// (storage/session_format.h).
+
+#include <unity.h>
+
+#include <vector>
+
+#include "storage/session_format.h"
+
+using namespace liftrr::storage;
+
+namespace {
+
+SessionSampleRow makeRow(int64_t timestampMs, int16_t distMm = 500, float rollDeg = 0.0f) {
+    SessionSampleRow row;
+    row.timestampMs = timestampMs;
+    row.distMm = distMm;
+    row.relDistMm = distMm - 100;
+    row.rollDeg = rollDeg;
+    row.pitchDeg = -2.5f;
+    row.yawDeg = 90.0f;
+    row.flags = 0;
+    return row;
+}
+
+// Encodes rows back to back, as StorageManager::writeBinarySample does.
+std::vector<uint8_t> encodeAll(const std::vector<SessionSampleRow> &rows) {
+    std::vector<uint8_t> out;
+    bool hasLast = false;
+    int64_t lastMs = 0;
+    for (const SessionSampleRow &row : rows) {
+        uint8_t buf[BINARY_SAMPLE_MAX_BYTES];
+        size_t len = encodeBinarySample(row, hasLast, lastMs, buf);
+        out.insert(out.end(), buf, buf + len);
+        hasLast = true;
+        lastMs = row.timestampMs;
+    }
+    return out;
+}
+
+struct Decoded {
+    int64_t timestampMs;
+    BinarySampleRecord rec;
+};
+
+// Reader side of the format: timestamp records set the clock, samples add dtMs.
+std::vector<Decoded> decodeAll(const std::vector<uint8_t> &bytes) {
+    std::vector<Decoded> out;
+    int64_t clockMs = 0;
+    for (size_t pos = 0; pos + sizeof(BinarySampleRecord) <= bytes.size();
+         pos += sizeof(BinarySampleRecord)) {
+        BinarySampleRecord rec;
+        memcpy(&rec, &bytes[pos], sizeof(rec));
+        if (rec.flags & RECORD_FLAG_TIMESTAMP) {
+            BinaryTimestampRecord ts;
+            memcpy(&ts, &bytes[pos], sizeof(ts));
+            clockMs = ts.timestampMs;
+            continue;
+        }
+        clockMs += rec.dtMs;
+        out.push_back(Decoded{clockMs, rec});
+    }
+    return out;
+}
+
+SessionChangeLog changeLog(uint16_t deadbandMm, float deadbandDeg, uint16_t heartbeatMs = 1000) {
+    SessionChangeLog cfg;
+    cfg.enabled = true;
+    cfg.deadbandMm = deadbandMm;
+    cfg.deadbandDeg = deadbandDeg;
+    cfg.heartbeatMs = heartbeatMs;
+    return cfg;
+}
+
+} // namespace
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_fixed_angle_rounds_and_saturates(void) {
+    TEST_ASSERT_EQUAL_INT16(64, toFixedAngle(1.0f));
+    TEST_ASSERT_EQUAL_INT16(-11520, toFixedAngle(-180.0f));
+    TEST_ASSERT_EQUAL_INT16(1, toFixedAngle(0.01f));   // 0.64 LSB rounds up
+    TEST_ASSERT_EQUAL_INT16(0, toFixedAngle(0.007f));  // 0.448 LSB rounds down
+    TEST_ASSERT_EQUAL_INT16(32767, toFixedAngle(1000.0f));
+    TEST_ASSERT_EQUAL_INT16(-32768, toFixedAngle(-1000.0f));
+}
+
+void test_first_sample_is_preceded_by_timestamp(void) {
+    SessionSampleRow row = makeRow(1710000000123LL, 512, 12.5f);
+    row.flags = RECORD_FLAG_DIST_FRESH;
+    uint8_t buf[BINARY_SAMPLE_MAX_BYTES];
+    size_t len = encodeBinarySample(row, false, 0, buf);
+    TEST_ASSERT_EQUAL_size_t(2 * sizeof(BinarySampleRecord), len);
+
+    BinaryTimestampRecord ts;
+    memcpy(&ts, buf, sizeof(ts));
+    TEST_ASSERT_EQUAL_UINT16(0, ts.dtMs);
+    TEST_ASSERT_EQUAL_UINT16(RECORD_FLAG_TIMESTAMP, ts.flags);
+    TEST_ASSERT_EQUAL_INT64(1710000000123LL, ts.timestampMs);
+
+    BinarySampleRecord rec;
+    memcpy(&rec, buf + sizeof(ts), sizeof(rec));
+    TEST_ASSERT_EQUAL_UINT16(0, rec.dtMs);
+    TEST_ASSERT_EQUAL_UINT16(RECORD_FLAG_DIST_FRESH, rec.flags);
+    TEST_ASSERT_EQUAL_INT16(512, rec.distMm);
+    TEST_ASSERT_EQUAL_INT16(412, rec.relDistMm);
+    TEST_ASSERT_EQUAL_INT16(800, rec.roll);
+    TEST_ASSERT_EQUAL_INT16(-160, rec.pitch);
+    TEST_ASSERT_EQUAL_INT16(5760, rec.yaw);
+}
+
+void test_following_sample_carries_delta_only(void) {
+    uint8_t buf[BINARY_SAMPLE_MAX_BYTES];
+    size_t len = encodeBinarySample(makeRow(1020), true, 1000, buf);
+    TEST_ASSERT_EQUAL_size_t(sizeof(BinarySampleRecord), len);
+    BinarySampleRecord rec;
+    memcpy(&rec, buf, sizeof(rec));
+    TEST_ASSERT_EQUAL_UINT16(20, rec.dtMs);
+}
+
+void test_unrepresentable_delta_emits_timestamp(void) {
+    uint8_t buf[BINARY_SAMPLE_MAX_BYTES];
+    TEST_ASSERT_EQUAL_size_t(sizeof(BinarySampleRecord),
+                             encodeBinarySample(makeRow(1000 + 0xFFFF), true, 1000, buf));
+    TEST_ASSERT_EQUAL_size_t(2 * sizeof(BinarySampleRecord),
+                             encodeBinarySample(makeRow(1000 + 0x10000), true, 1000, buf));
+    TEST_ASSERT_EQUAL_size_t(2 * sizeof(BinarySampleRecord),
+                             encodeBinarySample(makeRow(999), true, 1000, buf));
+}
+
+void test_timestamp_flag_never_leaks_into_samples(void) {
+    SessionSampleRow row = makeRow(1000);
+    row.flags = RECORD_FLAG_TIMESTAMP | RECORD_FLAG_IMU_HELD;
+    uint8_t buf[BINARY_SAMPLE_MAX_BYTES];
+    encodeBinarySample(row, true, 990, buf);
+    BinarySampleRecord rec;
+    memcpy(&rec, buf, sizeof(rec));
+    TEST_ASSERT_EQUAL_UINT16(RECORD_FLAG_IMU_HELD, rec.flags);
+}
+
+void test_stream_round_trips_timestamps(void) {
+    std::vector<SessionSampleRow> rows;
+    const int64_t times[] = {5000, 5020, 5040, 100000, 100020, 90000, 90020};
+    for (int64_t t : times) rows.push_back(makeRow(t, (int16_t)(t % 1000)));
+
+    std::vector<Decoded> decoded = decodeAll(encodeAll(rows));
+    TEST_ASSERT_EQUAL_size_t(rows.size(), decoded.size());
+    for (size_t i = 0; i < rows.size(); i++) {
+        TEST_ASSERT_EQUAL_INT64(rows[i].timestampMs, decoded[i].timestampMs);
+        TEST_ASSERT_EQUAL_INT16(rows[i].distMm, decoded[i].rec.distMm);
+    }
+}
+
+void test_identical_row_is_skipped(void) {
+    SessionSampleRow last = makeRow(1000);
+    SessionSampleRow row = makeRow(1020);
+    TEST_ASSERT_FALSE(sessionRowChanged(row, last, changeLog(0, 0.0f), SESSION_FORMAT_CSV));
+    TEST_ASSERT_FALSE(sessionRowChanged(row, last, changeLog(0, 0.0f), SESSION_FORMAT_BINARY));
+}
+
+void test_resync_and_heartbeat_force_a_row(void) {
+    SessionSampleRow last = makeRow(1000);
+    SessionSampleRow row = makeRow(1020);
+    row.flags = RECORD_FLAG_RESYNC;
+    TEST_ASSERT_TRUE(sessionRowChanged(row, last, changeLog(5, 1.0f), SESSION_FORMAT_CSV));
+
+    TEST_ASSERT_FALSE(sessionRowChanged(makeRow(1999), last, changeLog(5, 1.0f, 1000),
+                                        SESSION_FORMAT_CSV));
+    TEST_ASSERT_TRUE(sessionRowChanged(makeRow(2000), last, changeLog(5, 1.0f, 1000),
+                                       SESSION_FORMAT_CSV));
+}
+
+void test_flag_changes_alone_do_not_force_a_row(void) {
+    SessionSampleRow last = makeRow(1000);
+    SessionSampleRow row = makeRow(1020);
+    row.flags = RECORD_FLAG_IMU_HELD | RECORD_FLAG_DIST_FRESH;
+    TEST_ASSERT_FALSE(sessionRowChanged(row, last, changeLog(0, 0.0f), SESSION_FORMAT_BINARY));
+}
+
+void test_distance_deadband_is_inclusive(void) {
+    SessionSampleRow last = makeRow(1000, 500);
+    TEST_ASSERT_FALSE(sessionRowChanged(makeRow(1020, 505), last, changeLog(5, 0.0f),
+                                        SESSION_FORMAT_CSV));
+    TEST_ASSERT_TRUE(sessionRowChanged(makeRow(1020, 506), last, changeLog(5, 0.0f),
+                                       SESSION_FORMAT_CSV));
+}
+
+void test_angles_compare_at_file_resolution(void) {
+    SessionSampleRow last = makeRow(1000, 500, 10.0f);
+    // CSV keeps 1/1000 deg, binary 1/64 deg.
+    SessionSampleRow tiny = makeRow(1020, 500, 10.0004f);
+    SessionSampleRow small = makeRow(1020, 500, 10.005f);
+    TEST_ASSERT_FALSE(sessionRowChanged(tiny, last, changeLog(0, 0.0f), SESSION_FORMAT_CSV));
+    TEST_ASSERT_TRUE(sessionRowChanged(small, last, changeLog(0, 0.0f), SESSION_FORMAT_CSV));
+    TEST_ASSERT_FALSE(sessionRowChanged(small, last, changeLog(0, 0.0f), SESSION_FORMAT_BINARY));
+}
+
+void test_yaw_wraps_at_180(void) {
+    SessionSampleRow last = makeRow(1000);
+    SessionSampleRow row = makeRow(1020);
+    last.yawDeg = 179.9f;
+    row.yawDeg = -179.9f;
+    TEST_ASSERT_FALSE(sessionRowChanged(row, last, changeLog(0, 0.5f), SESSION_FORMAT_CSV));
+    TEST_ASSERT_TRUE(sessionRowChanged(row, last, changeLog(0, 0.1f), SESSION_FORMAT_CSV));
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_fixed_angle_rounds_and_saturates);
+    RUN_TEST(test_first_sample_is_preceded_by_timestamp);
+    RUN_TEST(test_following_sample_carries_delta_only);
+    RUN_TEST(test_unrepresentable_delta_emits_timestamp);
+    RUN_TEST(test_timestamp_flag_never_leaks_into_samples);
+    RUN_TEST(test_stream_round_trips_timestamps);
+    RUN_TEST(test_identical_row_is_skipped);
+    RUN_TEST(test_resync_and_heartbeat_force_a_row);
+    RUN_TEST(test_flag_changes_alone_do_not_force_a_row);
+    RUN_TEST(test_distance_deadband_is_inclusive);
+    RUN_TEST(test_angles_compare_at_file_resolution);
+    RUN_TEST(test_yaw_wraps_at_180);
+    return UNITY_END();
+}
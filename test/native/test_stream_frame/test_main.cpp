@@ -0,0 +1,117 @@
+// Framed Classic transfer layout and payload CRC (comm/bt_stream_frame.h,
+// core/crc32.h).
+
+#include <unity.h>
+
+#include <stddef.h>
+
+#include "comm/bt_stream_frame.h"
+#include "core/crc32.h"
+
+using namespace liftrr::comm;
+using liftrr::core::crc32Update;
+
+namespace {
+
+const char kCheck[] = "123456789";
+
+// Header + payload, filled in the way BtClassic::sendFrame does.
+size_t buildFrame(uint8_t type, uint32_t seq, uint32_t offset,
+                  const uint8_t *payload, size_t len, uint8_t *out) {
+    BtStreamFrameHeader header;
+    header.magic = BT_STREAM_FRAME_MAGIC;
+    header.version = BT_STREAM_FRAME_VERSION;
+    header.type = type;
+    header.headerSize = sizeof(BtStreamFrameHeader);
+    header.seq = seq;
+    header.offset = offset;
+    header.length = (uint32_t)len;
+    header.crc32 = crc32Update(0, payload, len);
+    memcpy(out, &header, sizeof(header));
+    if (len) memcpy(out + sizeof(header), payload, len);
+    return sizeof(header) + len;
+}
+
+// Receiver-side check: header sane and payload matches its CRC.
+bool frameValid(const uint8_t *frame, size_t len) {
+    BtStreamFrameHeader header;
+    if (len < sizeof(header)) return false;
+    memcpy(&header, frame, sizeof(header));
+    if (header.magic != BT_STREAM_FRAME_MAGIC) return false;
+    if (header.version != BT_STREAM_FRAME_VERSION) return false;
+    if (header.headerSize + header.length != len) return false;
+    return crc32Update(0, frame + header.headerSize, header.length) == header.crc32;
+}
+
+} // namespace
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_crc32_check_value(void) {
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926UL, crc32Update(0, kCheck, 9));
+    TEST_ASSERT_EQUAL_HEX32(0, crc32Update(0, kCheck, 0));
+    TEST_ASSERT_EQUAL_HEX32(0xE8B7BE43UL, crc32Update(0, "a", 1));
+}
+
+void test_crc32_in_pieces_matches_one_shot(void) {
+    uint8_t data[1000];
+    for (size_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t)(i * 31 + 7);
+    uint32_t whole = crc32Update(0, data, sizeof(data));
+
+    const size_t pieces[] = {1, 3, 64, 333};
+    for (size_t piece : pieces) {
+        uint32_t crc = 0;
+        for (size_t pos = 0; pos < sizeof(data); pos += piece) {
+            size_t n = (sizeof(data) - pos < piece) ? sizeof(data) - pos : piece;
+            crc = crc32Update(crc, data + pos, n);
+        }
+        TEST_ASSERT_EQUAL_HEX32(whole, crc);
+    }
+}
+
+void test_frame_verifies_and_detects_corruption(void) {
+    uint8_t payload[200];
+    for (size_t i = 0; i < sizeof(payload); i++) payload[i] = (uint8_t)i;
+    uint8_t frame[sizeof(BtStreamFrameHeader) + sizeof(payload)];
+    size_t len = buildFrame(BT_FRAME_DATA, 7, 4096, payload, sizeof(payload), frame);
+    TEST_ASSERT_EQUAL_size_t(sizeof(frame), len);
+    TEST_ASSERT_TRUE(frameValid(frame, len));
+
+    frame[sizeof(BtStreamFrameHeader) + 123] ^= 0x10;
+    TEST_ASSERT_FALSE(frameValid(frame, len));
+    frame[sizeof(BtStreamFrameHeader) + 123] ^= 0x10;
+
+    // Truncated on the link.
+    TEST_ASSERT_FALSE(frameValid(frame, len - 1));
+}
+
+void test_empty_payload_frame(void) {
+    uint8_t frame[sizeof(BtStreamFrameHeader)];
+    size_t len = buildFrame(BT_FRAME_END, 0, 0, nullptr, 0, frame);
+    TEST_ASSERT_TRUE(frameValid(frame, len));
+}
+
+void test_wire_layout(void) {
+    uint8_t frame[sizeof(BtStreamFrameHeader)];
+    buildFrame(BT_FRAME_DATA, 0x01020304UL, 0, nullptr, 0, frame);
+    TEST_ASSERT_EQUAL_MEMORY("LRSF", frame, 4);
+    TEST_ASSERT_EQUAL_UINT8(BT_FRAME_DATA, frame[offsetof(BtStreamFrameHeader, type)]);
+    TEST_ASSERT_EQUAL_UINT8(0x04, frame[offsetof(BtStreamFrameHeader, seq)]);
+
+    TEST_ASSERT_EQUAL_size_t(8, offsetof(BtStreamFrameHeader, seq));
+    TEST_ASSERT_EQUAL_size_t(20, offsetof(BtStreamFrameHeader, crc32));
+    TEST_ASSERT_EQUAL_size_t(8, offsetof(BtStreamFileHeader, name));
+    TEST_ASSERT_EQUAL_size_t(24, offsetof(BtStreamTrailer, status));
+    TEST_ASSERT_EQUAL_size_t(4, offsetof(BtStreamBatchTrailer, totalBytes));
+}
+
+int main(int, char **) {
+    UNITY_BEGIN();
+    RUN_TEST(test_crc32_check_value);
+    RUN_TEST(test_crc32_in_pieces_matches_one_shot);
+    RUN_TEST(test_frame_verifies_and_detects_corruption);
+    RUN_TEST(test_empty_payload_frame);
+    RUN_TEST(test_wire_layout);
+    return UNITY_END();
+}